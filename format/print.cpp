@@ -1,10 +1,18 @@
 #include <string>
 #include <array>
 #include <algorithm>
+#include <cmath>
+#include <memory>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <ryu/ryu2.h>
+#include "print_scan.h"
+#include "print_digits.h"
+#include "print_float.h"
 
 #include <chrono>
 
@@ -74,24 +82,6 @@ struct BufferWriter
     size_t terminate() { if (bufferoff < buffersize) buffer[bufferoff] = '\0'; else buffer[buffersize - 1] = '\0'; return bufferoff; }
 };
 
-struct FileWriter
-{
-    FileWriter(FILE* f)
-        : file(f), bufferoff(0)
-    {
-    }
-
-    FILE* file;
-    size_t bufferoff;
-
-    void put(char c) { fputc(c, file); ++bufferoff; }
-    void put(const char* c, size_t s) { fwrite(c, 1, s, file); bufferoff += s; }
-
-    size_t offset() const { return bufferoff; }
-    size_t size() const { return std::numeric_limits<size_t>::max(); }
-    size_t terminate() { return bufferoff; }
-};
-
 inline void clearState(State& state)
 {
     state.flags = State::Flag_None;
@@ -153,29 +143,6 @@ struct is_stringish : std::integral_constant<
 {
 };
 
-template<size_t N>
-constexpr size_t stringLength(const char (&)[N])
-{
-    return N;
-}
-
-static inline size_t stringLength(const char* str)
-{
-    return strlen(str);
-}
-
-template<class T>
-struct is_float_double : std::integral_constant<
-    bool,
-    std::is_same<float, typename std::decay<T>::type>::value ||
-    std::is_same<double, typename std::decay<T>::type>::value>
-{
-};
-
-template<typename T> struct dependent_false : std::false_type
-{
-};
-
 template <std::size_t N, typename T>
 constexpr std::array<T, N> make_array(const T& value)
 {
@@ -199,16 +166,197 @@ void writePad(Writer& writer, int num)
 }
 
 template<size_t N>
-inline int print_error(const char (&type)[N], State& state, const char* format, size_t formatoff)
+inline int print_error(const char (&type)[N])
 {
     fwrite(type, 1, N, stderr);
     fwrite("\n", 1, 2, stderr);
     fflush(stderr);
     abort();
+    return 0;
+}
+
+// The templates only lower each call into an array of PrintArguments, the
+// formatting is done by print_flat which doesn't know about the argument
+// types. Code size doesn't grow with the number of call signatures.
+struct PrintArgument
+{
+    enum Type : uint8_t
+    {
+        Signed,
+        Unsigned,
+        Float,
+        Double,
+        LongDouble,
+        Pointer,
+        IntPointer,
+        CString,
+        String,
+        Other
+    };
+    struct StringType
+    {
+        const char* str;
+        size_t len;
+    };
+
+    Type type;
+    // integers are widened, this is the size of the type they came from
+    uint8_t bytes;
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        float f;
+        double d;
+        // the caller's value outlives the call
+        const long double* ld;
+        const void* ptr;
+        int* iptr;
+        const char* cstr;
+        StringType str;
+    };
+};
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, void>::type* = nullptr>
+PrintArgument print_argument(const T& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::Signed;
+    a.bytes = sizeof(T);
+    a.i = static_cast<int64_t>(arg);
+    return a;
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, void>::type* = nullptr>
+PrintArgument print_argument(const T& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::Unsigned;
+    a.bytes = sizeof(T);
+    a.u = static_cast<uint64_t>(arg);
+    return a;
+}
+
+inline PrintArgument print_argument(const float& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::Float;
+    a.f = arg;
+    return a;
+}
+
+inline PrintArgument print_argument(const double& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::Double;
+    a.d = arg;
+    return a;
+}
+
+inline PrintArgument print_argument(const long double& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::LongDouble;
+    a.ld = &arg;
+    return a;
+}
+
+template<typename T, typename std::enable_if<is_c_string<T>::value, void>::type* = nullptr>
+PrintArgument print_argument(const T& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::CString;
+    a.cstr = arg;
+    return a;
+}
+
+inline PrintArgument print_argument(const std::string& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::String;
+    a.str = { arg.c_str(), arg.size() };
+    return a;
+}
+
+inline PrintArgument print_argument(int* const& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::IntPointer;
+    a.iptr = arg;
+    return a;
+}
+
+template<typename T, typename std::enable_if<(std::is_pointer<T>::value && !is_c_string<T>::value && !std::is_same<int*, T>::value)
+                                             || std::is_same<std::nullptr_t, T>::value, void>::type* = nullptr>
+PrintArgument print_argument(const T& arg)
+{
+    PrintArgument a;
+    a.type = PrintArgument::Pointer;
+    a.ptr = arg;
+    return a;
+}
+
+// anything else only fails when a conversion tries to use it
+template<typename T, typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_pointer<T>::value && !is_c_string<T>::value
+                                             && !std::is_same<std::nullptr_t, T>::value && !std::is_same<std::string, T>::value, void>::type* = nullptr>
+PrintArgument print_argument(const T&)
+{
+    PrintArgument a;
+    a.type = PrintArgument::Other;
+    return a;
+}
+
+// Types with a to_string are converted up front, the string is a temporary
+// of the full expression that makes the call so it outlives print_flat
+template<typename Arg, typename std::enable_if<has_global_to_string<Arg>::value, void>::type* = nullptr>
+std::string print_stringify(Arg&& arg)
+{
+    return to_string(std::forward<Arg>(arg));
 }
 
-template<typename Writer, typename ...Args>
-int print_execute_helper(State& state, Writer& writer, const char* buffer, size_t bufsiz, const char* extra, size_t extrasiz, const char* format, size_t formatoff, Args&& ...args)
+template<typename Arg, typename std::enable_if<has_member_to_string_ref<Arg>::value, void>::type* = nullptr>
+std::string print_stringify(Arg&& arg)
+{
+    return arg.to_string();
+}
+
+template<typename Arg, typename std::enable_if<has_member_to_string_ptr<Arg>::value, void>::type* = nullptr>
+std::string print_stringify(Arg&& arg)
+{
+    return arg->to_string();
+}
+
+template<typename Arg, typename std::enable_if<!has_global_to_string<Arg>::value && !has_member_to_string_ref<Arg>::value && !has_member_to_string_ptr<Arg>::value, void>::type* = nullptr>
+Arg&& print_stringify(Arg&& arg)
+{
+    return std::forward<Arg>(arg);
+}
+
+template<typename ...Args>
+std::array<PrintArgument, sizeof...(Args)> print_arguments(const Args& ...args)
+{
+    return {{ print_argument(args)... }};
+}
+
+// the value as the type it came from, sign extended
+inline int64_t print_signed(const PrintArgument& arg)
+{
+    const int shift = 64 - arg.bytes * 8;
+    return static_cast<int64_t>(arg.u << shift) >> shift;
+}
+
+// the value as the unsigned counterpart of the type it came from
+inline uint64_t print_unsigned(const PrintArgument& arg)
+{
+    return arg.bytes < 8 ? arg.u & ((uint64_t(1) << (arg.bytes * 8)) - 1) : arg.u;
+}
+
+inline bool print_is_integral(const PrintArgument& arg)
+{
+    return arg.type == PrintArgument::Signed || arg.type == PrintArgument::Unsigned;
+}
+
+static void print_put_field(const State& state, BufferWriter& writer, const char* buffer, size_t bufsiz, const char* extra, size_t extrasiz)
 {
     const bool left = state.flags & State::Flag_LeftJustify;
 
@@ -218,8 +366,8 @@ int print_execute_helper(State& state, Writer& writer, const char* buffer, size_
         precision = state.precision;
 
         // precision of 0 means that the number 0 should not be emitted
-        if (!precision && bufsiz == 1 && buffer[bufsiz] == '0')
-            return print_helper(state, writer, format, formatoff, std::forward<Args>(args)...);
+        if (!precision && bufsiz == 1 && buffer[0] == '0')
+            return;
     }
 
     const bool hasextra = extrasiz && extra[0] != 0;
@@ -261,84 +409,61 @@ int print_execute_helper(State& state, Writer& writer, const char* buffer, size_
         else
             writePad<' '>(writer, pad);
     }
-
-    // do stuff
-    return print_helper(state, writer, format, formatoff, std::forward<Args>(args)...);
 }
 
-template<typename Writer, typename ...Args>
-int print_helper(State& state, Writer& writer, const char* format, size_t formatoff, Args&& ...args);
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_10_helper(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static void print_put_padded(const State& state, BufferWriter& writer, const char* str, size_t sz)
 {
-    // adapted from http://ideone.com/nrQfA8
-
-    typedef typename std::decay<Arg>::type ArgType;
-    typedef typename std::make_unsigned<ArgType>::type UnsignedArgType;
-    typedef std::numeric_limits<ArgType> Info;
-
-    UnsignedArgType unumber = arg < 0 ? -arg : arg;
+    int pad = 0;
+    if (state.width != State::None) {
+        assert(state.width >= 0);
+        pad = std::max<int>(0, state.width - sz);
+    }
 
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
+    if (pad && !(state.flags & State::Flag_LeftJustify)) {
+        writePad<' '>(writer, pad);
+    }
 
-    char buffer[bufsize];
-    char* bufptr = buffer;
-    char extra = 0;
+    writer.put(str, sz);
 
-    if (arg == 0) {
-        *bufptr++ = '0';
-    } else {
-        if (arg < 0) {
-            extra = '-';
-        } else if (state.flags & State::Flag_Sign) {
-            extra = '+';
-        } else if (state.flags & State::Flag_Space) {
-            extra = ' ';
-        }
-        char* p_first = bufptr;
-        while (unumber != 0)
-        {
-            *bufptr++ = '0' + unumber % 10;
-            unumber /= 10;
-        }
-        std::reverse(p_first, bufptr);
+    if (pad && (state.flags & State::Flag_LeftJustify)) {
+        writePad<' '>(writer, pad);
     }
-
-    return print_execute_helper(state, writer, buffer, bufptr - buffer, &extra, 1, format, formatoff, std::forward<Args>(args)...);
 }
 
-template<bool Signed, typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_10(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static int print_format_int_10(const State& state, BufferWriter& writer, bool sign, const PrintArgument& arg)
 {
-    if (Signed) {
-        return print_execute_int_10_helper(state, writer, format, formatoff, static_cast<typename std::make_signed<typename std::decay<Arg>::type>::type>(arg), std::forward<Args>(args)...);
-    } else {
-        return print_execute_int_10_helper(state, writer, format, formatoff, static_cast<typename std::make_unsigned<typename std::decay<Arg>::type>::type>(arg), std::forward<Args>(args)...);
+    if (!print_is_integral(arg))
+        return print_error("Argument 10 is not integral");
+
+    const int64_t number = sign ? print_signed(arg) : 0;
+    const uint64_t unumber = !sign ? print_unsigned(arg) : number < 0 ? uint64_t(0) - static_cast<uint64_t>(number) : static_cast<uint64_t>(number);
+
+    char buffer[std::numeric_limits<uint64_t>::digits10 + 1];
+    char extra = 0;
+
+    if (number < 0) {
+        extra = '-';
+    } else if (state.flags & State::Flag_Sign) {
+        extra = '+';
+    } else if (state.flags & State::Flag_Space) {
+        extra = ' ';
     }
-}
 
-template<bool Signed, typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_10(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument 10 is not integral", state, format, formatoff);
+    const int len = print_decimal_length(unumber);
+    print_write_decimal(buffer, unumber, len);
+
+    print_put_field(state, writer, buffer, len, &extra, 1);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_16(State& state, Writer& writer, const char* format, size_t formatoff, const char* alphabet, Arg&& arg, Args&& ...args)
+static int print_format_int_16(const State& state, BufferWriter& writer, const char* alphabet, const PrintArgument& arg)
 {
-    typedef typename std::decay<Arg>::type ArgType;
-    typedef typename std::make_unsigned<ArgType>::type UnsignedArgType;
-    typedef std::numeric_limits<ArgType> Info;
-
-    UnsignedArgType number = static_cast<UnsignedArgType>(arg);
+    if (!print_is_integral(arg))
+        return print_error("Argument 16 is not integral");
 
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
+    const uint64_t number = print_unsigned(arg);
 
-    char buffer[bufsize];
-    char* bufptr = buffer;
+    char buffer[std::numeric_limits<uint64_t>::digits / 4 + 1];
     char extra[2] = { 0, 0 };
 
     if (state.flags & State::Flag_Prefix) {
@@ -346,484 +471,454 @@ int print_execute_int_16(State& state, Writer& writer, const char* format, size_
         extra[1] = alphabet[16];
     }
 
-    if (number == 0) {
-        *bufptr++ = '0';
-    } else {
-        char* p_first = bufptr;
-        while (number != 0)
-        {
-            *bufptr++ = alphabet[number & 0xf];
-            number >>= 4;
-        }
-        std::reverse(p_first, bufptr);
-    }
+    const int len = print_radix_length<4>(number);
+    print_write_hex(buffer, number, len, alphabet);
 
-    return print_execute_helper(state, writer, buffer, bufptr - buffer, extra, 2, format, formatoff, std::forward<Args>(args)...);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_16(State& state, Writer& writer, const char* format, size_t formatoff, const char* alphabet, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument 16 is not integral", state, format, formatoff);
+    print_put_field(state, writer, buffer, len, extra, 2);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_8(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static int print_format_int_8(const State& state, BufferWriter& writer, const PrintArgument& arg)
 {
-    typedef typename std::decay<Arg>::type ArgType;
-    typedef typename std::make_unsigned<ArgType>::type UnsignedArgType;
-    typedef std::numeric_limits<ArgType> Info;
+    if (!print_is_integral(arg))
+        return print_error("Argument 8 is not integral");
 
-    UnsignedArgType number = static_cast<UnsignedArgType>(arg);
+    const uint64_t number = print_unsigned(arg);
 
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
-
-    char buffer[bufsize];
-    char* bufptr = buffer;
+    char buffer[std::numeric_limits<uint64_t>::digits / 3 + 1];
     char extra = 0;
 
-    if (state.flags & State::Flag_Prefix)
+    if ((state.flags & State::Flag_Prefix) && number != 0)
         extra = '0';
 
-    if (number == 0) {
-        *bufptr++ = '0';
-        extra = 0;
-    } else {
-        char* p_first = bufptr;
-        while (number != 0)
-        {
-            *bufptr++ = '0' + (number & 0x7);
-            number >>= 3;
-        }
-        std::reverse(p_first, bufptr);
-    }
-
-    return print_execute_helper(state, writer, buffer, bufptr - buffer, &extra, 1, format, formatoff, std::forward<Args>(args)...);
-}
+    const int len = print_radix_length<3>(number);
+    print_write_octal(buffer, number, len);
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_integral<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_int_8(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument 8 is not integral", state, format, formatoff);
+    print_put_field(state, writer, buffer, len, &extra, 1);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_pointer<typename std::decay<Arg>::type>::value || std::is_same<std::nullptr_t, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_ptr(State& state, Writer& writer, const char* format, size_t formatoff, const char* alphabet, Arg&& arg, Args&& ...args)
+static int print_format_int_2(const State& state, BufferWriter& writer, const PrintArgument& arg)
 {
-    uintptr_t number = reinterpret_cast<uintptr_t>(arg);
-    typedef std::numeric_limits<uintptr_t> Info;
+    if (!print_is_integral(arg))
+        return print_error("Argument 2 is not integral");
 
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
+    const uint64_t number = print_unsigned(arg);
 
-    char buffer[bufsize];
-    char* bufptr = buffer;
-    char extra[2] = { '0', 'x' };
+    char buffer[std::numeric_limits<uint64_t>::digits];
+    char extra[2] = { 0, 0 };
 
-    if (number == 0) {
-        *bufptr++ = '(';
-        *bufptr++ = 'n';
-        *bufptr++ = 'i';
-        *bufptr++ = 'l';
-        *bufptr++ = ')';
-        extra[0] = 0;
-    } else {
-        char* p_first = bufptr;
-        while (number != 0)
-        {
-            *bufptr++ = alphabet[number & 0xf];
-            number >>= 4;
-        }
-        std::reverse(p_first, bufptr);
+    if ((state.flags & State::Flag_Prefix) && number != 0) {
+        extra[0] = '0';
+        extra[1] = 'b';
     }
 
-    return print_execute_helper(state, writer, buffer, bufptr - buffer, extra, 2, format, formatoff, std::forward<Args>(args)...);
-}
+    const int len = print_radix_length<1>(number);
+    print_write_binary(buffer, number, len);
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_pointer<typename std::decay<Arg>::type>::value && !std::is_same<std::nullptr_t, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_ptr(State& state, Writer& writer, const char* format, size_t formatoff, const char* alphabet, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument is not pointer", state, format, formatoff);
+    print_put_field(state, writer, buffer, len, extra, 2);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<is_float_double<Arg>::value, void>::type* = nullptr>
-int print_execute_float(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static int print_format_ptr(const State& state, BufferWriter& writer, const char* alphabet, const PrintArgument& arg)
 {
-    Arg number = arg;
+    if (arg.type != PrintArgument::Pointer && arg.type != PrintArgument::IntPointer && arg.type != PrintArgument::CString)
+        return print_error("Argument is not pointer");
 
-    char extra = 0;
-    if (arg >= 0) {
-        if (state.flags & State::Flag_Sign)
-            extra = '+';
-        else if (state.flags & State::Flag_Space)
-            extra = ' ';
-    } else {
-        extra = '-';
-        number = -number;
+    const uintptr_t number = reinterpret_cast<uintptr_t>(arg.ptr);
+
+    if (number == 0) {
+        print_put_field(state, writer, "(nil)", 5, nullptr, 0);
+        return 0;
     }
 
-    char buffer[2048];
-    const int n = d2fixed_buffered_n(number, state.precision == State::None ? 6 : state.precision, buffer);
+    char buffer[std::numeric_limits<uintptr_t>::digits / 4];
+    const char extra[2] = { '0', 'x' };
 
-    return print_execute_helper(state, writer, buffer, n, &extra, 1, format, formatoff, std::forward<Args>(args)...);
-}
+    const int len = print_radix_length<4>(number);
+    print_write_hex(buffer, number, len, alphabet);
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<long double, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_float(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Long double not implemented", state, format, formatoff);
+    print_put_field(state, writer, buffer, len, extra, 2);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_floating_point<Arg>::value, void>::type* = nullptr>
-int print_execute_float(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument is not a floating point", state, format, formatoff);
+// Calls formatter with the argument in its own floating point type
+template<typename Formatter>
+int print_visit_float(const PrintArgument& arg, const Formatter& formatter)
+{
+    switch (arg.type) {
+    case PrintArgument::Float:
+        formatter(arg.f);
+        return 0;
+    case PrintArgument::Double:
+        formatter(arg.d);
+        return 0;
+    case PrintArgument::LongDouble:
+        formatter(*arg.ld);
+        return 0;
+    default:
+        return print_error("Argument is not a floating point");
+    }
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<is_float_double<Arg>::value, void>::type* = nullptr>
-int print_execute_float_shortest(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+struct PrintFixedFormatter
 {
-    Arg number = arg;
+    const State& state;
+    BufferWriter& writer;
 
-    char extra = 0;
-    if (arg >= 0) {
-        if (state.flags & State::Flag_Sign)
-            extra = '+';
-        else if (state.flags & State::Flag_Space)
-            extra = ' ';
-    } else {
-        extra = '-';
-        number = -number;
-    }
-
-    auto chop = [](const char* b, size_t n, int& from, int& len, bool& allzero) -> int {
-        int sub1 = n;
-        int sub2 = -1;
-        int dummy = 0;
-        int e = -1;
-        int* what = &sub1;
-        for (; n > 0; --n) {
-            switch(b[n - 1]) {
-            case '0':
-            case '+':
-                --*what;
-                break;
-            case 'e':
-                --*what;
-                if (what == &dummy) {
-                    sub2 = e = n - 1;
-                    what = &sub2;
-                }
-                break;
-            case '.':
-                ++*what;
-                if (what != &dummy)
-                    what = &dummy;
-                break;
-            default:
-                allzero = false;
-                if (what != &dummy)
-                    what = &dummy;
-                break;
-            }
-        }
-        if (e != -1 && sub2 != -1) {
-            from = sub2;
-            len = e - sub2;
+    template<typename T>
+    void operator()(T number) const
+    {
+        char extra = 0;
+        if (number >= 0) {
+            if (state.flags & State::Flag_Sign)
+                extra = '+';
+            else if (state.flags & State::Flag_Space)
+                extra = ' ';
+        } else {
+            extra = '-';
+            number = -number;
         }
-        return sub1;
-    };
 
-    const int precision = state.precision == State::None ? 6 : state.precision;
-
-    char buffer1[2048];
-    char buffer2[2048];
-    int n1 = d2exp_buffered_n(number, precision, buffer1);
-    int n2 = d2fixed_buffered_n(number, precision, buffer2);
-    int from1 = 0, len1 = 0;
-    int from2 = 0, len2 = 0;
-    bool az1 = true, az2 = true;
-    n2 = chop(buffer2, n2, from2, len2, az2);
-    n1 = chop(buffer1, n1, from1, len1, az1);
-    if (n1 - len1 < n2 || (!az1 && az2)) {
-        if (len1 > 0) {
-            n1 -= len1;
-            memmove(buffer1 + from1, buffer1 + from1 + len1, n1);
+        const uint32_t precision = state.precision == State::None ? 6 : state.precision;
+
+        char buffer[2048];
+        int n;
+        uint64_t scaled;
+        if (print_fixed_scaled(number, precision, scaled)) {
+            int intdigits;
+            n = print_fixed_length(scaled, precision, intdigits);
+            print_write_fixed(buffer, scaled, precision, intdigits);
+        } else {
+            n = print_fixed_n(number, precision, buffer);
         }
-        return print_execute_helper(state, writer, buffer1, n1, &extra, 1, format, formatoff, std::forward<Args>(args)...);
+
+        print_put_field(state, writer, buffer, n, &extra, 1);
     }
-    return print_execute_helper(state, writer, buffer2, n2, &extra, 1, format, formatoff, std::forward<Args>(args)...);
-}
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<long double, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_float_shortest(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Long double not implemented", state, format, formatoff);
-}
+    // the integer part of a long double can have thousands of digits, the
+    // buffer is sized from the exponent
+    void operator()(long double number) const
+    {
+        char extra = 0;
+        if (!std::signbit(number)) {
+            if (state.flags & State::Flag_Sign)
+                extra = '+';
+            else if (state.flags & State::Flag_Space)
+                extra = ' ';
+        } else {
+            extra = '-';
+            number = -number;
+        }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_floating_point<Arg>::value, void>::type* = nullptr>
-int print_execute_float_shortest(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument is not a floating point", state, format, formatoff);
-}
+        const uint32_t precision = state.precision == State::None ? 6 : state.precision;
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<is_float_double<Arg>::value, void>::type* = nullptr>
-int print_execute_float_exp(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    Arg number = arg;
+        std::unique_ptr<char[]> buffer(new char[print_wide_fixed_bound(print_wide_float(number), precision)]);
+        const int n = print_fixed_n(number, precision, buffer.get());
 
-    char extra = 0;
-    if (arg >= 0) {
-        if (state.flags & State::Flag_Sign)
-            extra = '+';
-        else if (state.flags & State::Flag_Space)
-            extra = ' ';
-    } else {
-        extra = '-';
-        number = -number;
+        print_put_field(state, writer, buffer.get(), n, &extra, 1);
     }
+};
 
-    char buffer[2048];
-    const int n = d2exp_buffered_n(number, state.precision == State::None ? 6 : state.precision, buffer);
-    return print_execute_helper(state, writer, buffer, n, &extra, 1, format, formatoff, std::forward<Args>(args)...);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<long double, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_float_exp(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Long double not implemented", state, format, formatoff);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_floating_point<Arg>::value, void>::type* = nullptr>
-int print_execute_float_exp(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+struct PrintGeneralFormatter
 {
-    return print_error("Argument is not a floating point", state, format, formatoff);
-}
+    const State& state;
+    BufferWriter& writer;
+    bool upper;
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<int*, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_store(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    *arg = static_cast<int>(writer.offset());
-    return print_helper(state, writer, format, formatoff, std::forward<Args>(args)...);
-}
+    template<typename T>
+    void operator()(T number) const
+    {
+        char extra = 0;
+        if (!std::signbit(number)) {
+            if (state.flags & State::Flag_Sign)
+                extra = '+';
+            else if (state.flags & State::Flag_Space)
+                extra = ' ';
+        } else {
+            extra = '-';
+            number = -number;
+        }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_same<int*, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_store(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Argument is not an int pointer", state, format, formatoff);
-}
+        const int precision = state.precision == State::None ? 6 : state.precision;
+        const bool alternate = state.flags & State::Flag_Prefix;
+        const int digits = print_general_digits(number, precision, alternate);
+        const size_t size = print_general_size(digits);
+        char stack[PrintGeneralBuffer];
+        std::unique_ptr<char[]> heap;
+        char* buffer = stack;
+        if (size > sizeof(stack)) {
+            heap.reset(new char[size]);
+            buffer = heap.get();
+        }
+        int n;
+        const char* out = print_format_general(number, precision, digits, alternate, upper, buffer, n);
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<is_c_string<Arg>::value, void>::type* = nullptr>
-int print_execute_str(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    size_t sz = stringLength(arg);
-    if (state.precision != State::None && state.precision < sz) {
-        assert(state.precision >= 0);
-        sz = state.precision;
-    }
-    int pad = 0;
-    if (state.width != State::None) {
-        assert(state.width >= 0);
-        pad = std::max<int>(0, state.width - sz);
+        print_put_field(state, writer, out, n, &extra, 1);
     }
+};
 
-    if (pad && !(state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
-    }
+struct PrintExpFormatter
+{
+    const State& state;
+    BufferWriter& writer;
+    bool upper;
 
-    writer.put(arg, sz);
+    template<typename T>
+    void operator()(T number) const
+    {
+        char extra = 0;
+        if (number >= 0) {
+            if (state.flags & State::Flag_Sign)
+                extra = '+';
+            else if (state.flags & State::Flag_Space)
+                extra = ' ';
+        } else {
+            extra = '-';
+            number = -number;
+        }
 
-    if (pad && (state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
+        char buffer[2048];
+        const uint32_t precision = state.precision == State::None ? 6 : state.precision;
+        const int n = upper ? print_exp_upper_n(number, precision, buffer) : print_exp_n(number, precision, buffer);
+        print_put_field(state, writer, buffer, n, &extra, 1);
     }
+};
 
-    return print_helper(state, writer, format, formatoff, std::forward<Args>(args)...);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<std::string, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_execute_str(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+struct PrintRoundTripFormatter
 {
-    size_t sz = arg.size();
-    if (state.precision != State::None && state.precision < sz) {
-        assert(state.precision >= 0);
-        sz = state.precision;
-    }
-    int pad = 0;
-    if (state.width != State::None) {
-        assert(state.width >= 0);
-        pad = std::max<int>(0, state.width - sz);
-    }
+    const State& state;
+    BufferWriter& writer;
 
-    if (pad && !(state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
-    }
-
-    writer.put(arg.c_str(), sz);
+    template<typename T>
+    void operator()(T number) const
+    {
+        char extra = 0;
+        if (!std::signbit(number)) {
+            if (state.flags & State::Flag_Sign)
+                extra = '+';
+            else if (state.flags & State::Flag_Space)
+                extra = ' ';
+        } else {
+            extra = '-';
+            number = -number;
+        }
 
-    if (pad && (state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
+        char buffer[PrintShortestBuffer];
+        const int n = print_format_shortest(number, state.flags & State::Flag_Prefix, buffer);
+        print_put_field(state, writer, buffer, n, &extra, 1);
     }
+};
 
-    return print_helper(state, writer, format, formatoff, std::forward<Args>(args)...);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<has_global_to_string<Arg>::value, void>::type* = nullptr>
-int print_execute_str(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+struct PrintHexFloatFormatter
 {
-    return print_execute_str(state, writer, format, formatoff, to_string(std::forward<Arg>(arg)), std::forward<Args>(args)...);
-}
+    const State& state;
+    BufferWriter& writer;
+    bool upper;
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<has_member_to_string_ref<Arg>::value, void>::type* = nullptr>
-int print_execute_str(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_execute_str(state, writer, format, formatoff, arg.to_string(), std::forward<Args>(args)...);
-}
+    template<typename T>
+    void operator()(T number) const
+    {
+        char prefix[3] = { 0, '0', upper ? 'X' : 'x' };
+        if (!std::signbit(number)) {
+            if (state.flags & State::Flag_Sign)
+                prefix[0] = '+';
+            else if (state.flags & State::Flag_Space)
+                prefix[0] = ' ';
+        } else {
+            prefix[0] = '-';
+            number = -number;
+        }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<has_member_to_string_ptr<Arg>::value, void>::type* = nullptr>
-int print_execute_str(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_execute_str(state, writer, format, formatoff, arg->to_string(), std::forward<Args>(args)...);
-}
+        auto hex = print_hex_float(number);
+        if (hex.special) {
+            char buffer[8];
+            const int n = strlen(hex.special);
+            memcpy(buffer, hex.special, n);
+            if (upper)
+                print_upper(buffer, n);
+            print_put_field(state, writer, buffer, n, prefix, 1);
+            return;
+        }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!is_stringish<Arg>::value, void>::type* = nullptr>
-int print_execute_str(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+        print_hex_round(hex, state.precision);
+        const bool alternate = state.flags & State::Flag_Prefix;
+        // the precision is capped at 200
+        char buffer[256];
+        const int n = print_hex_float_length(hex, alternate);
+        print_write_hex_float(buffer, hex, alternate, upper);
+        if (!prefix[0])
+            print_put_field(state, writer, buffer, n, prefix + 1, 2);
+        else
+            print_put_field(state, writer, buffer, n, prefix, 3);
+    }
+};
+
+static int print_format_store(BufferWriter& writer, const PrintArgument& arg)
 {
-    return print_error("Argument is not a stringish", state, format, formatoff);
+    if (arg.type != PrintArgument::IntPointer)
+        return print_error("Argument is not an int pointer");
+    *arg.iptr = static_cast<int>(writer.offset());
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_integral<Arg>::value, void>::type* = nullptr>
-int print_execute_ch(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static int print_format_str(const State& state, BufferWriter& writer, const PrintArgument& arg)
 {
-    typedef typename std::make_unsigned<typename std::decay<Arg>::type>::type UnsignedArgType;
-
-    const UnsignedArgType ch = static_cast<UnsignedArgType>(arg) % 256;
-
-    int pad = 0;
-    if (state.width != State::None) {
-        assert(state.width >= 0);
-        pad = std::max<int>(0, state.width - 1);
-    }
-
-    if (pad && !(state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
+    size_t sz;
+    const char* str;
+    switch (arg.type) {
+    case PrintArgument::CString:
+        str = arg.cstr;
+        sz = strlen(str);
+        break;
+    case PrintArgument::String:
+        str = arg.str.str;
+        sz = arg.str.len;
+        break;
+    default:
+        return print_error("Argument is not a stringish");
     }
-
-    writer.put(static_cast<char>(ch));
-
-    if (pad && (state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
+    if (state.precision != State::None && static_cast<size_t>(state.precision) < sz) {
+        assert(state.precision >= 0);
+        sz = state.precision;
     }
 
-    return print_helper(state, writer, format, formatoff, std::forward<Args>(args)...);
+    print_put_padded(state, writer, str, sz);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_integral<Arg>::value, void>::type* = nullptr>
-int print_execute_ch(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static int print_format_ch(const State& state, BufferWriter& writer, const PrintArgument& arg)
 {
-    return print_error("Argument is not a char", state, format, formatoff);
+    if (!print_is_integral(arg))
+        return print_error("Argument is not a char");
+
+    const char ch = static_cast<char>(print_unsigned(arg) % 256);
+    print_put_padded(state, writer, &ch, 1);
+    return 0;
 }
 
-template<typename Writer, typename Arg, typename ...Args>
-int print_execute(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
+static int print_format(const State& state, BufferWriter& writer, char specifier, const PrintArgument& arg)
 {
-    switch (format[formatoff]) {
+    switch (specifier) {
     case 'd':
     case 'i':
-        return print_execute_int_10<true>(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_int_10(state, writer, true, arg);
     case 'u':
-        return print_execute_int_10<false>(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_int_10(state, writer, false, arg);
     case 'o':
-        return print_execute_int_8(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_int_8(state, writer, arg);
+    case 'b':
+        return print_format_int_2(state, writer, arg);
     case 'x':
-        return print_execute_int_16(state, writer, format, formatoff + 1, "0123456789abcdefx", std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_int_16(state, writer, "0123456789abcdefx", arg);
     case 'X':
-        return print_execute_int_16(state, writer, format, formatoff + 1, "0123456789ABCDEFX", std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_int_16(state, writer, "0123456789ABCDEFX", arg);
     case 'f':
     case 'F':
-        return print_execute_float(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_visit_float(arg, PrintFixedFormatter { state, writer });
     case 'e':
-        return print_execute_float_exp(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
-    case 'g':
-        return print_execute_float_shortest(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_visit_float(arg, PrintExpFormatter { state, writer, false });
     case 'E':
+        return print_visit_float(arg, PrintExpFormatter { state, writer, true });
+    case 'g':
+        return print_visit_float(arg, PrintGeneralFormatter { state, writer, false });
+    case 'G':
+        return print_visit_float(arg, PrintGeneralFormatter { state, writer, true });
+    case 'r':
+        return print_visit_float(arg, PrintRoundTripFormatter { state, writer });
     case 'a':
+        return print_visit_float(arg, PrintHexFloatFormatter { state, writer, false });
     case 'A':
-    case 'G':
-        return print_error("E/a/A/G not implemented", state, format, formatoff);
+        return print_visit_float(arg, PrintHexFloatFormatter { state, writer, true });
     case 'c':
-        return print_execute_ch(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_ch(state, writer, arg);
     case 's':
-        return print_execute_str(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_str(state, writer, arg);
     case 'p':
-        return print_execute_ptr(state, writer, format, formatoff + 1, "0123456789abcdefx", std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_ptr(state, writer, "0123456789abcdefx", arg);
     case 'n':
-        return print_execute_store(state, writer, format, formatoff + 1, std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return print_format_store(writer, arg);
     default:
-        return print_error("Invalid specifier", state, format, formatoff);
+        return print_error("Invalid specifier");
     }
-    return print_helper(state, writer, format, formatoff + 1, std::forward<Args>(args)...);
 }
 
-template<typename Writer>
-int print_execute(State& state, Writer& writer, const char* format, size_t formatoff)
+static size_t print_parse_state(State& state, const char* format, size_t formatoff)
 {
-    return print_error("Not enough arguments", state, format, formatoff);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<int, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_get_precision_argument(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    state.precision = std::min<int>(arg, 200);
-    return print_execute(state, writer, format, formatoff, std::forward<Args>(args)...);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_same<int, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_get_precision_argument(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Invalid precision argument", state, format, formatoff);
-}
-
-template<typename Writer>
-int print_get_precision_argument(State& state, Writer& writer, const char* format, size_t formatoff)
-{
-    return print_error("No precision argument", state, format, formatoff);
-}
-
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<std::is_same<int, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_get_width_argument(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    state.width = std::min<int>(arg, 1024);
-    if (state.precision == State::Star) {
-        return print_get_precision_argument(state, writer, format, formatoff, std::forward<Args>(args)...);
+    // Flags
+    for (;; ++formatoff) {
+        switch (format[formatoff]) {
+        case '-':
+            state.flags |= State::Flag_LeftJustify;
+            continue;
+        case '+':
+            state.flags |= State::Flag_Sign;
+            continue;
+        case ' ':
+            state.flags |= State::Flag_Space;
+            continue;
+        case '#':
+            state.flags |= State::Flag_Prefix;
+            continue;
+        case '0':
+            state.flags |= State::Flag_ZeroPad;
+            continue;
+        case '\0':
+            return print_error("Zero termination encountered in flags extraction");
+        }
+        break;
     }
-    return print_execute(state, writer, format, formatoff, std::forward<Args>(args)...);
-}
 
-template<typename Writer, typename Arg, typename ...Args, typename std::enable_if<!std::is_same<int, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-int print_get_width_argument(State& state, Writer& writer, const char* format, size_t formatoff, Arg&& arg, Args&& ...args)
-{
-    return print_error("Invalid width argument", state, format, formatoff);
-}
+    // Width
+    const int mul = 10;
+    state.width = 0;
+    for (;; ++formatoff) {
+        if (format[formatoff] >= '0' && format[formatoff] <= '9') {
+            state.width *= mul;
+            state.width += format[formatoff] - '0';
+        } else if (format[formatoff] == '*') {
+            state.width = State::Star;
+            ++formatoff;
+            break;
+        } else if (format[formatoff] == '\0') {
+            return print_error("Zero termination encountered in width extraction");
+        } else {
+            state.width = std::min(state.width, 1024);
+            break;
+        }
+    }
 
-template<typename Writer>
-int print_get_width_argument(State& state, Writer& writer, const char* format, size_t formatoff)
-{
-    return print_error("No width argument", state, format, formatoff);
-}
+    // Precision
+    if (format[formatoff] == '.') {
+        ++formatoff;
+        state.precision = 0;
+        for (;; ++formatoff) {
+            if (format[formatoff] >= '0' && format[formatoff] <= '9') {
+                state.precision *= mul;
+                state.precision += format[formatoff] - '0';
+            } else if (format[formatoff] == '*') {
+                state.precision = State::Star;
+                ++formatoff;
+                break;
+            } else if (format[formatoff] == '\0') {
+                return print_error("Zero termination encountered in precision extraction");
+            } else {
+                state.precision = std::min(state.precision, 200);
+                break;
+            }
+        }
+    }
 
-template<typename Writer, typename ...Args>
-int print_get_length(State& state, Writer& writer, const char* format, size_t formatoff, Args&& ...args)
-{
+    // Length, the arguments carry their own size so it's skipped
     switch (format[formatoff]) {
     case 'h':
         ++formatoff;
-        if (format[formatoff + 1] == 'h')
+        if (format[formatoff] == 'h')
             ++formatoff;
         break;
     case 'l':
         ++formatoff;
-        if (format[formatoff + 1] == 'l')
+        if (format[formatoff] == 'l')
             ++formatoff;
         break;
     case 'j':
@@ -833,100 +928,43 @@ int print_get_length(State& state, Writer& writer, const char* format, size_t fo
         ++formatoff;
         break;
     case '\0':
-        return print_error("Zero termination encountered in length extraction", state, format, formatoff);
+        return print_error("Zero termination encountered in length extraction");
     }
 
-    if (state.width == State::Star) {
-        return print_get_width_argument(state, writer, format, formatoff, std::forward<Args>(args)...);
-    } else if (state.precision == State::Star) {
-        return print_get_precision_argument(state, writer, format, formatoff, std::forward<Args>(args)...);
-    } else {
-        return print_execute(state, writer, format, formatoff, std::forward<Args>(args)...);
-    }
-}
-
-template<typename Writer, typename ...Args>
-int print_get_precision(State& state, Writer& writer, const char* format, size_t formatoff, Args&& ...args)
-{
-    if (format[formatoff] != '.')
-        return print_get_length(state, writer, format, formatoff, std::forward<Args>(args)...);
-    ++formatoff;
-    state.precision = 0;
-    const int mul = 10;
-    for (;; ++formatoff) {
-        if (format[formatoff] >= '0' && format[formatoff] <= '9') {
-            state.precision *= mul;
-            state.precision += format[formatoff] - '0';
-        } else if (format[formatoff] == '*') {
-            state.precision = State::Star;
-            return print_get_length(state, writer, format, formatoff + 1, std::forward<Args>(args)...);
-        } else if (format[formatoff] == '\0') {
-            return print_error("Zero termination encountered in precision extraction", state, format, formatoff);
-        } else {
-            state.precision = std::min(state.precision, 200);
-            return print_get_length(state, writer, format, formatoff, std::forward<Args>(args)...);
-        }
-    }
+    return formatoff;
 }
 
-template<typename Writer, typename ...Args>
-int print_get_width(State& state, Writer& writer, const char* format, size_t formatoff, Args&& ...args)
-{
-    state.width = 0;
-    const int mul = 10;
-    for (;; ++formatoff) {
-        if (format[formatoff] >= '0' && format[formatoff] <= '9') {
-            state.width *= mul;
-            state.width += format[formatoff] - '0';
-        } else if (format[formatoff] == '*') {
-            state.width = State::Star;
-            return print_get_precision(state, writer, format, formatoff + 1, std::forward<Args>(args)...);
-        } else if (format[formatoff] == '\0') {
-            return print_error("Zero termination encountered in width extraction", state, format, formatoff);
-        } else {
-            state.width = std::min(state.width, 1024);
-            return print_get_precision(state, writer, format, formatoff, std::forward<Args>(args)...);
-        }
-    }
-}
-
-template<typename Writer, typename ...Args>
-int print_get_flags(State& state, Writer& writer, const char* format, size_t formatoff, Args&& ...args)
-{
-    for (;; ++formatoff) {
-        switch (format[formatoff]) {
-        case '-':
-            state.flags |= State::Flag_LeftJustify;
-            break;
-        case '+':
-            state.flags |= State::Flag_Sign;
-            break;
-        case ' ':
-            state.flags |= State::Flag_Space;
-            break;
-        case '#':
-            state.flags |= State::Flag_Prefix;
-            break;
-        case '0':
-            state.flags |= State::Flag_ZeroPad;
-            break;
-        case '\0':
-            return print_error("Zero termination encountered in flags extraction", state, format, formatoff);
-        default:
-            return print_get_width(state, writer, format, formatoff, std::forward<Args>(args)...);
-        }
-    }
-}
-
-template<typename Writer, typename ...Args>
-int print_helper(State& state, Writer& writer, const char* format, size_t formatoff, Args&& ...args)
+// the one loop every call signature shares
+int print_flat(BufferWriter& writer, const char* format, const PrintArgument* args, size_t count)
 {
+    State state;
+    size_t formatoff = 0;
+    size_t argno = 0;
     for (;;) {
         switch (format[formatoff]) {
         case '%':
             clearState(state);
             if (format[formatoff + 1] != '%') {
-                return print_get_flags(state, writer, format, formatoff + 1, std::forward<Args>(args)...);
+                formatoff = print_parse_state(state, format, formatoff + 1);
+                if (state.width == State::Star) {
+                    if (argno == count)
+                        return print_error("No width argument");
+                    const PrintArgument& arg = args[argno++];
+                    if (arg.type != PrintArgument::Signed || arg.bytes != sizeof(int))
+                        return print_error("Invalid width argument");
+                    state.width = std::min<int>(arg.i, 1024);
+                }
+                if (state.precision == State::Star) {
+                    if (argno == count)
+                        return print_error("No precision argument");
+                    const PrintArgument& arg = args[argno++];
+                    if (arg.type != PrintArgument::Signed || arg.bytes != sizeof(int))
+                        return print_error("Invalid precision argument");
+                    state.precision = std::min<int>(arg.i, 200);
+                }
+                if (argno == count)
+                    return print_error("Not enough arguments");
+                print_format(state, writer, format[formatoff++], args[argno++]);
             } else {
                 writer.put(format[++formatoff]);
                 ++formatoff;
@@ -934,27 +972,172 @@ int print_helper(State& state, Writer& writer, const char* format, size_t format
             break;
         case '\0':
             return writer.terminate();
-        default:
-            writer.put(format[formatoff++]);
-            break;
+        default: {
+            const char* end = print_scan_literal(format + formatoff);
+            writer.put(format + formatoff, end - (format + formatoff));
+            formatoff = end - format;
+            break; }
         }
     }
 }
 
+// When output staged for a file descriptor is handed to the OS. Line
+// flushes every call that wrote a newline, Size once flushSize bytes are
+// staged and Explicit only on print_flush. Output for another descriptor,
+// a full staging buffer or the thread exiting flush regardless.
+enum PrintFlush
+{
+    PrintFlush_Line,
+    PrintFlush_Size,
+    PrintFlush_Explicit
+};
+
+struct PrintFd
+{
+    PrintFd(int f, PrintFlush p = PrintFlush_Line, size_t s = 16384)
+        : fd(f), flush(p), flushSize(s)
+    {
+    }
+
+    int fd;
+    PrintFlush flush;
+    size_t flushSize;
+};
+
+// What the calling thread has formatted for fd and not written yet
+struct PrintStaging
+{
+    PrintStaging()
+        : fd(-1), size(0), capacity(0)
+    {
+    }
+    ~PrintStaging()
+    {
+        flush();
+    }
+
+    bool flush()
+    {
+        bool ok = true;
+        size_t off = 0;
+        while (off < size) {
+            const ssize_t w = ::write(fd, buffer.get() + off, size - off);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                ok = false;
+                break;
+            }
+            off += w;
+        }
+        size = 0;
+        return ok;
+    }
+
+    // only called with nothing staged
+    void reserve(size_t n)
+    {
+        if (n > capacity) {
+            buffer.reset(new char[n]);
+            capacity = n;
+        }
+    }
+
+    int fd;
+    std::unique_ptr<char[]> buffer;
+    size_t size;
+    size_t capacity;
+};
+
+static thread_local PrintStaging print_staging;
+
+// Formats straight into the thread's staging buffer and hands it to the
+// descriptor with one write(2) per flush instead of a locked stdio call per
+// fragment
+int print_fd(const PrintFd& target, const char* format, const PrintArgument* args, size_t count)
+{
+    PrintStaging& staging = print_staging;
+    bool ok = true;
+    if (staging.fd != target.fd || staging.size == staging.capacity) {
+        ok = staging.flush();
+        staging.fd = target.fd;
+        staging.reserve(std::max<size_t>(target.flushSize, 4096));
+    }
+
+    size_t start = staging.size;
+    BufferWriter writer(staging.buffer.get() + start, staging.capacity - start);
+    const size_t n = print_flat(writer, format, args, count);
+    if (n >= staging.capacity - start) {
+        // didn't fit, write out what was there before and format again
+        ok = staging.flush() && ok;
+        staging.reserve(n + 1);
+        BufferWriter retry(staging.buffer.get(), staging.capacity);
+        print_flat(retry, format, args, count);
+        start = 0;
+    }
+    staging.size = start + n;
+
+    switch (target.flush) {
+    case PrintFlush_Line:
+        if (memchr(staging.buffer.get() + start, '\n', n))
+            ok = staging.flush() && ok;
+        break;
+    case PrintFlush_Size:
+        if (staging.size >= target.flushSize)
+            ok = staging.flush() && ok;
+        break;
+    case PrintFlush_Explicit:
+        break;
+    }
+    return ok ? n : -1;
+}
+
+// writes out what the calling thread has staged, 0 on success or -1
+int print_flush()
+{
+    return print_staging.flush() ? 0 : -1;
+}
+
+// formats into a stack buffer and only goes to the heap for long output
+int print_file(FILE* file, const char* format, const PrintArgument* args, size_t count)
+{
+    char stack[1024];
+    BufferWriter writer(stack, sizeof(stack));
+    const size_t n = print_flat(writer, format, args, count);
+    if (n < sizeof(stack)) {
+        fwrite(stack, 1, n, file);
+        return n;
+    }
+
+    std::unique_ptr<char[]> heap(new char[n + 1]);
+    BufferWriter heapWriter(heap.get(), n + 1);
+    print_flat(heapWriter, format, args, count);
+    fwrite(heap.get(), 1, n, file);
+    return n;
+}
+
 template<typename ...Args>
 int snprint(char* buffer, size_t size, const char* format, Args&& ...args)
 {
-    State state;
     BufferWriter writer(buffer, size);
-    return print_helper(state, writer, format, 0, std::forward<Args>(args)...);
+    return print_flat(writer, format, print_arguments(print_stringify(std::forward<Args>(args))...).data(), sizeof...(Args));
 }
 
+// print goes through stdout with one fwrite per call so it stays in order
+// with printf and anything else using stdio
 template<typename ...Args>
 int print(const char* format, Args&& ...args)
 {
-    State state;
-    FileWriter writer(stdout);
-    return print_helper(state, writer, format, 0, std::forward<Args>(args)...);
+    return print_file(stdout, format, print_arguments(print_stringify(std::forward<Args>(args))...).data(), sizeof...(Args));
+}
+
+// dprint bypasses stdio, output staged for STDOUT_FILENO isn't ordered
+// against stdout's buffer. fflush(stdout) before dprint to it and
+// print_flush before going back to printf or print.
+template<typename ...Args>
+int dprint(const PrintFd& target, const char* format, Args&& ...args)
+{
+    return print_fd(target, format, print_arguments(print_stringify(std::forward<Args>(args))...).data(), sizeof...(Args));
 }
 
 struct Foobar
@@ -1005,12 +1188,122 @@ class Foobar3
     }
 };
 
+// A corpus of distinct call signatures, four arguments each picked from
+// five types, to see what code size and throughput look like with many
+// call sites instead of one hot one
+template<int Kind> struct CorpusType;
+template<> struct CorpusType<0> { static const char* spec() { return "%d "; } static int value(int i) { return i; } };
+template<> struct CorpusType<1> { static const char* spec() { return "%u "; } static unsigned value(int i) { return i * 7u; } };
+template<> struct CorpusType<2> { static const char* spec() { return "%f "; } static double value(int i) { return i * 0.25; } };
+template<> struct CorpusType<3> { static const char* spec() { return "%s "; } static const char* value(int i) { return i & 1 ? "odd" : "even"; } };
+template<> struct CorpusType<4> { static const char* spec() { return "%ld "; } static int64_t value(int i) { return i * -1000000007LL; } };
+
+enum { CorpusSize = 200 };
+
+template<int N>
+int corpusCall(char* buffer, size_t size, int i)
+{
+    typedef CorpusType<N % 5> A;
+    typedef CorpusType<N / 5 % 5> B;
+    typedef CorpusType<N / 25 % 5> C;
+    typedef CorpusType<N / 125 % 5> D;
+    static const std::string format = std::string(A::spec()) + B::spec() + C::spec() + D::spec() + "\n";
+    return snprint(buffer, size, format.c_str(), A::value(i), B::value(i), C::value(i), D::value(i));
+}
+
+typedef int (*CorpusCall)(char* buffer, size_t size, int i);
+
+template<std::size_t... Is>
+const CorpusCall* corpusCalls(detail::index_sequence<Is...>)
+{
+    static const CorpusCall calls[] = { corpusCall<Is>... };
+    return calls;
+}
+
+static void benchCorpus()
+{
+    const CorpusCall* calls = corpusCalls(detail::make_index_sequence<CorpusSize>());
+
+    enum { Rounds = 2000 };
+    char buffer[256];
+    int sink = 0;
+
+    auto t1 = steady_clock::now();
+    for (int r = 0; r < Rounds; ++r) {
+        for (int n = 0; n < CorpusSize; ++n)
+            sink += calls[n](buffer, sizeof(buffer), r);
+    }
+    auto t2 = steady_clock::now();
+
+    printf("%d signatures, me   %f (%d)\n", static_cast<int>(CorpusSize),
+           duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Rounds * CorpusSize), sink & 1);
+}
+
+// Lines through the thread's staging buffer against fprintf, all to
+// /dev/null, and once to a temporary file that is read back
+static void benchFd()
+{
+    char path[] = "/tmp/printfdXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1)
+        return;
+    unlink(path);
+
+    std::string expected;
+    char buffer[256];
+    for (int i = 0; i < 5000; ++i) {
+        dprint(PrintFd(fd, i % 3 ? PrintFlush_Size : PrintFlush_Line, 4096), "line %d of %s: %f\n", i, "benchFd", i * 0.5);
+        expected.append(buffer, snprintf(buffer, sizeof(buffer), "line %d of %s: %f\n", i, "benchFd", i * 0.5));
+    }
+    print_flush();
+
+    std::string written(expected.size() + 1, '\0');
+    const ssize_t r = pread(fd, &written[0], written.size(), 0);
+    close(fd);
+    written.resize(r < 0 ? 0 : r);
+    if (written != expected) {
+        printf("fd verify failed (%zu,%zu)\n", written.size(), expected.size());
+        return;
+    }
+
+    const int null = open("/dev/null", O_WRONLY);
+    FILE* file = fdopen(dup(null), "w");
+
+    enum { Iter = 200000 };
+
+    const PrintFd targets[2] = { PrintFd(null, PrintFlush_Line), PrintFd(null, PrintFlush_Size) };
+    double deltas[2];
+    for (int p = 0; p < 2; ++p) {
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i)
+            dprint(targets[p], "line %d of %s: %f\n", i, "benchFd", i * 0.5);
+        print_flush();
+        auto t2 = steady_clock::now();
+        deltas[p] = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+    }
+
+    auto t3 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i)
+        fprintf(file, "line %d of %s: %f\n", i, "benchFd", i * 0.5);
+    fflush(file);
+    auto t4 = steady_clock::now();
+    const double delta3 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+    fclose(file);
+    close(null);
+
+    printf("fd lines, me (line) %f\n", deltas[0]);
+    printf("fd lines, me (size) %f\n", deltas[1]);
+    printf("fd lines, them      %f\n", delta3);
+}
+
 int main(int, char**)
 {
     // char buf[1024];
     Foobar foobar("abc", 123);
     Foobar2 foobar3("trall", 42);
     print("hello '%.*s' '%s' '%10.7s' %f\n", 2, "trakk", foobar, foobar3, 1.234);
+    print("%a %A %-10E| %La %010a\n", 0.1, -1.0 / 3.0, 6.02214076e23, 0.1L, 1.0);
     // printf("%d -> '%s'\n", i, buf);
     //const int i = snprint(buf, sizeof(buf), "hello %s\n", "hello");
 
@@ -1065,5 +1358,8 @@ int main(int, char**)
         printf("verify failed at %d (%d,%d) - (%d,%d)\n", off, fn1, fn2, r1, r2);
     }
 
+    benchCorpus();
+    benchFd();
+
     return 0;
 }
@@ -1,5 +1,19 @@
 #include "print2.h"
+#include "print_float.h"
+#include "print_scan.h"
+#include <algorithm>
 #include <chrono>
+#include <fcntl.h>
+#include <limits>
+#include <math.h>
+#include <random>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace std::chrono;
 
@@ -51,18 +65,1284 @@ class Foobar3
     }
 };
 
-int main(int, char**)
+#define LONG_LITERAL_FORMAT                                                               \
+    "request from the client was accepted on the public listener and queued for the "     \
+    "worker pool, the queue depth is now %d and the pool reported status '%s' right after " \
+    "the last rebalance finished without errors\n"
+
+static bool benchLongLiterals()
+{
+    char buffer1[1024];
+    char buffer2[1024];
+    int r1 = 0, r2 = 0;
+
+    enum { Iter = 100000 };
+
+    auto t1 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i) {
+        r1 = snprint2(buffer1, sizeof(buffer1), LONG_LITERAL_FORMAT, i, "healthy");
+    }
+
+    auto t2 = steady_clock::now();
+    double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+    auto t3 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i) {
+        r2 = snprintf(buffer2, sizeof(buffer2), LONG_LITERAL_FORMAT, i, "healthy");
+    }
+
+    auto t4 = steady_clock::now();
+    double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+    if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+        printf("long literal verify failed (%d,%d)\n", r1, r2);
+        return false;
+    }
+
+    printf("long literals, me   %f\n", delta1);
+    printf("long literals, them %f\n", delta2);
+    return true;
+}
+
+// Every print_scan_literal kernel up to what the CPU has, each has to find the
+// same '%' or terminator from every alignment. RYU_SIMD caps the level the
+// library itself picks.
+static bool benchScanKernels()
+{
+    static const char* names[] = { "generic", "sse2", "avx2", "avx512" };
+    const ryu_simd level = ryu_simd_level();
+
+    enum { Size = 4096, Iter = 20000 };
+    std::vector<char> text(Size + 64, 'x');
+    std::mt19937 random(17);
+    for (int i = 0; i < Size; i += 1 + random() % 200)
+        text[i] = '%';
+    text[Size] = '\0';
+
+    for (int kernel = RYU_SIMD_GENERIC; kernel <= level; ++kernel) {
+        const PrintScanLiteral scan = print_scan_literal_kernel(static_cast<ryu_simd>(kernel));
+        for (int i = 0; i < Size; ++i) {
+            if (scan(text.data() + i) != print_scan_literal_generic(text.data() + i)) {
+                printf("scan verify failed for %s at %d\n", names[kernel], i);
+                return false;
+            }
+        }
+
+        const char* end = nullptr;
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            // a literal run of up to a few hundred bytes from each offset
+            end = scan(text.data() + (i & 1023));
+        }
+
+        auto t2 = steady_clock::now();
+        double delta = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+        printf("scan %-8s %f (%d)\n", names[kernel], delta, end != nullptr);
+    }
+    printf("scan selected %s\n", names[level]);
+    return true;
+}
+
+// A response body built from many fragments. A reused Print2Formatter and a
+// std::vector<char> are appended to, against snprintf into a scratch buffer
+// that is appended to a std::string. The last fragment is longer than the
+// writer's first window so it has to grow, after the first round the
+// formatter's capacity has to stay put.
+static bool benchAppend()
+{
+    const std::string longValue(1500, 'x');
+
+    Print2Formatter formatter;
+    std::vector<char> vec;
+    std::string them;
+    char scratch[2048];
+
+    enum { Iter = 20000, Fragments = 24 };
+
+    size_t capacity = 0;
+    bool ok = true;
+    double delta1 = 0, delta2 = 0;
+    for (int round = 0; round < 2 && ok; ++round) {
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            formatter.clear();
+            for (int f = 0; f < Fragments; ++f)
+                SPRINT2(formatter, "<tr><td>%d</td><td>%s</td><td>%.3f</td></tr>\n", i + f, "request", f * 0.125);
+            SPRINT2(formatter, "%s|%f\n", longValue, 1e30);
+        }
+        auto t2 = steady_clock::now();
+        delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+        auto t3 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            them.clear();
+            for (int f = 0; f < Fragments; ++f)
+                them.append(scratch, snprintf(scratch, sizeof(scratch), "<tr><td>%d</td><td>%s</td><td>%.3f</td></tr>\n", i + f, "request", f * 0.125));
+            them.append(scratch, snprintf(scratch, sizeof(scratch), "%s|%f\n", longValue.c_str(), 1e30));
+        }
+        auto t4 = steady_clock::now();
+        delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+        vec.clear();
+        for (int f = 0; f < Fragments; ++f)
+            sprint2(vec, "<tr><td>%d</td><td>%s</td><td>%.3f</td></tr>\n", Iter - 1 + f, "request", f * 0.125);
+        sprint2(vec, "%s|%f\n", longValue, 1e30);
+
+        if (formatter.str() != them || std::string(vec.begin(), vec.end()) != them) {
+            printf("append verify failed (%zu,%zu,%zu)\n", formatter.size(), vec.size(), them.size());
+            ok = false;
+        } else if (round && formatter.capacity() != capacity) {
+            printf("append capacity changed (%zu,%zu)\n", capacity, formatter.capacity());
+            ok = false;
+        }
+        capacity = formatter.capacity();
+    }
+
+    if (ok) {
+        printf("append %d fragments, me   %f\n", Fragments + 1, delta1);
+        printf("append %d fragments, them %f\n", Fragments + 1, delta2);
+    }
+    return ok;
+}
+
+// Lines written to a file descriptor through the thread's staging buffer,
+// checked against snprintf by reading a temporary file back, then timed
+// against fprintf going to /dev/null.
+static bool benchFd()
+{
+    char path[] = "/tmp/print2fdXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1) {
+        printf("fd verify failed, no temporary file\n");
+        return false;
+    }
+    unlink(path);
+
+    std::string expected;
+    char buffer[256];
+    for (int i = 0; i < 5000; ++i) {
+        const Print2Fd target(fd, i % 3 ? Print2Flush_Size : Print2Flush_Line, 4096);
+        const int r1 = dprint2(target, "line %d of %s: %.3f\n", i, "benchFd", i * 0.5);
+        const int r2 = snprintf(buffer, sizeof(buffer), "line %d of %s: %.3f\n", i, "benchFd", i * 0.5);
+        if (r1 != r2) {
+            printf("fd verify failed at %d (%d,%d)\n", i, r1, r2);
+            close(fd);
+            return false;
+        }
+        expected.append(buffer, r2);
+    }
+    dprint2(Print2Fd(fd, Print2Flush_Explicit), "%s", "explicit\n");
+    expected += "explicit\n";
+    print2_flush();
+
+    std::string written(expected.size() + 1, '\0');
+    const ssize_t r = pread(fd, &written[0], written.size(), 0);
+    close(fd);
+    written.resize(r < 0 ? 0 : r);
+    if (written != expected) {
+        printf("fd verify failed (%zu,%zu)\n", written.size(), expected.size());
+        return false;
+    }
+
+    const int null = open("/dev/null", O_WRONLY);
+    FILE* file = fdopen(dup(null), "w");
+
+    enum { Iter = 200000 };
+
+    double deltas[2];
+    const Print2Flush policies[2] = { Print2Flush_Line, Print2Flush_Size };
+    for (int p = 0; p < 2; ++p) {
+        const Print2Fd target(null, policies[p]);
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i)
+            DPRINT2(target, "line %d of %s: %.3f\n", i, "benchFd", i * 0.5);
+        print2_flush();
+        auto t2 = steady_clock::now();
+        deltas[p] = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+    }
+
+    auto t3 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i)
+        fprintf(file, "line %d of %s: %.3f\n", i, "benchFd", i * 0.5);
+    fflush(file);
+    auto t4 = steady_clock::now();
+    double delta3 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+    fclose(file);
+    close(null);
+
+    printf("fd lines, me (line) %f\n", deltas[0]);
+    printf("fd lines, me (size) %f\n", deltas[1]);
+    printf("fd lines, them      %f\n", delta3);
+    return true;
+}
+
+// Long %s arguments written with writev straight from the argument against
+// formatting a copy into the staging buffer and writing that, both to
+// /dev/null so what's left is the copy. Checked against snprintf first.
+static bool benchGather()
+{
+    char path[] = "/tmp/print2gatherXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1) {
+        printf("gather verify failed, no temporary file\n");
+        return false;
+    }
+    unlink(path);
+
+    std::string payload;
+    for (int i = 0; i < 20000; ++i)
+        payload += static_cast<char>('a' + i % 26);
+
+    std::string expected;
+    std::vector<char> buffer(payload.size() * 2 + 256);
+    const size_t sizes[] = { 0, 10, 4095, 4096, 5000, 20000 };
+    for (int i = 0; i < 600; ++i) {
+        const std::string arg = payload.substr(0, sizes[i % 6]);
+        const Print2Fd target(fd, i % 4 ? Print2Flush_Gather : Print2Flush_Size, 8192, i % 8 < 4 ? 4096 : 0);
+        const int width = i % 3 ? 0 : static_cast<int>(arg.size()) + 7;
+        const char* format = i % 2 ? "%d <%*s> %.3f %s|\n" : "%d <%-*s> %.3f %s|\n";
+        const int r1 = dprint2(target, format, i, width, arg, i * 0.25, arg.c_str());
+        const int r2 = snprintf(buffer.data(), buffer.size(), format, i, width, arg.c_str(), i * 0.25, arg.c_str());
+        if (r1 != r2) {
+            printf("gather verify failed at %d (%d,%d)\n", i, r1, r2);
+            close(fd);
+            return false;
+        }
+        expected.append(buffer.data(), r2);
+    }
+    print2_flush();
+
+    std::string written(expected.size() + 1, '\0');
+    const ssize_t r = pread(fd, &written[0], written.size(), 0);
+    close(fd);
+    written.resize(r < 0 ? 0 : r);
+    if (written != expected) {
+        printf("gather verify failed (%zu,%zu)\n", written.size(), expected.size());
+        return false;
+    }
+
+    const int null = open("/dev/null", O_WRONLY);
+    const size_t payloads[] = { 64, 1024, 16 * 1024, 256 * 1024, 1024 * 1024 };
+    printf("gather payload    copy      writev    writev (>= 4K)\n");
+    for (size_t size : payloads) {
+        const std::string arg(size, 'x');
+        const int iter = static_cast<int>(std::min<size_t>(200000, (256u << 20) / size));
+        const Print2Fd targets[3] = {
+            Print2Fd(null, Print2Flush_Size, 0),
+            Print2Fd(null, Print2Flush_Gather, 16384, 0),
+            Print2Fd(null, Print2Flush_Gather)
+        };
+        double deltas[3];
+        for (int t = 0; t < 3; ++t) {
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < iter; ++i)
+                DPRINT2(targets[t], "record %d (%zu bytes): %s\n", i, size, arg);
+            auto t2 = steady_clock::now();
+            deltas[t] = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(iter);
+        }
+        printf("gather %-8zu  %-9.1f %-9.1f %.1f\n", size, deltas[0], deltas[1], deltas[2]);
+    }
+    close(null);
+    return true;
+}
+
+// Lines written through a Print2Sink with either backend to a file opened
+// normally and one opened O_APPEND, which has to keep one write in flight,
+// checked against snprintf. Then sustained throughput and the p99 of a
+// single call against formatting and writing synchronously.
+static bool checkSink(Print2SinkBackend backend, bool append)
+{
+    char path[] = "/tmp/print2sinkXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1) {
+        printf("sink verify failed, no temporary file\n");
+        return false;
+    }
+    unlink(path);
+    if (append)
+        fcntl(fd, F_SETFL, O_APPEND);
+
+    // small buffers so calls straddle them and some don't fit in one at all
+    Print2Sink* sink = print2_sink_open(fd, Print2SinkOptions(1024, 4, 2, backend));
+    if (!sink) {
+        close(fd);
+        printf("sink %d unavailable\n", backend);
+        return backend == Print2Sink_Uring;
+    }
+
+    const std::string big(3000, 'z');
+    std::string expected;
+    char buffer[4096];
+    bool ok = true;
+    for (int i = 0; i < 20000 && ok; ++i) {
+        const char* str = i % 97 ? "sink" : big.c_str();
+        const int r1 = APRINT2(sink, "line %d of %s: %.3f\n", i, str, i * 0.5);
+        const int r2 = snprintf(buffer, sizeof(buffer), "line %d of %s: %.3f\n", i, str, i * 0.5);
+        if (r1 != r2) {
+            printf("sink verify failed at %d (%d,%d)\n", i, r1, r2);
+            ok = false;
+        }
+        expected.append(buffer, r2);
+        if (i == 10000)
+            ok = print2_sink_flush(sink) == 0;
+    }
+    const Print2SinkBackend used = print2_sink_backend(sink);
+    ok = print2_sink_close(sink) == 0 && ok;
+
+    std::string written(expected.size() + 1, '\0');
+    const off_t position = lseek(fd, 0, SEEK_CUR);
+    const ssize_t r = pread(fd, &written[0], written.size(), 0);
+    close(fd);
+    written.resize(r < 0 ? 0 : r);
+    if (!ok || written != expected || position != static_cast<off_t>(expected.size())) {
+        printf("sink verify failed %d %d (%zu,%zu,%ld)\n", used, append, written.size(), expected.size(), static_cast<long>(position));
+        return false;
+    }
+    return true;
+}
+
+// one line per call to fd, the time each call took goes in latencies.
+// stalling makes a reader drain fd and stop for 1ms after every 1MB,
+// standing in for write(2) blocking when writeback falls behind.
+static bool benchSinkRun(const char* name, Print2SinkBackend backend, bool stalling, std::vector<uint32_t>& latencies)
+{
+    int fds[2];
+    if (stalling) {
+        if (pipe(fds))
+            return false;
+    } else {
+        char path[] = "/tmp/print2sinkXXXXXX";
+        fds[1] = mkstemp(path);
+        if (fds[1] == -1)
+            return false;
+        unlink(path);
+    }
+
+    // the backend is probed before the reader exists, there's nothing to
+    // join if it isn't there
+    Print2Sink* sink = nullptr;
+    if (backend != Print2Sink_Auto) {
+        sink = print2_sink_open(fds[1], Print2SinkOptions(65536, 8, 2, backend));
+        if (!sink) {
+            printf("sink %-6s unavailable\n", name);
+            close(fds[1]);
+            if (stalling)
+                close(fds[0]);
+            return true;
+        }
+    }
+
+    std::thread reader;
+    if (stalling) {
+        reader = std::thread([&fds]() {
+            std::vector<char> buffer(65536);
+            size_t total = 0;
+            for (;;) {
+                const ssize_t r = read(fds[0], buffer.data(), buffer.size());
+                if (r <= 0)
+                    break;
+                total += r;
+                if (total >= (1u << 20)) {
+                    total = 0;
+                    usleep(1000);
+                }
+            }
+        });
+    }
+    const Print2Fd target(fds[1], Print2Flush_Size, 65536);
+
+    const int iter = static_cast<int>(latencies.size());
+    auto t1 = steady_clock::now();
+    for (int i = 0; i < iter; ++i) {
+        auto c1 = steady_clock::now();
+        if (sink)
+            APRINT2(sink, "request %d from %s took %.3f ms\n", i, "10.0.0.1", i * 0.001);
+        else
+            DPRINT2(target, "request %d from %s took %.3f ms\n", i, "10.0.0.1", i * 0.001);
+        auto c2 = steady_clock::now();
+        latencies[i] = static_cast<uint32_t>(duration_cast<nanoseconds>(c2 - c1).count());
+    }
+    if (sink)
+        print2_sink_close(sink);
+    else
+        print2_flush();
+    auto t2 = steady_clock::now();
+    close(fds[1]);
+    if (stalling) {
+        reader.join();
+        close(fds[0]);
+    }
+
+    const double seconds = duration_cast<nanoseconds>(t2 - t1).count() / 1e9;
+    const long slow = std::count_if(latencies.begin(), latencies.end(), [](uint32_t latency) { return latency > 100000; });
+    std::nth_element(latencies.begin(), latencies.begin() + iter / 100 * 99, latencies.end());
+    const uint32_t p99 = latencies[iter / 100 * 99];
+    std::nth_element(latencies.begin(), latencies.begin() + iter / 1000 * 999, latencies.end());
+    const uint32_t p999 = latencies[iter / 1000 * 999];
+    const uint32_t worst = *std::max_element(latencies.begin(), latencies.end());
+    printf("sink %-6s %-5s %.2f Mlines/s, p99 %u ns, p99.9 %u ns, max %u ns, %ld calls > 100us\n", name, stalling ? "stall" : "file",
+           iter / seconds / 1e6, p99, p999, worst, slow);
+    return true;
+}
+
+static bool benchSink()
+{
+    for (Print2SinkBackend backend : { Print2Sink_Uring, Print2Sink_Thread }) {
+        if (!checkSink(backend, false) || !checkSink(backend, true))
+            return false;
+    }
+
+    std::vector<uint32_t> latencies(2000000);
+    for (bool stalling : { false, true }) {
+        if (!benchSinkRun("sync", Print2Sink_Auto, stalling, latencies)
+            || !benchSinkRun("uring", Print2Sink_Uring, stalling, latencies)
+            || !benchSinkRun("thread", Print2Sink_Thread, stalling, latencies))
+            return false;
+    }
+    return true;
+}
+
+// A log written through Print2MapSink with small chunks so messages cross
+// windows, some bigger than a chunk, closed, continued and read back. Then a
+// child that kills itself mid-log, what it committed has to be recoverable.
+// Then the time per line against formatting and writing synchronously.
+static bool benchMap()
+{
+    char path[] = "/tmp/print2mapXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1) {
+        printf("map verify failed, no temporary file\n");
+        return false;
+    }
+    close(fd);
+
+    const std::string big(40000, 'm');
+    std::string expected;
+    char buffer[65536];
+    bool ok = true;
+    for (int run = 0; run < 2 && ok; ++run) {
+        Print2MapSink* sink = print2_map_open(path, 16384);
+        if (!sink) {
+            printf("map verify failed, can't open\n");
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < 20000 && ok; ++i) {
+            const char* str = i % 113 ? "map" : big.c_str();
+            const int r1 = MPRINT2(sink, "line %d of %s: %.3f\n", i, str, i * 0.5);
+            const int r2 = snprintf(buffer, sizeof(buffer), "line %d of %s: %.3f\n", i, str, i * 0.5);
+            if (r1 != r2) {
+                printf("map verify failed at %d (%d,%d)\n", i, r1, r2);
+                ok = false;
+            }
+            expected.append(buffer, r2);
+        }
+        ok = print2_map_close(sink) == 0 && ok;
+    }
+    std::string recovered;
+    struct stat st;
+    if (!ok || !print2_map_recover(path, recovered) || recovered != expected
+        || stat(path, &st) || st.st_size != static_cast<off_t>(expected.size() + 4096)) {
+        printf("map verify failed (%zu,%zu)\n", recovered.size(), expected.size());
+        unlink(path);
+        return false;
+    }
+    unlink(path);
+
+    const pid_t child = fork();
+    if (child == 0) {
+        Print2MapSink* sink = print2_map_open(path, 16384);
+        for (int i = 0; i < 5000; ++i)
+            MPRINT2(sink, "line %d before the crash\n", i);
+        kill(getpid(), SIGKILL);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    expected.clear();
+    for (int i = 0; i < 5000; ++i)
+        expected += std::string("line ") + std::to_string(i) + " before the crash\n";
+    recovered.clear();
+    ok = print2_map_recover(path, recovered) && recovered == expected;
+    unlink(path);
+    if (!WIFSIGNALED(status) || !ok) {
+        printf("map crash recovery failed (%zu,%zu)\n", recovered.size(), expected.size());
+        return false;
+    }
+
+    enum { Iter = 2000000 };
+    double deltas[3];
+    for (int k = 0; k < 3; ++k) {
+        strcpy(path, "/tmp/print2mapXXXXXX");
+        const int out = mkstemp(path);
+        if (out == -1)
+            return false;
+        Print2MapSink* sink = k == 2 ? print2_map_open(path) : nullptr;
+        const Print2Fd target(out, k ? Print2Flush_Size : Print2Flush_Line, 65536);
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            if (sink)
+                MPRINT2(sink, "request %d from %s took %.3f ms\n", i, "10.0.0.1", i * 0.001);
+            else
+                DPRINT2(target, "request %d from %s took %.3f ms\n", i, "10.0.0.1", i * 0.001);
+        }
+        if (sink)
+            print2_map_close(sink);
+        else
+            print2_flush();
+        auto t2 = steady_clock::now();
+        deltas[k] = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+        close(out);
+        unlink(path);
+    }
+    printf("map lines, fd (line) %f\n", deltas[0]);
+    printf("map lines, fd (size) %f\n", deltas[1]);
+    printf("map lines, me        %f\n", deltas[2]);
+    return true;
+}
+
+static bool benchIntegers()
+{
+    char buffer1[64];
+    char buffer2[64];
+
+    enum { Iter = 1000000 };
+
+    uint64_t value = 0;
+    for (int digits = 1; digits <= 20; ++digits) {
+        value = value * 10 + ("12345678901234567890"[digits - 1] - '0');
+        int r1 = 0, r2 = 0;
+
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            r1 = snprint2(buffer1, sizeof(buffer1), "%u", value);
+        }
+
+        auto t2 = steady_clock::now();
+        double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+        auto t3 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            r2 = snprintf(buffer2, sizeof(buffer2), "%llu", static_cast<unsigned long long>(value));
+        }
+
+        auto t4 = steady_clock::now();
+        double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+        if (r1 != r2 || r1 != digits || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+            printf("integer verify failed at %d digits (%d,%d)\n", digits, r1, r2);
+            return false;
+        }
+
+        printf("%2d digits, me %f them %f\n", digits, delta1, delta2);
+    }
+    return true;
+}
+
+static bool benchFixed()
+{
+    char buffer1[512];
+    char buffer2[512];
+
+    enum { Iter = 1000000 };
+
+    const double values[] = { 0.0, 1.5, -273.15, 0.000123456789, 6.02214076e23, 1e300 };
+    const char* formats[] = { "%f", "%.2f", "%12.3e" };
+
+    for (const char* format : formats) {
+        for (double value : values) {
+            int r1 = 0, r2 = 0;
+
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r1 = snprint2(buffer1, sizeof(buffer1), format, value);
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+            auto t3 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r2 = snprintf(buffer2, sizeof(buffer2), format, value);
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+            if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+                printf("fixed verify failed for %s (%s vs %s)\n", format, buffer1, buffer2);
+                return false;
+            }
+
+            printf("%-6s %-12g me %f them %f\n", format, value, delta1, delta2);
+        }
+    }
+    return true;
+}
+
+// compares the %.Nf fast path with d2fixed for random values of the kinds
+// it sees: arbitrary bits, cents, exact ties and values just around them
+static bool checkFixedScaled()
+{
+    std::mt19937_64 rng(1);
+    char buffer1[2048];
+    char buffer2[2048];
+    size_t fast = 0;
+
+    enum { Count = 4000000 };
+
+    for (int i = 0; i < Count; ++i) {
+        double value;
+        const uint64_t r = rng();
+        switch (i % 4) {
+        case 0:
+            memcpy(&value, &r, sizeof(value));
+            value = fabs(value);
+            break;
+        case 1:
+            value = static_cast<double>(r % 100000000) / 100.0;
+            break;
+        case 2:
+            value = ldexp(static_cast<double>(r >> 11 | 1), -static_cast<int>(rng() % 70));
+            break;
+        default:
+            value = ldexp(static_cast<double>(r % 2000001) + 0.5, -static_cast<int>(rng() % 8));
+            value = nextafter(value, (rng() & 1) ? 0.0 : 1e300);
+            break;
+        }
+        const uint32_t precision = rng() % 20;
+
+        uint64_t scaled;
+        if (!print_fixed_scaled(value, precision, scaled))
+            continue;
+        ++fast;
+        int intdigits;
+        const int n1 = print_fixed_length(scaled, precision, intdigits);
+        print_write_fixed(buffer1, scaled, precision, intdigits);
+        const int n2 = d2fixed_buffered_n(value, precision, buffer2);
+        if (n1 != n2 || memcmp(buffer1, buffer2, n1) != 0) {
+            printf("fixed fast path verify failed for %.17g at %u (%.*s vs %.*s)\n", value, precision, n1, buffer1, n2, buffer2);
+            return false;
+        }
+    }
+
+    enum { Iter = 1000000 };
+
+    const double values[] = { 1.5, 273.15, 19.99, 0.000123456789, 1234567.891 };
+    const uint32_t precisions[] = { 2, 3, 6 };
+
+    for (uint32_t precision : precisions) {
+        for (double value : values) {
+            int r1 = 0, r2 = 0;
+
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                uint64_t scaled = 0;
+                int intdigits;
+                if (!print_fixed_scaled(value, precision, scaled)) {
+                    printf("fixed fast path not taken for %.17g at %u\n", value, precision);
+                    return false;
+                }
+                r1 = print_fixed_length(scaled, precision, intdigits);
+                print_write_fixed(buffer1, scaled, precision, intdigits);
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+            auto t3 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r2 = d2fixed_buffered_n(value, precision, buffer2);
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+            if (r1 != r2 || memcmp(buffer1, buffer2, r1) != 0) {
+                printf("fixed fast path verify failed for %.*s\n", r2, buffer2);
+                return false;
+            }
+
+            printf("%%.%uf %-14.*s scaled %f d2fixed %f\n", precision, r1, buffer1, delta1, delta2);
+        }
+    }
+
+    printf("fixed fast path taken for %zu of %d values, all matched d2fixed\n", fast, static_cast<int>(Count));
+    return true;
+}
+
+static bool benchGeneral()
+{
+    char buffer1[64];
+    char buffer2[64];
+
+    enum { Iter = 1000000 };
+
+    const double values[] = { 0.0, 1.5, -273.15, 0.000123456789, 6.02214076e23, 1.0 / 3.0, 1e-300 };
+    const char* formats[] = { "%g", "%.10G", "%#g" };
+
+    for (const char* format : formats) {
+        for (double value : values) {
+            int r1 = 0, r2 = 0;
+
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r1 = snprint2(buffer1, sizeof(buffer1), format, value);
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+            auto t3 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r2 = snprintf(buffer2, sizeof(buffer2), format, value);
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+            if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+                printf("general verify failed for %s (%s vs %s)\n", format, buffer1, buffer2);
+                return false;
+            }
+
+            printf("%-6s %-16s me %f them %f\n", format, buffer2, delta1, delta2);
+        }
+    }
+
+    // precisions past the stack buffer and past the exact value's digits,
+    // star precisions aren't capped at 200
+    static char large1[4096];
+    static char large2[4096];
+    const char* starFormats[] = { "%.*g", "%#.*g", "%.*G" };
+    const int precisions[] = { 0, 1, 17, 50, 100, 767, 2100 };
+    const double largeValues[] = { 0.1, 0.5, 1e22, 5e-324, 3.4e38, 123456.789 };
+    int checked = 0;
+    for (const char* format : starFormats) {
+        for (int precision : precisions) {
+            for (double value : largeValues) {
+                const int r1 = snprint2(large1, sizeof(large1), format, precision, value);
+                const int r2 = snprintf(large2, sizeof(large2), format, precision, value);
+                const int f1 = snprint2(buffer1, sizeof(buffer1), format, precision, static_cast<float>(value));
+                const int f2 = snprintf(buffer2, sizeof(buffer2), format, precision, static_cast<float>(value));
+                if (r1 != r2 || strcmp(large1, large2) || f1 != f2 || strcmp(buffer1, buffer2)) {
+                    printf("general verify failed for %s with precision %d (%d vs %d, float %d vs %d)\n", format, precision, r1, r2, f1, f2);
+                    return false;
+                }
+                checked += 2;
+            }
+        }
+    }
+    printf("general matched snprintf for %d large precision values\n", checked);
+    return true;
+}
+
+// %r is compared with %.17g, the usual way to get a double that reads back
+static bool benchRoundTrip()
+{
+    char buffer1[64];
+    char buffer2[64];
+
+    enum { Iter = 1000000 };
+
+    const double values[] = { 0.1, -273.15, 6.02214076e23, 1.0 / 3.0, 5e-324 };
+
+    for (double value : values) {
+        int r1 = 0;
+
+        auto t1 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            r1 = snprint2(buffer1, sizeof(buffer1), "%r", value);
+        }
+
+        auto t2 = steady_clock::now();
+        double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+        auto t3 = steady_clock::now();
+        for (int i = 0; i < Iter; ++i) {
+            snprintf(buffer2, sizeof(buffer2), "%.17g", value);
+        }
+
+        auto t4 = steady_clock::now();
+        double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+        if (r1 != static_cast<int>(strlen(buffer1)) || strtod(buffer1, nullptr) != value) {
+            printf("round trip verify failed for %s\n", buffer1);
+            return false;
+        }
+
+        printf("%-24s %-24s me %f them %f\n", buffer1, buffer2, delta1, delta2);
+    }
+
+    const float fvalue = 0.1f;
+    snprint2(buffer1, sizeof(buffer1), "%r", fvalue);
+    if (strtof(buffer1, nullptr) != fvalue) {
+        printf("round trip verify failed for float %s\n", buffer1);
+        return false;
+    }
+    printf("float %s\n", buffer1);
+    return true;
+}
+
+// d2s_batch against a d2s_buffered_n loop over 1M element columns, the
+// outputs and offsets have to match exactly
+static bool benchBatch()
+{
+    enum { Count = 1000000, Runs = 5 };
+
+    std::vector<double> values(Count);
+    std::vector<char> buffer1(24 * Count), buffer2(24 * Count);
+    std::vector<uint32_t> offsets1(Count + 1), offsets2(Count + 1);
+
+    std::mt19937_64 random(15);
+    const char* columns[] = { "random bits", "uniform [0,1)", "prices", "integers" };
+    for (int column = 0; column < 4; ++column) {
+        for (double& value : values) {
+            uint64_t bits = random();
+            switch (column) {
+            case 0:
+                while ((bits >> 52 & 0x7ff) == 0x7ff)
+                    bits = random();
+                memcpy(&value, &bits, sizeof(value));
+                break;
+            case 1:
+                value = ldexp(static_cast<double>(bits >> 11), -53);
+                break;
+            case 2:
+                value = static_cast<double>(bits % 10000000) / 100;
+                break;
+            default:
+                value = static_cast<double>(bits % 100000000);
+                break;
+            }
+        }
+
+        double delta1 = 1e9, delta2 = 1e9;
+        size_t n1 = 0, n2 = 0;
+        for (int run = 0; run < Runs; ++run) {
+            auto t1 = steady_clock::now();
+            n1 = 0;
+            for (int i = 0; i < Count; ++i) {
+                offsets1[i] = n1;
+                n1 += d2s_buffered_n(values[i], buffer1.data() + n1);
+            }
+            offsets1[Count] = n1;
+
+            auto t2 = steady_clock::now();
+            delta1 = std::min<double>(delta1, duration_cast<nanoseconds>(t2 - t1).count());
+
+            auto t3 = steady_clock::now();
+            n2 = d2s_batch(values.data(), Count, buffer2.data(), offsets2.data());
+
+            auto t4 = steady_clock::now();
+            delta2 = std::min<double>(delta2, duration_cast<nanoseconds>(t4 - t3).count());
+        }
+
+        if (n1 != n2 || memcmp(buffer1.data(), buffer2.data(), n1) != 0 || offsets1 != offsets2) {
+            printf("batch verify failed for %s\n", columns[column]);
+            return false;
+        }
+
+        // bytes per nanosecond is GB/s
+        printf("%-14s loop %.1f ns %.0f MB/s %.1f M values/s, batch %.1f ns %.0f MB/s %.1f M values/s\n", columns[column],
+               delta1 / Count, n1 / delta1 * 1000, Count / delta1 * 1000, delta2 / Count, n2 / delta2 * 1000, Count / delta2 * 1000);
+    }
+    return true;
+}
+
+// Ryu against Schubfach, the two shortest engines d2s_buffered_n and
+// f2s_buffered_n can be built with. Their outputs have to be identical for
+// all 2^32 float bit patterns, which takes minutes; "format quick" only
+// compares every 257th.
+static bool benchShortest(bool quick)
+{
+    char buffer1[32];
+    char buffer2[32];
+
+    const uint32_t step = quick ? 257 : 1;
+    uint64_t checked = 0;
+    for (uint64_t bits = 0; bits <= 0xffffffffu; bits += step) {
+        const uint32_t bits32 = static_cast<uint32_t>(bits);
+        float value;
+        memcpy(&value, &bits32, sizeof(value));
+        const int r1 = f2s_ryu_buffered_n(value, buffer1);
+        const int r2 = f2s_schubfach_buffered_n(value, buffer2);
+        if (r1 != r2 || memcmp(buffer1, buffer2, r1) != 0) {
+            printf("shortest verify failed for float %08x %.*s %.*s\n", bits32, r1, buffer1, r2, buffer2);
+            return false;
+        }
+        ++checked;
+    }
+    printf("shortest floats identical, %llu checked\n", static_cast<unsigned long long>(checked));
+
+    enum { Count = 1000000, Runs = 5 };
+
+    std::vector<double> values(Count);
+    std::vector<float> floats(Count);
+    std::mt19937_64 random(16);
+    const char* columns[] = { "random bits", "uniform [0,1)", "prices", "float bits", "float prices" };
+    for (int column = 0; column < 5; ++column) {
+        for (int i = 0; i < Count; ++i) {
+            uint64_t bits = random();
+            switch (column) {
+            case 0:
+                while ((bits >> 52 & 0x7ff) == 0x7ff)
+                    bits = random();
+                memcpy(&values[i], &bits, sizeof(double));
+                break;
+            case 1:
+                values[i] = ldexp(static_cast<double>(bits >> 11), -53);
+                break;
+            case 2:
+                values[i] = static_cast<double>(bits % 10000000) / 100;
+                break;
+            case 3: {
+                uint32_t bits32 = static_cast<uint32_t>(bits);
+                while ((bits32 >> 23 & 0xff) == 0xff)
+                    bits32 = static_cast<uint32_t>(random());
+                memcpy(&floats[i], &bits32, sizeof(float));
+                break; }
+            default:
+                floats[i] = static_cast<float>(bits % 1000000) / 100;
+                break;
+            }
+        }
+
+        double delta1 = 1e9, delta2 = 1e9;
+        size_t n1 = 0, n2 = 0;
+        for (int run = 0; run < Runs; ++run) {
+            auto t1 = steady_clock::now();
+            n1 = 0;
+            for (int i = 0; i < Count; ++i) {
+                n1 += column < 3 ? d2s_ryu_buffered_n(values[i], buffer1) : f2s_ryu_buffered_n(floats[i], buffer1);
+            }
+
+            auto t2 = steady_clock::now();
+            delta1 = std::min<double>(delta1, duration_cast<nanoseconds>(t2 - t1).count());
+
+            auto t3 = steady_clock::now();
+            n2 = 0;
+            for (int i = 0; i < Count; ++i) {
+                n2 += column < 3 ? d2s_schubfach_buffered_n(values[i], buffer2) : f2s_schubfach_buffered_n(floats[i], buffer2);
+            }
+
+            auto t4 = steady_clock::now();
+            delta2 = std::min<double>(delta2, duration_cast<nanoseconds>(t4 - t3).count());
+        }
+
+        for (int i = 0; i < Count && column < 3; ++i) {
+            const int r1 = d2s_ryu_buffered_n(values[i], buffer1);
+            const int r2 = d2s_schubfach_buffered_n(values[i], buffer2);
+            if (r1 != r2 || memcmp(buffer1, buffer2, r1) != 0) {
+                printf("shortest verify failed for %.*s %.*s\n", r1, buffer1, r2, buffer2);
+                return false;
+            }
+        }
+
+        printf("%-14s ryu %.1f ns schubfach %.1f ns (%d)\n", columns[column], delta1 / Count, delta2 / Count, n1 == n2);
+    }
+    return true;
+}
+
+// %a is the lossless form for checkpoints, it has to read back exactly
+static bool benchHexFloat()
+{
+    char buffer1[64];
+    char buffer2[64];
+
+    enum { Iter = 1000000 };
+
+    const double values[] = { 0.0, 0.1, -273.15, 6.02214076e23, 1.0 / 3.0, 5e-324 };
+    const char* formats[] = { "%a", "%.3a", "%A", "%E", "%.10E" };
+
+    for (const char* format : formats) {
+        for (double value : values) {
+            int r1 = 0, r2 = 0;
+
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r1 = snprint2(buffer1, sizeof(buffer1), format, value);
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+            auto t3 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r2 = snprintf(buffer2, sizeof(buffer2), format, value);
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+            if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+                printf("hex float verify failed for %s (%s vs %s)\n", format, buffer1, buffer2);
+                return false;
+            }
+            if (!strcmp(format, "%a") && strtod(buffer1, nullptr) != value) {
+                printf("hex float round trip failed for %s\n", buffer1);
+                return false;
+            }
+
+            printf("%-6s %-24s me %f them %f\n", format, buffer2, delta1, delta2);
+        }
+    }
+    return true;
+}
+
+// float arguments go through the binary32 kernels, the same values widened
+// to double take the double path and have to print the same
+static bool benchFloats()
+{
+    char buffer1[256];
+    char buffer2[256];
+
+    enum { Iter = 1000000 };
+
+    const char* formats[] = { "%f", "%.2f", "%.15f", "%e", "%.3e", "%g" };
+    const float values[] = { 23.75f, -0.0123f, 1013.25f, 3.4028235e38f, 1e-40f };
+
+    for (const char* format : formats) {
+        for (float value : values) {
+            int r1 = 0, r2 = 0;
+
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r1 = snprint2(buffer1, sizeof(buffer1), format, value);
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+            auto t3 = steady_clock::now();
+            for (int i = 0; i < Iter; ++i) {
+                r2 = snprint2(buffer2, sizeof(buffer2), format, static_cast<double>(value));
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+            if (r1 != r2 || strcmp(buffer1, buffer2) != 0) {
+                printf("float verify failed for %s: %s vs %s\n", format, buffer1, buffer2);
+                return false;
+            }
+
+            printf("%-5s %-12g float %f double %f\n", format, value, delta1, delta2);
+        }
+    }
+    return true;
+}
+
+// pointer dumps, hex, octal and binary across the bit widths
+static bool benchRadix()
+{
+    char buffer1[128];
+    char buffer2[128];
+
+    enum { Iter = 1000000 };
+
+    const struct {
+        const char* mine;
+        const char* theirs;
+    } formats[] = {
+        { "%x", "%llx" },
+        { "%#X", "%#llX" },
+        { "%o", "%llo" },
+        { "%b", "%llb" },
+        { "%p", "%p" }
+    };
+
+    for (const auto& format : formats) {
+        for (int bits = 4; bits <= 64; bits += 20) {
+            const uint64_t value = 0xfedcba9876543210ull >> (64 - bits);
+            int r1 = 0, r2 = 0;
+
+            auto t1 = steady_clock::now();
+            if (format.mine[1] == 'p') {
+                for (int i = 0; i < Iter; ++i) {
+                    r1 = snprint2(buffer1, sizeof(buffer1), format.mine, reinterpret_cast<void*>(value));
+                }
+            } else {
+                for (int i = 0; i < Iter; ++i) {
+                    r1 = snprint2(buffer1, sizeof(buffer1), format.mine, value);
+                }
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+            auto t3 = steady_clock::now();
+            if (format.theirs[1] == 'p') {
+                for (int i = 0; i < Iter; ++i) {
+                    r2 = snprintf(buffer2, sizeof(buffer2), format.theirs, reinterpret_cast<void*>(value));
+                }
+            } else {
+                for (int i = 0; i < Iter; ++i) {
+                    r2 = snprintf(buffer2, sizeof(buffer2), format.theirs, static_cast<unsigned long long>(value));
+                }
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+            if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+                printf("radix verify failed for %s at %d bits (%d,%d)\n", format.mine, bits, r1, r2);
+                return false;
+            }
+
+            printf("%-4s %2d bits, me %f them %f\n", format.mine, bits, delta1, delta2);
+        }
+    }
+    return true;
+}
+
+// long double through ryu's generic 128 bit conversions against glibc, %r
+// has to read back to the same value. __float128 arguments holding the same
+// values have to print the same.
+static bool benchLongDouble()
+{
+    char buffer1[8192];
+    char buffer2[8192];
+
+    enum { Iter = 100000 };
+
+    const char* formats[] = { "%Lf", "%.2Lf", "%Le", "%.20Le", "%Lg", "%.18Lg" };
+    const long double values[] = { 1.0L / 3.0L, -6.02214076e23L, 0.1L, 1.2345e-300L, 2.5e-4000L, 1.7e4500L };
+
+    for (const char* format : formats) {
+        for (long double value : values) {
+            int r1 = 0, r2 = 0;
+            // the values beyond the double range take microseconds, glibc
+            // up to milliseconds for %Lf
+            const int iter = std::fabs(value) > 1e300L || std::fabs(value) < 1e-300L ? Iter / 1000 : Iter;
+
+            auto t1 = steady_clock::now();
+            for (int i = 0; i < iter; ++i) {
+                r1 = snprint2(buffer1, sizeof(buffer1), format, value);
+            }
+
+            auto t2 = steady_clock::now();
+            double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(iter);
+
+            auto t3 = steady_clock::now();
+            for (int i = 0; i < iter; ++i) {
+                r2 = snprintf(buffer2, sizeof(buffer2), format, value);
+            }
+
+            auto t4 = steady_clock::now();
+            double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(iter);
+
+            if (r1 != r2 || strcmp(buffer1, buffer2) != 0) {
+                printf("long double verify failed for %s: %.60s vs %.60s\n", format, buffer1, buffer2);
+                return false;
+            }
+
+#if defined(__SIZEOF_FLOAT128__)
+            r1 = snprint2(buffer1, sizeof(buffer1), format, static_cast<__float128>(value));
+            if (r1 != r2 || strcmp(buffer1, buffer2) != 0) {
+                printf("__float128 verify failed for %s: %.60s vs %.60s\n", format, buffer1, buffer2);
+                return false;
+            }
+#endif
+
+            printf("%-6s %-12Lg me %f them %f\n", format, value, delta1, delta2);
+        }
+    }
+
+    // star precisions far past the double range of digits, the buffers
+    // are sized from them
+    static char large1[16384];
+    static char large2[16384];
+    const char* starFormats[] = { "%.*Lg", "%#.*Lg", "%.*Le", "%.*Lf" };
+    const int precisions[] = { 0, 40, 3000, 5000 };
+    const long double largeValues[] = { 0.1L, std::numeric_limits<long double>::denorm_min(), 1.2345e-300L, 6.02214076e23L, 1.7e4500L };
+    int checked = 0;
+    for (const char* format : starFormats) {
+        for (int precision : precisions) {
+            for (long double value : largeValues) {
+                const int r1 = snprint2(large1, sizeof(large1), format, precision, value);
+                const int r2 = snprintf(large2, sizeof(large2), format, precision, value);
+                if (r1 != r2 || strcmp(large1, large2) != 0) {
+                    printf("long double verify failed for %s with precision %d: %d vs %d\n", format, precision, r1, r2);
+                    return false;
+                }
+#if defined(__SIZEOF_FLOAT128__)
+                if (snprint2(large1, sizeof(large1), format, precision, static_cast<__float128>(value)) != r2 || strcmp(large1, large2) != 0) {
+                    printf("__float128 verify failed for %s with precision %d\n", format, precision);
+                    return false;
+                }
+#endif
+                ++checked;
+            }
+        }
+    }
+    printf("long double matched snprintf for %d large precision values\n", checked);
+
+    for (long double value : values) {
+        snprint2(buffer1, sizeof(buffer1), "%r", value);
+        if (strtold(buffer1, nullptr) != value) {
+            printf("long double round trip failed for %s\n", buffer1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// d2fixed/d2exp latency with cold caches. Every conversion has an exponent
+// far from the previous one, so it needs a different part of the POW10_SPLIT
+// tables, or different rows of the small ones with RYU_D2FIXED_OPTIMIZE_SIZE.
+// The second conversion of the same value shows the warm latency.
+static bool benchColdTables(const char* self)
+{
+#if defined(RYU_D2FIXED_OPTIMIZE_SIZE)
+    const char* mode = "small";
+#else
+    const char* mode = "full";
+#endif
+    struct stat st;
+    const long size = stat(self, &st) == 0 ? static_cast<long>(st.st_size) : -1;
+
+    enum { Samples = 200, EvictSize = 64 * 1024 * 1024 };
+    std::vector<char> evict(EvictSize);
+    std::vector<double> cold, warm;
+    std::mt19937_64 rng(4711);
+    std::uniform_int_distribution<int> exponents(-1000, 1000);
+    char buffer[2048];
+    int sink = 0;
+
+    for (int i = 0; i < Samples; ++i) {
+        const double value = ldexp(static_cast<double>(rng() >> 11), exponents(rng) - 53);
+        const char* format = (i & 1) ? "%.20f" : "%.17e";
+        for (size_t j = 0; j < evict.size(); j += 64)
+            ++evict[j];
+
+        auto t1 = steady_clock::now();
+        sink += snprint2(buffer, sizeof(buffer), format, value);
+        auto t2 = steady_clock::now();
+        sink += snprint2(buffer, sizeof(buffer), format, value);
+        auto t3 = steady_clock::now();
+
+        cold.push_back(duration_cast<nanoseconds>(t2 - t1).count());
+        warm.push_back(duration_cast<nanoseconds>(t3 - t2).count());
+    }
+
+    std::sort(cold.begin(), cold.end());
+    std::sort(warm.begin(), warm.end());
+    printf("d2fixed tables %s, binary %ld bytes: cold median %f p90 %f, warm median %f (%d)\n",
+           mode, size, cold[Samples / 2], cold[Samples * 9 / 10], warm[Samples / 2], sink > 0);
+    return true;
+}
+
+int main(int argc, char** argv)
 {
     Foobar foobar("abc", 123);
     Foobar2 foobar2("trall", 42);
-    int ting1 = 0, ting2 = 0;
     // snprint2("hello %n%d %f '%*.*s' '%s' %n\n", &ting1, 99, 1.234, 10, 2, "hi ho", foobar, &ting2);
     // snprint2("got ting %d %d (%s) %p\n", ting1, ting2, foobar2, &foobar2);
     //print2("hello %d '%s'\n", 2, "foobar");
 
     std::string tang = "tang";
     char buffer1[1024];
-    char buffer2[1024];
 
     int fn1, fn2, r1, r2;
 
@@ -92,6 +1372,17 @@ int main(int, char**)
     auto t2 = steady_clock::now();
     double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
 
+    char buffer3[1024];
+    int fn3, r3;
+
+    auto t5 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i) {
+        r3 = SNPRINT2(buffer3, sizeof(buffer3), "hello2 %#x%s%*u%p%s%f%-+20d\n%n", 1234567, "jappja", 140, 12345, &fn1, "trall og trall", 123.456, 99, &fn3);
+    }
+
+    auto t6 = steady_clock::now();
+    double delta3 = duration_cast<nanoseconds>(t6 - t5).count() / static_cast<double>(Iter);
+
     // verify
     bool ok = true;
     int off = 0;
@@ -106,8 +1397,14 @@ int main(int, char**)
     //     ok = false;
     // }
 
+    if (r1 != r3 || fn1 != fn3 || memcmp(buffer1, buffer3, r1 + 1) != 0) {
+        printf("cached verify failed (%d,%d) - (%d,%d)\n", fn1, fn3, r1, r3);
+        ok = false;
+    }
+
     if (ok) {
         printf("took, me   %f\n", delta1);
+        printf("took, cached %f\n", delta3);
         printf("took, them %f\n", delta2);
 
         printf("verified %d\n", fn1);
@@ -115,5 +1412,44 @@ int main(int, char**)
         printf("verify failed at %d (%d,%d) - (%d,%d)\n", off, fn1, fn2, r1, r2);
     }
 
-    return 0;
+    if (ok)
+        ok = benchLongLiterals();
+    if (ok)
+        ok = benchScanKernels();
+    if (ok)
+        ok = benchAppend();
+    if (ok)
+        ok = benchFd();
+    if (ok)
+        ok = benchGather();
+    if (ok)
+        ok = benchSink();
+    if (ok)
+        ok = benchMap();
+    if (ok)
+        ok = benchIntegers();
+    if (ok)
+        ok = benchRadix();
+    if (ok)
+        ok = checkFixedScaled();
+    if (ok)
+        ok = benchFixed();
+    if (ok)
+        ok = benchGeneral();
+    if (ok)
+        ok = benchRoundTrip();
+    if (ok)
+        ok = benchHexFloat();
+    if (ok)
+        ok = benchBatch();
+    if (ok)
+        ok = benchShortest(argc > 1 && !strcmp(argv[1], "quick"));
+    if (ok)
+        ok = benchFloats();
+    if (ok)
+        ok = benchLongDouble();
+    if (ok)
+        ok = benchColdTables(argv[0]);
+
+    return ok ? 0 : 1;
 }
@@ -2,8 +2,10 @@
 #define PRINT2_H
 
 #include <string>
+#include <vector>
 #include <array>
 #include <algorithm>
+#include <limits>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -62,18 +64,24 @@ struct is_exact_c_string : std::integral_constant<
 
 struct Argument
 {
-    enum Type
+    enum Type : uint8_t
     {
         Int32,
         Uint32,
         Int64,
         Uint64,
         Double,
+        Float,
+        LongDouble,
+        Float128,
         Pointer,
         IntPointer,
+        CString,
+        // String and Custom don't fit in a Value, see ArgumentStore
         String,
         Custom
-    } type;
+    };
+    enum { TypeCount = Custom + 1 };
     struct StringType
     {
         const char* str;
@@ -84,47 +92,217 @@ struct Argument
         const void* data;
         void (*format)(BufferWriter& writer, const State& state, const void* data);
     };
-    union {
+    union Value {
         int32_t i32;
         uint32_t u32;
         int64_t i64;
         uint64_t u64;
         double dbl;
+        float flt;
+        // long double and __float128 are kept by address so a Value stays
+        // one word, the caller's value outlives the call
+        const long double* ldbl;
+#if defined(__SIZEOF_FLOAT128__)
+        const __float128* f128;
+#endif
         void* ptr;
+        // terminated, the length is only taken when it's formatted
+        const char* cstr;
+        // String and Custom, the slot in ArgumentStore::outOfLine
+        size_t slot;
+    };
+    union OutOfLine {
         StringType str;
         CustomType custom;
-    } value;
+    };
 };
 
 template<typename ...Args>
-struct ArgumentStore
-{
-    static const size_t ArgCount = sizeof...(Args);
-    Argument args[ArgCount];
-
-    ArgumentStore(Args&& ...args);
-};
+struct ArgumentStore;
 
+// The arguments as three arrays, a type tag byte and an 8 byte Value per
+// argument plus the 16 byte String and Custom payloads out of line
 struct Arguments
 {
-    const Argument* args;
+    const Argument::Type* types;
+    const Argument::Value* values;
+    const Argument::OutOfLine* outOfLine;
     const size_t count;
 
-    Arguments() : args(nullptr), count(0) { }
+    Arguments() : types(nullptr), values(nullptr), outOfLine(nullptr), count(0) { }
     template<typename ...Args>
-    Arguments(ArgumentStore<Args...>&& store) : args(store.args), count(store.ArgCount) { }
+    Arguments(ArgumentStore<Args...>&& store)
+        : types(store.types.data()), values(store.values.data()), outOfLine(store.outOfLine.data()), count(store.ArgCount)
+    {
+    }
 };
 
 void print2_format_generic(BufferWriter& writer, const State& state, const typename Argument::StringType& str);
 int print2_helper(char* buffer, size_t bufsiz, const char* format, const Arguments& args);
 
-#define MAKE_ARITHMETIC_ARG(tp, itp, val)       \
-    inline Argument make_arithmetic_arg(tp arg) \
-    {                                           \
-        Argument a;                             \
-        a.type = Argument::itp;                 \
-        a.value.val = static_cast<tp>(arg);     \
-        return a;                               \
+// A format string parsed once into literal segments and pre-resolved conversions
+struct Print2Program;
+
+const Print2Program* print2_compile(const char* format);
+void print2_release(const Print2Program* program);
+int print2_execute(char* buffer, size_t bufsiz, const Print2Program* program, const Arguments& args);
+
+// Append to out instead of writing to a fixed buffer, out grows as needed
+// and the return value is the number of characters appended
+int print2_append(std::string& out, const char* format, const Arguments& args);
+int print2_append(std::vector<char>& out, const char* format, const Arguments& args);
+int print2_append(std::string& out, const Print2Program* program, const Arguments& args);
+int print2_append(std::vector<char>& out, const Print2Program* program, const Arguments& args);
+
+// When output staged for a file descriptor is handed to the OS. Line
+// flushes every call that wrote a newline, Size once flushSize bytes are
+// staged and Explicit only on print2_flush. Gather writes every call with a
+// single writev(2) before returning, %s arguments of at least gatherSize
+// bytes go out from where they are instead of being copied into the staging
+// buffer. Output for another descriptor or the thread exiting flushes
+// whatever is staged regardless.
+enum Print2Flush
+{
+    Print2Flush_Line,
+    Print2Flush_Size,
+    Print2Flush_Explicit,
+    Print2Flush_Gather
+};
+
+struct Print2Fd
+{
+    Print2Fd(int f, Print2Flush p = Print2Flush_Line, size_t s = 16384, size_t g = 4096)
+        : fd(f), flush(p), flushSize(s), gatherSize(g)
+    {
+    }
+
+    int fd;
+    Print2Flush flush;
+    size_t flushSize;
+    size_t gatherSize;
+};
+
+// Formats into a staging buffer owned by the calling thread and writes it to
+// the descriptor with one write(2) per flush, no stdio and no locks. Returns
+// the number of characters formatted or -1 if a flush failed.
+int print2_fd(const Print2Fd& target, const char* format, const Arguments& args);
+int print2_fd(const Print2Fd& target, const Print2Program* program, const Arguments& args);
+// writes out what the calling thread has staged, 0 on success or -1
+int print2_flush();
+
+// An asynchronous sink for one descriptor. Calls format into one of depth
+// buffers of bufferSize bytes, a full buffer is handed off and formatting
+// continues in the next free one. Buffers go to the kernel through io_uring
+// as registered buffers, up to batch of them per submission, and are reused
+// as their writes complete. Without io_uring a writer thread does plain
+// write(2)s from the same buffers. Either way at most depth buffers are in
+// flight, a caller only blocks when all of them are. A sink belongs to one
+// thread.
+enum Print2SinkBackend
+{
+    Print2Sink_Auto,
+    Print2Sink_Uring,
+    Print2Sink_Thread
+};
+
+struct Print2SinkOptions
+{
+    Print2SinkOptions(size_t s = 65536, unsigned d = 8, unsigned b = 2, Print2SinkBackend k = Print2Sink_Auto)
+        : bufferSize(s), depth(d), batch(b), backend(k)
+    {
+    }
+
+    size_t bufferSize;
+    unsigned depth;
+    unsigned batch;
+    Print2SinkBackend backend;
+};
+
+struct Print2Sink;
+
+// nullptr if the buffers can't be allocated or Print2Sink_Uring was asked
+// for and io_uring isn't available
+Print2Sink* print2_sink_open(int fd, const Print2SinkOptions& options = Print2SinkOptions());
+// flushes, waits for everything in flight and frees the sink. 0 if every
+// write succeeded, -1 otherwise. the descriptor is left open.
+int print2_sink_close(Print2Sink* sink);
+// the backend in use, Print2Sink_Uring or Print2Sink_Thread
+Print2SinkBackend print2_sink_backend(const Print2Sink* sink);
+// number of characters formatted or -1 once a write has failed
+int print2_sink_print(Print2Sink* sink, const char* format, const Arguments& args);
+int print2_sink_print(Print2Sink* sink, const Print2Program* program, const Arguments& args);
+// hands off the partially filled buffer and waits until everything is written
+int print2_sink_flush(Print2Sink* sink);
+
+// A log file written through a shared mapping of it. Calls format straight
+// into the mapped window, no syscall per line, and a message that runs past
+// the window moves the window up to start where the message does. The file
+// grows chunkSize bytes at a time. After each message the header's count of
+// committed bytes is advanced, so what a crashed process managed to log can
+// be read back with print2_map_recover. Opening a log that exists continues
+// it. A map sink belongs to one thread.
+struct Print2MapSink;
+
+// nullptr if the file can't be opened or mapped, or exists and isn't a log
+Print2MapSink* print2_map_open(const char* path, size_t chunkSize = 64 << 20);
+// trims the file to what was committed and unmaps it, 0 on success or -1
+int print2_map_close(Print2MapSink* sink);
+// fdatasync, only needed to survive the machine going down rather than the
+// process
+int print2_map_sync(Print2MapSink* sink);
+// number of characters logged or -1 once the file couldn't be extended
+int print2_map_print(Print2MapSink* sink, const char* format, const Arguments& args);
+int print2_map_print(Print2MapSink* sink, const Print2Program* program, const Arguments& args);
+// the committed messages of the log at path, false if it isn't a log
+bool print2_map_recover(const char* path, std::string& out);
+
+struct Print2ProgramCache
+{
+    Print2ProgramCache(const char* f)
+        : format(f), program(print2_compile(f))
+    {
+    }
+    ~Print2ProgramCache()
+    {
+        print2_release(program);
+    }
+
+    Print2ProgramCache(const Print2ProgramCache&) = delete;
+    Print2ProgramCache& operator=(const Print2ProgramCache&) = delete;
+
+    const char* const format;
+    const Print2Program* const program;
+};
+
+// What make_arg returns. The tag is part of the C++ type so ArgumentStore
+// can lay out all the tags at compile time.
+template<Argument::Type T>
+struct TypedArgument
+{
+    static const Argument::Type type = T;
+    Argument::Value value;
+};
+
+template<>
+struct TypedArgument<Argument::String>
+{
+    static const Argument::Type type = Argument::String;
+    Argument::StringType value;
+};
+
+template<>
+struct TypedArgument<Argument::Custom>
+{
+    static const Argument::Type type = Argument::Custom;
+    Argument::CustomType value;
+};
+
+#define MAKE_ARITHMETIC_ARG(tp, itp, val)                           \
+    inline TypedArgument<Argument::itp> make_arithmetic_arg(tp arg) \
+    {                                                               \
+        TypedArgument<Argument::itp> a;                             \
+        a.value.val = static_cast<tp>(arg);                         \
+        return a;                                                   \
     }
 
 MAKE_ARITHMETIC_ARG(double, Double, dbl);
@@ -137,67 +315,89 @@ MAKE_ARITHMETIC_ARG(bool, Int32, i32);
 MAKE_ARITHMETIC_ARG(char, Int32, i32);
 MAKE_ARITHMETIC_ARG(signed char, Int32, i32);
 MAKE_ARITHMETIC_ARG(unsigned char, Int32, i32);
-MAKE_ARITHMETIC_ARG(float, Double, dbl);
+MAKE_ARITHMETIC_ARG(float, Float, flt);
 
 #undef MAKE_ARITHMETIC_ARG
 
-template<typename Arg, typename std::enable_if<std::is_arithmetic<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+template<class T>
+struct is_wide_float : std::integral_constant<
+    bool,
+#if defined(__SIZEOF_FLOAT128__)
+    std::is_same<__float128, typename std::decay<T>::type>::value ||
+#endif
+    std::is_same<long double, typename std::decay<T>::type>::value>
+{
+};
+
+template<typename Arg, typename std::enable_if<std::is_arithmetic<typename std::decay<Arg>::type>::value && !is_wide_float<Arg>::value, void>::type* = nullptr>
+auto make_arg(Arg&& arg) -> decltype(make_arithmetic_arg(static_cast<typename std::decay<Arg>::type>(arg)))
 {
     return make_arithmetic_arg(static_cast<typename std::decay<Arg>::type>(arg));
 }
 
+template<typename Arg, typename std::enable_if<std::is_same<long double, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
+TypedArgument<Argument::LongDouble> make_arg(Arg&& arg)
+{
+    TypedArgument<Argument::LongDouble> a;
+    a.value.ldbl = &arg;
+    return a;
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+template<typename Arg, typename std::enable_if<std::is_same<__float128, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
+TypedArgument<Argument::Float128> make_arg(Arg&& arg)
+{
+    TypedArgument<Argument::Float128> a;
+    a.value.f128 = &arg;
+    return a;
+}
+#endif
+
 template<typename Arg, typename std::enable_if<is_c_string<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+TypedArgument<Argument::CString> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::String;
-    a.value.str = { arg, strlen(arg) };
+    TypedArgument<Argument::CString> a;
+    a.value.cstr = arg;
     return a;
 }
 
 template<typename Arg, typename std::enable_if<std::is_same<std::string, typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+TypedArgument<Argument::String> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::String;
-    a.value.str = { arg.c_str(), arg.size() };
+    TypedArgument<Argument::String> a;
+    a.value = { arg.c_str(), arg.size() };
     return a;
 }
 
 template<typename Arg, typename std::enable_if<std::is_same<int*, typename std::remove_reference<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+TypedArgument<Argument::IntPointer> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::IntPointer;
+    TypedArgument<Argument::IntPointer> a;
     a.value.ptr = arg;
     return a;
 }
 
-template<typename Arg, typename std::enable_if<!std::is_same<int*, typename std::remove_reference<Arg>::type>::value && std::is_pointer<typename std::remove_reference<Arg>::type>::value, void>::type* = nullptr>
-    Argument make_arg(Arg&& arg)
+template<typename Arg, typename std::enable_if<!std::is_same<int*, typename std::remove_reference<Arg>::type>::value && !is_c_string<Arg>::value && std::is_pointer<typename std::remove_reference<Arg>::type>::value, void>::type* = nullptr>
+TypedArgument<Argument::Pointer> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::Pointer;
+    TypedArgument<Argument::Pointer> a;
     a.value.ptr = arg;
     return a;
 }
 
 template<typename Arg, typename std::enable_if<std::is_same<std::nullptr_t, typename std::remove_reference<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+TypedArgument<Argument::Pointer> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::Pointer;
+    TypedArgument<Argument::Pointer> a;
     a.value.ptr = nullptr;
     return a;
 }
 
 template<typename Arg, typename std::enable_if<has_global_to_string<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+TypedArgument<Argument::Custom> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::Custom;
-    a.value.custom = { &arg, [](BufferWriter& writer, const State& state, const void* ptr) {
+    TypedArgument<Argument::Custom> a;
+    a.value = { &arg, [](BufferWriter& writer, const State& state, const void* ptr) {
             typedef typename std::decay<Arg>::type ArgType;
             const ArgType& val = *reinterpret_cast<const ArgType*>(ptr);
             const std::string& str = to_string(val);
@@ -207,11 +407,10 @@ Argument make_arg(Arg&& arg)
 }
 
 template<typename Arg, typename std::enable_if<has_member_to_string<typename std::decay<Arg>::type>::value, void>::type* = nullptr>
-Argument make_arg(Arg&& arg)
+TypedArgument<Argument::Custom> make_arg(Arg&& arg)
 {
-    Argument a;
-    a.type = Argument::Custom;
-    a.value.custom = { &arg, [](BufferWriter& writer, const State& state, const void* ptr) {
+    TypedArgument<Argument::Custom> a;
+    a.value = { &arg, [](BufferWriter& writer, const State& state, const void* ptr) {
             typedef typename std::decay<Arg>::type ArgType;
             const ArgType& val = *reinterpret_cast<const ArgType*>(ptr);
             const std::string& str = val.to_string();
@@ -220,10 +419,60 @@ Argument make_arg(Arg&& arg)
     return a;
 }
 
+template<typename Arg>
+struct argument_type : std::integral_constant<Argument::Type, decltype(make_arg(std::declval<Arg&>()))::type>
+{
+};
+
+template<typename ...Args>
+struct out_of_line_count : std::integral_constant<size_t, 0>
+{
+};
+
+template<typename Arg, typename ...Rest>
+struct out_of_line_count<Arg, Rest...> : std::integral_constant<
+    size_t,
+    (argument_type<Arg>::value >= Argument::String) + out_of_line_count<Rest...>::value>
+{
+};
+
+template<typename ...Args>
+struct ArgumentStore
+{
+    static const size_t ArgCount = sizeof...(Args);
+    static const size_t OutOfLineCount = out_of_line_count<Args...>::value;
+    std::array<Argument::Value, ArgCount> values;
+    std::array<Argument::OutOfLine, OutOfLineCount> outOfLine;
+    std::array<Argument::Type, ArgCount> types;
+
+    ArgumentStore(Args&& ...args);
+
+private:
+    template<Argument::Type T>
+    void put(const TypedArgument<T>& arg, size_t index, size_t&)
+    {
+        values[index] = arg.value;
+    }
+    void put(const TypedArgument<Argument::String>& arg, size_t index, size_t& slot)
+    {
+        outOfLine[slot].str = arg.value;
+        values[index].slot = slot++;
+    }
+    void put(const TypedArgument<Argument::Custom>& arg, size_t index, size_t& slot)
+    {
+        outOfLine[slot].custom = arg.value;
+        values[index].slot = slot++;
+    }
+};
+
+// the tags are constants, only the values are stored at runtime
 template<typename ...Args>
 inline ArgumentStore<Args...>::ArgumentStore(Args&& ...a)
-    : args{make_arg(a)...}
+    : types{{argument_type<Args>::value...}}
 {
+    size_t index = 0, slot = 0;
+    const int expand[] = { 0, (put(make_arg(a), index++, slot), 0)... };
+    (void)expand;
 }
 
 template<typename ...Args>
@@ -238,4 +487,122 @@ int snprint2(char* buffer, size_t bufsiz, const char* format, Args&& ...args)
     return print2_helper(buffer, bufsiz, format, Arguments(make_args(args...)));
 }
 
+template<typename ...Args>
+int snprint2(char* buffer, size_t bufsiz, const Print2Program* program, Args&& ...args)
+{
+    return print2_execute(buffer, bufsiz, program, Arguments(make_args(args...)));
+}
+
+template<typename Container, typename ...Args>
+int sprint2(Container& out, const char* format, Args&& ...args)
+{
+    return print2_append(out, format, Arguments(make_args(args...)));
+}
+
+template<typename Container, typename ...Args>
+int sprint2(Container& out, const Print2Program* program, Args&& ...args)
+{
+    return print2_append(out, program, Arguments(make_args(args...)));
+}
+
+template<typename ...Args>
+int dprint2(const Print2Fd& target, const char* format, Args&& ...args)
+{
+    return print2_fd(target, format, Arguments(make_args(args...)));
+}
+
+template<typename ...Args>
+int dprint2(const Print2Fd& target, const Print2Program* program, Args&& ...args)
+{
+    return print2_fd(target, program, Arguments(make_args(args...)));
+}
+
+template<typename ...Args>
+int aprint2(Print2Sink* sink, const char* format, Args&& ...args)
+{
+    return print2_sink_print(sink, format, Arguments(make_args(args...)));
+}
+
+template<typename ...Args>
+int aprint2(Print2Sink* sink, const Print2Program* program, Args&& ...args)
+{
+    return print2_sink_print(sink, program, Arguments(make_args(args...)));
+}
+
+template<typename ...Args>
+int mprint2(Print2MapSink* sink, const char* format, Args&& ...args)
+{
+    return print2_map_print(sink, format, Arguments(make_args(args...)));
+}
+
+template<typename ...Args>
+int mprint2(Print2MapSink* sink, const Print2Program* program, Args&& ...args)
+{
+    return print2_map_print(sink, program, Arguments(make_args(args...)));
+}
+
+// Builds a string out of many formatted fragments. clear() keeps the
+// capacity, so once a formatter has grown to fit what it builds, appending
+// doesn't allocate.
+class Print2Formatter
+{
+public:
+    template<typename ...Args>
+    Print2Formatter& append(const char* format, Args&& ...args)
+    {
+        sprint2(data, format, std::forward<Args>(args)...);
+        return *this;
+    }
+
+    template<typename ...Args>
+    Print2Formatter& append(const Print2Program* program, Args&& ...args)
+    {
+        sprint2(data, program, std::forward<Args>(args)...);
+        return *this;
+    }
+
+    void clear() { data.clear(); }
+    void reserve(size_t size) { data.reserve(size); }
+
+    const std::string& str() const { return data; }
+    const char* c_str() const { return data.c_str(); }
+    size_t size() const { return data.size(); }
+    size_t capacity() const { return data.capacity(); }
+
+    // lets sprint2 and SPRINT2 append to a formatter
+    friend int print2_append(Print2Formatter& out, const char* format, const Arguments& args)
+    {
+        return print2_append(out.data, format, args);
+    }
+    friend int print2_append(Print2Formatter& out, const Print2Program* program, const Arguments& args)
+    {
+        return print2_append(out.data, program, args);
+    }
+
+private:
+    std::string data;
+};
+
+// Compiles the format the first time the call site is reached and reuses the
+// program afterwards, passing it to call after the arguments in the
+// parenthesized target. fmt has to be a string literal, the "" on either side
+// makes anything else a compile error, so a call site always sees the same
+// format. Formats built at runtime go through the functions or print2_compile.
+#define PRINT2_UNPAREN(...) __VA_ARGS__
+#define PRINT2_CACHED(call, target, fmt, ...)                                   \
+    ([&]() -> int {                                                             \
+        static const Print2ProgramCache print2_cache("" fmt "");                \
+        return call(PRINT2_UNPAREN target, print2_cache.program, ##__VA_ARGS__); \
+    }())
+
+#define SNPRINT2(buffer, bufsiz, fmt, ...) PRINT2_CACHED(snprint2, (buffer, bufsiz), fmt, ##__VA_ARGS__)
+// appending to a std::string, std::vector<char> or Print2Formatter
+#define SPRINT2(out, fmt, ...) PRINT2_CACHED(sprint2, (out), fmt, ##__VA_ARGS__)
+// writing to a file descriptor
+#define DPRINT2(target, fmt, ...) PRINT2_CACHED(dprint2, (target), fmt, ##__VA_ARGS__)
+// writing to a Print2Sink
+#define APRINT2(sink, fmt, ...) PRINT2_CACHED(aprint2, (sink), fmt, ##__VA_ARGS__)
+// writing to a Print2MapSink
+#define MPRINT2(sink, fmt, ...) PRINT2_CACHED(mprint2, (sink), fmt, ##__VA_ARGS__)
+
 #endif // PRINT2_H
@@ -1,515 +1,10 @@
-#include "print2.h"
-
-struct State
-{
-    enum { None = -1, Star = -2 };
-    enum Flags
-    {
-        Flag_None        = 0x00,
-        Flag_LeftJustify = 0x02,
-        Flag_Sign        = 0x04,
-        Flag_Space       = 0x08,
-        Flag_Prefix      = 0x10,
-        Flag_ZeroPad     = 0x20
-    };
-    enum Length
-    {
-        Length_None,
-        Length_hh,
-        Length_h,
-        Length_ll,
-        Length_l,
-        Length_j,
-        Length_z,
-        Length_t,
-        Length_L
-    };
-    int32_t flags;
-    Length length;
-    int32_t width; // can be Star which means that an additional argument will contain the actual number
-    int32_t precision; // can be Star which means that an additional argument will contain the actual number
-};
-
-inline void clearState(State& state)
-{
-    state.flags = State::Flag_None;
-    state.length = State::Length_None;
-    state.width = state.precision = State::None;
-};
-
-struct BufferWriter
-{
-    BufferWriter(char* b, size_t s)
-        : buffer(b), buffersize(s), bufferoff(0)
-    {
-    }
-
-    char* buffer;
-    size_t buffersize;
-    size_t bufferoff;
-
-    void put(char c) { if (bufferoff < buffersize) buffer[bufferoff++] = c; else ++bufferoff; }
-    void put(const char* c, size_t s) { const ssize_t m = std::min<ssize_t>(s, buffersize - bufferoff); if (m > 0) { memcpy(buffer + bufferoff, c, m); } bufferoff += s; }
-
-    size_t offset() const { return bufferoff; }
-    size_t size() const { return buffersize; }
-    size_t terminate() { if (bufferoff < buffersize) buffer[bufferoff] = '\0'; else buffer[buffersize - 1] = '\0'; return bufferoff; }
-};
-
-template <std::size_t N, typename T>
-constexpr std::array<T, N> make_array(const T& value)
-{
-    return detail::make_array(value, detail::make_index_sequence<N>());
-}
-
-template<char Pad>
-void writePad(BufferWriter& writer, int num)
-{
-    enum { Size = 64 };
-
-    constexpr auto a = make_array<Size>(Pad);
-
-    while (num > Size) {
-        writer.put(a.data(), Size);
-        num -= Size;
-    }
-    if (num > 0) {
-        writer.put(a.data(), num);
-    }
-}
-
-template<size_t N>
-inline int print2_error(const char (&type)[N])
-{
-    fwrite(type, 1, N, stderr);
-    fwrite("\n", 1, 2, stderr);
-    fflush(stderr);
-    abort();
-    return 0;
-}
-
-template<typename ArgType, typename ReturnArgType = ArgType>
-struct ArgumentGetter
-{
-    static ReturnArgType get(const Arguments& args, size_t idx);
-};
-
-template<>
-struct ArgumentGetter<void*, uintptr_t>
-{
-    static uintptr_t get(const Arguments& args, size_t idx)
-    {
-        assert(idx < args.count);
-        return reinterpret_cast<uintptr_t>(args.args[idx].value.ptr);
-    }
-};
-
-template<>
-struct ArgumentGetter<int*, int*>
-{
-    static int* get(const Arguments& args, size_t idx)
-    {
-        assert(idx < args.count);
-        return reinterpret_cast<int*>(args.args[idx].value.ptr);
-    }
-};
-
-template<>
-struct ArgumentGetter<int64_t, int64_t>
-{
-    static int64_t get(const Arguments& args, size_t idx)
-    {
-        assert(idx < args.count);
-        const auto& arg = args.args[idx];
-        switch (arg.type) {
-        case Argument::Int32:
-            return static_cast<int64_t>(arg.value.i32);
-        case Argument::Uint32:
-            return static_cast<int64_t>(arg.value.u32);
-        case Argument::Int64:
-            return static_cast<int64_t>(arg.value.i64);
-        case Argument::Uint64:
-            return static_cast<int64_t>(arg.value.u64);
-        default:
-            return print2_error("Invalid int type");
-        }
-    }
-};
-
-template<>
-struct ArgumentGetter<uint64_t, uint64_t>
-{
-    static uint64_t get(const Arguments& args, size_t idx)
-    {
-        assert(idx < args.count);
-        const auto& arg = args.args[idx];
-        switch (arg.type) {
-        case Argument::Int32:
-            return static_cast<uint64_t>(arg.value.i32);
-        case Argument::Uint32:
-            return static_cast<uint64_t>(arg.value.u32);
-        case Argument::Int64:
-            return static_cast<uint64_t>(arg.value.i64);
-        case Argument::Uint64:
-            return static_cast<uint64_t>(arg.value.u64);
-        default:
-            return print2_error("Invalid int type");
-        }
-    }
-};
-
-#define GET_ARG(tp, rtp, val)                                   \
-    template<>                                                  \
-    struct ArgumentGetter<tp, rtp>                              \
-    {                                                           \
-        static rtp get(const Arguments& args, size_t idx)       \
-        {                                                       \
-            assert(idx < args.count);                           \
-            return static_cast<rtp>(args.args[idx].value.val);  \
-        }                                                       \
-    }
-
-GET_ARG(typename Argument::StringType, typename Argument::StringType, str);
-GET_ARG(int32_t, int32_t, i32);
-GET_ARG(double, double, dbl);
-
-#undef GET_ARG
-
-inline void print2_format_buffer(BufferWriter& writer, const State& state, const char* buffer, size_t bufsiz, const char* extra, size_t extrasiz)
-{
-    const bool left = state.flags & State::Flag_LeftJustify;
-
-    int precision = 0;
-    if (state.precision != State::None) {
-        assert(state.precision >= 0);
-        precision = state.precision;
-
-        // precision of 0 means that the number 0 should not be emitted
-        if (!precision && bufsiz == 1 && buffer[bufsiz] == '0')
-            return;
-    }
-
-    const bool hasextra = extrasiz && extra[0] != 0;
-
-    int pad = 0;
-    if (state.width != State::None) {
-        assert(state.width >= 0);
-        pad = std::max<int>(0, state.width - (bufsiz + (hasextra ? extrasiz : 0)));
-    }
-    char padchar = ' ';
-    if ((state.flags & State::Flag_ZeroPad) && !left && !precision)
-        padchar = '0';
-
-    if (precision)
-        pad = std::max(0, pad - precision);
-
-    if (hasextra && padchar == '0')
-        writer.put(extra, extrasiz);
-
-    if (pad && !left) {
-        if (padchar == '0')
-            writePad<'0'>(writer, pad);
-        else
-            writePad<' '>(writer, pad);
-    }
-
-    if (hasextra && padchar == ' ')
-        writer.put(extra, extrasiz);
-
-    if (precision) {
-        writePad<'0'>(writer, precision);
-    }
-
-    writer.put(buffer, bufsiz);
-
-    if (pad && left) {
-        if (padchar == '0')
-            writePad<'0'>(writer, pad);
-        else
-            writePad<' '>(writer, pad);
-    }
-}
-
-inline void print2_format_ch(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    const uint32_t ch = static_cast<uint32_t>(ArgumentGetter<int32_t>::get(args, argno)) % 256;
-
-    int pad = 0;
-    if (state.width != State::None) {
-        assert(state.width >= 0);
-        pad = std::max<int>(0, state.width - 1);
-    }
-
-    if (pad && !(state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
-    }
-
-    writer.put(static_cast<char>(ch));
-
-    if (pad && (state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
-    }
-}
-
-template<typename ArgType>
-void print2_format_float(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    ArgType number = ArgumentGetter<ArgType>::get(args, argno);
-
-    char extra = 0;
-    if (number >= 0) {
-        if (state.flags & State::Flag_Sign)
-            extra = '+';
-        else if (state.flags & State::Flag_Space)
-            extra = ' ';
-    } else {
-        extra = '-';
-        number = -number;
-    }
-
-    char buffer[2048];
-    const int n = d2fixed_buffered_n(number, state.precision == State::None ? 6 : state.precision, buffer);
-
-    print2_format_buffer(writer, state, buffer, n, &extra, 1);
-}
-
-template<typename ArgType>
-void print2_format_float_exp(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    ArgType number = ArgumentGetter<ArgType>::get(args, argno);
-
-    char extra = 0;
-    if (number >= 0) {
-        if (state.flags & State::Flag_Sign)
-            extra = '+';
-        else if (state.flags & State::Flag_Space)
-            extra = ' ';
-    } else {
-        extra = '-';
-        number = -number;
-    }
-
-    char buffer[2048];
-    const int n = d2exp_buffered_n(number, state.precision == State::None ? 6 : state.precision, buffer);
-
-    print2_format_buffer(writer, state, buffer, n, &extra, 1);
-}
-
-template<typename ArgType>
-void print2_format_float_shortest(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    ArgType number = ArgumentGetter<ArgType>::get(args, argno);
-
-    char extra = 0;
-    if (number >= 0) {
-        if (state.flags & State::Flag_Sign)
-            extra = '+';
-        else if (state.flags & State::Flag_Space)
-            extra = ' ';
-    } else {
-        extra = '-';
-        number = -number;
-    }
-
-    auto chop = [](const char* b, size_t n, int& from, int& len, bool& allzero) -> int {
-        int sub1 = n;
-        int sub2 = -1;
-        int dummy = 0;
-        int e = -1;
-        int* what = &sub1;
-        for (; n > 0; --n) {
-            switch(b[n - 1]) {
-            case '0':
-            case '+':
-                --*what;
-                break;
-            case 'e':
-                --*what;
-                if (what == &dummy) {
-                    sub2 = e = n - 1;
-                    what = &sub2;
-                }
-                break;
-            case '.':
-                ++*what;
-                if (what != &dummy)
-                    what = &dummy;
-                break;
-            default:
-                allzero = false;
-                if (what != &dummy)
-                    what = &dummy;
-                break;
-            }
-        }
-        if (e != -1 && sub2 != -1) {
-            from = sub2;
-            len = e - sub2;
-        }
-        return sub1;
-    };
-
-    const int precision = state.precision == State::None ? 6 : state.precision;
-
-    char buffer1[2048];
-    char buffer2[2048];
-    int n1 = d2exp_buffered_n(number, precision, buffer1);
-    int n2 = d2fixed_buffered_n(number, precision, buffer2);
-    int from1 = 0, len1 = 0;
-    int from2 = 0, len2 = 0;
-    bool az1 = true, az2 = true;
-    n2 = chop(buffer2, n2, from2, len2, az2);
-    n1 = chop(buffer1, n1, from1, len1, az1);
-    if (n1 - len1 < n2 || (!az1 && az2)) {
-        if (len1 > 0) {
-            n1 -= len1;
-            memmove(buffer1 + from1, buffer1 + from1 + len1, n1);
-        }
-        print2_format_buffer(writer, state, buffer1, n1, &extra, 1);
-    } else {
-        print2_format_buffer(writer, state, buffer2, n2, &extra, 1);
-    }
-}
-
-template<typename UnsignedArgType>
-void print2_format_int_8(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    typedef std::numeric_limits<UnsignedArgType> Info;
-
-    UnsignedArgType number = ArgumentGetter<UnsignedArgType>::get(args, argno);
-
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
-
-    char buffer[bufsize];
-    char* bufptr = buffer;
-    char extra = 0;
-
-    if (state.flags & State::Flag_Prefix)
-        extra = '0';
-
-    if (number == 0) {
-        *bufptr++ = '0';
-        extra = 0;
-    } else {
-        char* p_first = bufptr;
-        while (number != 0)
-        {
-            *bufptr++ = '0' + (number & 0x7);
-            number >>= 3;
-        }
-        std::reverse(p_first, bufptr);
-    }
-
-    print2_format_buffer(writer, state, buffer, bufptr - buffer, &extra, 1);
-}
-
-
-template<typename ArgType>
-void print2_format_int_10(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    // adapted from http://ideone.com/nrQfA8
-
-    typedef typename std::make_unsigned<ArgType>::type UnsignedArgType;
-    typedef std::numeric_limits<ArgType> Info;
-
-    const ArgType arg = ArgumentGetter<ArgType>::get(args, argno);
-    UnsignedArgType unumber = arg < 0 ? -arg : arg;
-
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
-
-    char buffer[bufsize];
-    char* bufptr = buffer;
-    char extra = 0;
-
-    if (arg == 0) {
-        *bufptr++ = '0';
-    } else {
-        if (arg < 0) {
-            extra = '-';
-        } else if (state.flags & State::Flag_Sign) {
-            extra = '+';
-        } else if (state.flags & State::Flag_Space) {
-            extra = ' ';
-        }
-        char* p_first = bufptr;
-        while (unumber != 0)
-        {
-            *bufptr++ = '0' + unumber % 10;
-            unumber /= 10;
-        }
-        std::reverse(p_first, bufptr);
-    }
-
-    print2_format_buffer(writer, state, buffer, bufptr - buffer, &extra, 1);
-}
-
-template<typename ArgType, typename UnsignedArgType = ArgType>
-void print2_format_int_16(BufferWriter& writer, const State& state, const char* alphabet, const Arguments& args, int argno)
-{
-    typedef std::numeric_limits<ArgType> Info;
-
-    UnsignedArgType number = ArgumentGetter<ArgType, UnsignedArgType>::get(args, argno);
-
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
-
-    char buffer[bufsize];
-    char* bufptr = buffer;
-    char extra[2] = { 0, 0 };
-
-    if (state.flags & State::Flag_Prefix) {
-        extra[0] = '0';
-        extra[1] = alphabet[16];
-    }
-
-    if (number == 0) {
-        *bufptr++ = '0';
-    } else {
-        char* p_first = bufptr;
-        while (number != 0)
-        {
-            *bufptr++ = alphabet[number & 0xf];
-            number >>= 4;
-        }
-        std::reverse(p_first, bufptr);
-    }
-
-    print2_format_buffer(writer, state, buffer, bufptr - buffer, extra, 2);
-}
-
-inline void print2_format_ptr(BufferWriter& writer, const State& state, const char* alphabet, const Arguments& args, int argno)
-{
-    uintptr_t number = ArgumentGetter<void*, uintptr_t>::get(args, argno);
-    typedef std::numeric_limits<uintptr_t> Info;
-
-    const int digits = Info::digits10;
-    const int bufsize = digits + 2;
-
-    char buffer[bufsize];
-    char* bufptr = buffer;
-    char extra[2] = { '0', 'x' };
-
-    if (number == 0) {
-        *bufptr++ = '(';
-        *bufptr++ = 'n';
-        *bufptr++ = 'i';
-        *bufptr++ = 'l';
-        *bufptr++ = ')';
-        extra[0] = 0;
-    } else {
-        char* p_first = bufptr;
-        while (number != 0)
-        {
-            *bufptr++ = alphabet[number & 0xf];
-            number >>= 4;
-        }
-        std::reverse(p_first, bufptr);
-    }
-
-    print2_format_buffer(writer, state, buffer, bufptr - buffer, extra, 2);
-}
+#include "print2_impl.h"
+#include "print_scan.h"
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
 
 void print2_format_generic(BufferWriter& writer, const State& state, const typename Argument::StringType& str)
 {
@@ -518,37 +13,7 @@ void print2_format_generic(BufferWriter& writer, const State& state, const typen
         assert(state.precision >= 0);
         sz = state.precision;
     }
-    int pad = 0;
-    if (state.width != State::None) {
-        assert(state.width >= 0);
-        pad = std::max<int>(0, state.width - sz);
-    }
-
-    if (pad && !(state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
-    }
-
-    writer.put(str.str, sz);
-
-    if (pad && (state.flags & State::Flag_LeftJustify)) {
-        writePad<' '>(writer, pad);
-    }
-}
-
-inline void print2_format_str(BufferWriter& writer, const State& state, const Arguments& args, int argno)
-{
-    const auto& arg = args.args[argno];
-    switch (arg.type) {
-    case Argument::String:
-        print2_format_generic(writer, state, arg.value.str);
-        break;
-    case Argument::Custom:
-        arg.value.custom.format(writer, state, arg.value.custom.data);
-        break;
-    default:
-        // badness
-        abort();
-    }
+    print2_put_field(writer, state, false, nullptr, 0, 0, str.str, sz);
 }
 
 inline int print2_parse_state(const char* format, int formatoff, State& state)
@@ -633,7 +98,7 @@ inline int print2_parse_state(const char* format, int formatoff, State& state)
     switch (format[formatoff]) {
     case 'h':
         ++formatoff;
-        if (format[formatoff + 1] == 'h') {
+        if (format[formatoff] == 'h') {
             state.length = State::Length_hh;
             ++formatoff;
         } else {
@@ -642,7 +107,7 @@ inline int print2_parse_state(const char* format, int formatoff, State& state)
         break;
     case 'l':
         ++formatoff;
-        if (format[formatoff + 1] == 'l') {
+        if (format[formatoff] == 'l') {
             state.length = State::Length_ll;
             ++formatoff;
         } else {
@@ -672,10 +137,230 @@ inline int print2_parse_state(const char* format, int formatoff, State& state)
     return formatoff;
 }
 
-int print2_helper(char* buffer, size_t bufsiz, const char* format, const Arguments& args)
+enum Print2Conversion : uint8_t
+{
+    Conv_Decimal,
+    Conv_Unsigned,
+    Conv_Octal,
+    Conv_Binary,
+    Conv_HexLower,
+    Conv_HexUpper,
+    Conv_Fixed,
+    Conv_Exp,
+    Conv_ExpUpper,
+    Conv_General,
+    Conv_GeneralUpper,
+    Conv_RoundTrip,
+    Conv_HexFloat,
+    Conv_HexFloatUpper,
+    Conv_Char,
+    Conv_String,
+    Conv_Pointer,
+    Conv_Store,
+    Conv_Count,
+    Conv_Invalid = Conv_Count
+};
+
+constexpr Print2Conversion print2_specifier_conversion(char specifier)
+{
+    return specifier == 'd' || specifier == 'i' ? Conv_Decimal
+        : specifier == 'u' ? Conv_Unsigned
+        : specifier == 'o' ? Conv_Octal
+        : specifier == 'b' ? Conv_Binary
+        : specifier == 'x' ? Conv_HexLower
+        : specifier == 'X' ? Conv_HexUpper
+        : specifier == 'f' || specifier == 'F' ? Conv_Fixed
+        : specifier == 'e' ? Conv_Exp
+        : specifier == 'E' ? Conv_ExpUpper
+        : specifier == 'g' ? Conv_General
+        : specifier == 'G' ? Conv_GeneralUpper
+        : specifier == 'r' ? Conv_RoundTrip
+        : specifier == 'a' ? Conv_HexFloat
+        : specifier == 'A' ? Conv_HexFloatUpper
+        : specifier == 'c' ? Conv_Char
+        : specifier == 's' ? Conv_String
+        : specifier == 'p' ? Conv_Pointer
+        : specifier == 'n' ? Conv_Store
+        : Conv_Invalid;
+}
+
+template<std::size_t... Is>
+constexpr std::array<Print2Conversion, sizeof...(Is)> print2_make_conversions(detail::index_sequence<Is...>)
+{
+    return {{ print2_specifier_conversion(static_cast<char>(Is))... }};
+}
+
+static constexpr std::array<Print2Conversion, 256> print2_conversions = print2_make_conversions(detail::make_index_sequence<256>());
+
+inline Print2Conversion print2_conversion(char specifier)
+{
+    return print2_conversions[static_cast<unsigned char>(specifier)];
+}
+
+typedef void (*Print2Handler)(BufferWriter& writer, const State& state, const Arguments& args, int argno);
+
+inline void print2_format_invalid(BufferWriter&, const State&, const Arguments&, int)
+{
+    print2_error("Invalid argument type for specifier");
+}
+
+static_assert(Argument::Int32 == 0 && Argument::Uint64 == 3 && Argument::Double == 4 && Argument::Float128 == 7
+              && Argument::Pointer == 8 && Argument::Custom == 12 && Argument::TypeCount == 13,
+              "the handler rows are laid out in Argument::Type order");
+
+#define PRINT2_TYPED(Visitor, Type) print2_format_typed<Visitor, Argument::Type>
+#define PRINT2_INVALID print2_format_invalid
+
+#if defined(__SIZEOF_FLOAT128__)
+#define PRINT2_FLOAT128(Visitor) PRINT2_TYPED(Visitor, Float128)
+#else
+#define PRINT2_FLOAT128(Visitor) PRINT2_INVALID
+#endif
+
+#define PRINT2_INTEGER_ROW(Visitor)                                                    \
+    { PRINT2_TYPED(Visitor, Int32), PRINT2_TYPED(Visitor, Uint32),                     \
+      PRINT2_TYPED(Visitor, Int64), PRINT2_TYPED(Visitor, Uint64),                     \
+      PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,                  \
+      PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID }
+
+#define PRINT2_FLOAT_ROW(Visitor)                                                      \
+    { PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,                  \
+      PRINT2_TYPED(Visitor, Double), PRINT2_TYPED(Visitor, Float),                     \
+      PRINT2_TYPED(Visitor, LongDouble), PRINT2_FLOAT128(Visitor),                     \
+      PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID }
+
+// One handler per conversion and argument type, invalid combinations abort.
+// Everything is resolved here so a conversion is a single indirect call
+// with no switch on the type tag left in the handler.
+static const Print2Handler print2_handlers[Conv_Count][Argument::TypeCount] = {
+    PRINT2_INTEGER_ROW(Print2DecimalVisitor<int64_t>),
+    PRINT2_INTEGER_ROW(Print2DecimalVisitor<uint64_t>),
+    PRINT2_INTEGER_ROW(Print2OctalVisitor),
+    PRINT2_INTEGER_ROW(Print2BinaryVisitor),
+    PRINT2_INTEGER_ROW(Print2HexVisitor<false>),
+    PRINT2_INTEGER_ROW(Print2HexVisitor<true>),
+    PRINT2_FLOAT_ROW(Print2FloatVisitor),
+    PRINT2_FLOAT_ROW(Print2FloatExpVisitor<false>),
+    PRINT2_FLOAT_ROW(Print2FloatExpVisitor<true>),
+    PRINT2_FLOAT_ROW(Print2FloatGeneralVisitor<false>),
+    PRINT2_FLOAT_ROW(Print2FloatGeneralVisitor<true>),
+    PRINT2_FLOAT_ROW(Print2FloatRoundTripVisitor),
+    PRINT2_FLOAT_ROW(Print2FloatHexVisitor<false>),
+    PRINT2_FLOAT_ROW(Print2FloatHexVisitor<true>),
+    PRINT2_INTEGER_ROW(Print2CharVisitor),
+    // %s
+    { PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,
+      PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,
+      PRINT2_TYPED(Print2StrVisitor, CString), PRINT2_TYPED(Print2StrVisitor, String), PRINT2_TYPED(Print2StrVisitor, Custom) },
+    // %p
+    { PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,
+      PRINT2_INVALID, PRINT2_INVALID,
+      PRINT2_TYPED(Print2PtrVisitor, Pointer), PRINT2_TYPED(Print2PtrVisitor, IntPointer), PRINT2_TYPED(Print2PtrVisitor, CString),
+      PRINT2_INVALID, PRINT2_INVALID },
+    // %n
+    { PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,
+      PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID,
+      PRINT2_TYPED(Print2StoreVisitor, IntPointer),
+      PRINT2_INVALID, PRINT2_INVALID, PRINT2_INVALID }
+};
+
+#undef PRINT2_FLOAT_ROW
+#undef PRINT2_INTEGER_ROW
+#undef PRINT2_FLOAT128
+#undef PRINT2_INVALID
+#undef PRINT2_TYPED
+
+inline void print2_dispatch(BufferWriter& writer, const State& state, Print2Conversion conversion, const Arguments& args, int argno)
+{
+    assert(argno < static_cast<int>(args.count));
+    print2_handlers[conversion][args.types[argno]](writer, state, args, argno);
+}
+
+struct Print2Program
+{
+    // a run of literal text followed by one conversion
+    struct Conversion
+    {
+        uint32_t literaloff;
+        uint32_t literalsize;
+        State state;
+        Print2Conversion conversion;
+    };
+
+    std::vector<Conversion> conversions;
+    std::string literals;
+    uint32_t trailingoff;
+    uint32_t trailingsize;
+};
+
+const Print2Program* print2_compile(const char* format)
+{
+    Print2Program* program = new Print2Program;
+    std::string& literals = program->literals;
+
+    State state;
+    int formatoff = 0;
+    uint32_t literaloff = 0;
+    for (;;) {
+        switch (format[formatoff]) {
+        case '%':
+            if (format[formatoff + 1] != '%') {
+                clearState(state);
+                formatoff = print2_parse_state(format, formatoff + 1, state);
+                const Print2Conversion conversion = print2_conversion(format[formatoff++]);
+                if (conversion == Conv_Invalid)
+                    print2_error("Invalid specifier");
+                program->conversions.push_back({ literaloff, static_cast<uint32_t>(literals.size()) - literaloff, state, conversion });
+                literaloff = literals.size();
+            } else {
+                literals.push_back(format[formatoff + 1]);
+                formatoff += 2;
+            }
+            break;
+        case '\0':
+            program->trailingoff = literaloff;
+            program->trailingsize = literals.size() - literaloff;
+            return program;
+        default: {
+            const char* end = print_scan_literal(format + formatoff);
+            literals.append(format + formatoff, end);
+            formatoff = end - format;
+            break; }
+        }
+    }
+}
+
+void print2_release(const Print2Program* program)
+{
+    delete program;
+}
+
+int print2_execute(BufferWriter& writer, const Print2Program* program, const Arguments& args)
+{
+    const char* literals = program->literals.data();
+
+    int arg = 0;
+    for (const auto& conversion : program->conversions) {
+        writer.put(literals + conversion.literaloff, conversion.literalsize);
+        if (conversion.state.width != State::Star && conversion.state.precision != State::Star) {
+            print2_dispatch(writer, conversion.state, conversion.conversion, args, arg++);
+        } else {
+            State state = conversion.state;
+            if (state.width == State::Star)
+                state.width = ArgumentGetter<int32_t>::get(args, arg++);
+            if (state.precision == State::Star)
+                state.precision = ArgumentGetter<int32_t>::get(args, arg++);
+            print2_dispatch(writer, state, conversion.conversion, args, arg++);
+        }
+    }
+    writer.put(literals + program->trailingoff, program->trailingsize);
+
+    return writer.terminate();
+}
+
+int print2_helper(BufferWriter& writer, const char* format, const Arguments& args)
 {
     State state;
-    BufferWriter writer(buffer, bufsiz);
 
     int formatoff = 0;
     int arg = 0;
@@ -689,54 +374,10 @@ int print2_helper(char* buffer, size_t bufsiz, const char* format, const Argumen
                     state.width = ArgumentGetter<int32_t>::get(args, arg++);
                 if (state.precision == State::Star)
                     state.precision = ArgumentGetter<int32_t>::get(args, arg++);
-                switch (format[formatoff++]) {
-                case 'd':
-                case 'i':
-                    print2_format_int_10<int64_t>(writer, state, args, arg++);
-                    break;
-                case 'u':
-                    print2_format_int_10<uint64_t>(writer, state, args, arg++);
-                    break;
-                case 'o':
-                    print2_format_int_8<uint64_t>(writer, state, args, arg++);
-                    break;
-                case 'x':
-                    print2_format_int_16<uint64_t>(writer, state, "0123456789abcdefx", args, arg++);
-                    break;
-                case 'X':
-                    print2_format_int_16<uint64_t>(writer, state, "0123456789ABCDEFX", args, arg++);
-                    break;
-                case 'f':
-                case 'F':
-                    print2_format_float<double>(writer, state, args, arg++);
-                    break;
-                case 'e':
-                    print2_format_float_exp<double>(writer, state, args, arg++);
-                    break;
-                case 'g':
-                    print2_format_float_shortest<double>(writer, state, args, arg++);
-                    break;
-                case 'E':
-                case 'a':
-                case 'A':
-                case 'G':
-                    return print2_error("E/a/A/G not supported");
-                case 'c':
-                    print2_format_ch(writer, state, args, arg++);
-                    break;
-                case 's':
-                    print2_format_str(writer, state, args, arg++);
-                    break;
-                case 'p':
-                    print2_format_ptr(writer, state, "0123456789abcdefx", args, arg++);
-                    break;
-                case 'n': {
-                    int* ptr = ArgumentGetter<int*>::get(args, arg++);
-                    *ptr = static_cast<int>(writer.offset());
-                    break; }
-                default:
+                const Print2Conversion conversion = print2_conversion(format[formatoff++]);
+                if (conversion == Conv_Invalid)
                     return print2_error("Invalid specifier");
-                }
+                print2_dispatch(writer, state, conversion, args, arg++);
             } else {
                 writer.put(format[++formatoff]);
                 ++formatoff;
@@ -744,11 +385,232 @@ int print2_helper(char* buffer, size_t bufsiz, const char* format, const Argumen
             break;
         case '\0':
             return writer.terminate();
-        default:
-            writer.put(format[formatoff++]);
-            break;
+        default: {
+            const char* end = print_scan_literal(format + formatoff);
+            writer.put(format + formatoff, end - (format + formatoff));
+            formatoff = end - format;
+            break; }
         }
     }
 
     return 0;
 }
+
+int print2_helper(char* buffer, size_t bufsiz, const char* format, const Arguments& args)
+{
+    BufferWriter writer(buffer, bufsiz);
+    return print2_helper(writer, format, args);
+}
+
+int print2_execute(char* buffer, size_t bufsiz, const Print2Program* program, const Arguments& args)
+{
+    BufferWriter writer(buffer, bufsiz);
+    return print2_execute(writer, program, args);
+}
+
+int print2_append(std::string& out, const char* format, const Arguments& args)
+{
+    DynamicWriter<std::string> writer(out);
+    print2_helper(writer, format, args);
+    return writer.finish();
+}
+
+int print2_append(std::vector<char>& out, const char* format, const Arguments& args)
+{
+    DynamicWriter<std::vector<char> > writer(out);
+    print2_helper(writer, format, args);
+    return writer.finish();
+}
+
+int print2_append(std::string& out, const Print2Program* program, const Arguments& args)
+{
+    DynamicWriter<std::string> writer(out);
+    print2_execute(writer, program, args);
+    return writer.finish();
+}
+
+int print2_append(std::vector<char>& out, const Print2Program* program, const Arguments& args)
+{
+    DynamicWriter<std::vector<char> > writer(out);
+    print2_execute(writer, program, args);
+    return writer.finish();
+}
+
+// What the calling thread has formatted for fd and not written yet
+struct Print2Staging
+{
+    Print2Staging()
+        : fd(-1)
+    {
+    }
+    ~Print2Staging()
+    {
+        flush();
+    }
+
+    bool flush()
+    {
+        bool ok = true;
+        size_t off = 0;
+        while (off < data.size()) {
+            const ssize_t w = ::write(fd, data.data() + off, data.size() - off);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                ok = false;
+                break;
+            }
+            off += w;
+        }
+        // clear keeps the capacity, staging doesn't allocate once it has grown
+        data.clear();
+        return ok;
+    }
+
+    // a spliced argument, it goes out after the first stagedEnd staged bytes
+    struct Segment
+    {
+        size_t stagedEnd;
+        const char* data;
+        size_t size;
+    };
+
+    int fd;
+    std::string data;
+    std::vector<Segment> segments;
+    std::vector<iovec> iov;
+};
+
+static thread_local Print2Staging print2_staging;
+
+// Appends to the staging buffer like DynamicWriter but only records where
+// long arguments go, they are written from the caller's memory
+struct Print2GatherWriter : public DynamicWriter<std::string>
+{
+    Print2GatherWriter(Print2Staging& s, size_t gatherSize)
+        : DynamicWriter<std::string>(s.data), staging(s)
+    {
+        splice = &Print2GatherWriter::spliceSegment;
+        spliceMin = gatherSize;
+    }
+
+    static bool spliceSegment(BufferWriter& writer, const char* data, size_t size)
+    {
+        Print2GatherWriter& gather = static_cast<Print2GatherWriter&>(writer);
+        gather.staging.segments.push_back({ gather.start + gather.bufferoff, data, size });
+        gather.spliced += size;
+        return true;
+    }
+
+    Print2Staging& staging;
+};
+
+static int print2_run(BufferWriter& writer, const char* format, const Arguments& args)
+{
+    return print2_helper(writer, format, args);
+}
+
+static int print2_run(BufferWriter& writer, const Print2Program* program, const Arguments& args)
+{
+    return print2_execute(writer, program, args);
+}
+
+static bool print2_writev(int fd, iovec* iov, size_t count)
+{
+    while (count) {
+        const ssize_t w = ::writev(fd, iov, static_cast<int>(std::min<size_t>(count, IOV_MAX)));
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        size_t done = w;
+        while (count && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+// Whatever was staged for the descriptor, this call's literals and short
+// conversions and its long arguments in place, all in one writev
+template<typename Source>
+static int print2_fd_gathered(Print2Staging& staging, const Print2Fd& target, Source source, const Arguments& args)
+{
+    staging.segments.clear();
+    Print2GatherWriter writer(staging, target.gatherSize);
+    print2_run(writer, source, args);
+    const int n = static_cast<int>(writer.offset());
+    writer.finish();
+
+    staging.iov.clear();
+    char* data = &staging.data[0];
+    size_t off = 0;
+    for (const auto& segment : staging.segments) {
+        if (segment.stagedEnd > off)
+            staging.iov.push_back({ data + off, segment.stagedEnd - off });
+        staging.iov.push_back({ const_cast<char*>(segment.data), segment.size });
+        off = segment.stagedEnd;
+    }
+    if (staging.data.size() > off)
+        staging.iov.push_back({ data + off, staging.data.size() - off });
+
+    const bool ok = print2_writev(staging.fd, staging.iov.data(), staging.iov.size());
+    staging.data.clear();
+    return ok ? n : -1;
+}
+
+template<typename Source>
+static int print2_fd_staged(const Print2Fd& target, Source source, const Arguments& args)
+{
+    Print2Staging& staging = print2_staging;
+    bool ok = true;
+    if (staging.fd != target.fd) {
+        ok = staging.flush();
+        staging.fd = target.fd;
+    }
+
+    if (target.flush == Print2Flush_Gather) {
+        const int n = print2_fd_gathered(staging, target, source, args);
+        return ok ? n : -1;
+    }
+
+    const size_t start = staging.data.size();
+    const int n = print2_append(staging.data, source, args);
+
+    switch (target.flush) {
+    case Print2Flush_Line:
+        if (memchr(staging.data.data() + start, '\n', n))
+            ok = staging.flush() && ok;
+        break;
+    case Print2Flush_Size:
+        if (staging.data.size() >= target.flushSize)
+            ok = staging.flush() && ok;
+        break;
+    case Print2Flush_Explicit:
+    case Print2Flush_Gather:
+        break;
+    }
+    return ok ? n : -1;
+}
+
+int print2_fd(const Print2Fd& target, const char* format, const Arguments& args)
+{
+    return print2_fd_staged(target, format, args);
+}
+
+int print2_fd(const Print2Fd& target, const Print2Program* program, const Arguments& args)
+{
+    return print2_fd_staged(target, program, args);
+}
+
+int print2_flush()
+{
+    return print2_staging.flush() ? 0 : -1;
+}
@@ -0,0 +1,879 @@
+#ifndef PRINT2_IMPL_H
+#define PRINT2_IMPL_H
+
+#include <cmath>
+#include <memory>
+#include "print2.h"
+#include "print_digits.h"
+#include "print_float.h"
+
+struct State
+{
+    enum { None = -1, Star = -2 };
+    enum Flags
+    {
+        Flag_None        = 0x00,
+        Flag_LeftJustify = 0x02,
+        Flag_Sign        = 0x04,
+        Flag_Space       = 0x08,
+        Flag_Prefix      = 0x10,
+        Flag_ZeroPad     = 0x20
+    };
+    enum Length
+    {
+        Length_None,
+        Length_hh,
+        Length_h,
+        Length_ll,
+        Length_l,
+        Length_j,
+        Length_z,
+        Length_t,
+        Length_L
+    };
+    int32_t flags;
+    Length length;
+    int32_t width; // can be Star which means that an additional argument will contain the actual number
+    int32_t precision; // can be Star which means that an additional argument will contain the actual number
+};
+
+inline void clearState(State& state)
+{
+    state.flags = State::Flag_None;
+    state.length = State::Length_None;
+    state.width = state.precision = State::None;
+};
+
+struct BufferWriter
+{
+    // called when n more bytes don't fit, needed is the size the buffer has
+    // to have. it updates buffer and buffersize and returns false if it
+    // can't grow, the writer then truncates like a fixed buffer would
+    typedef bool (*Grow)(BufferWriter& writer, size_t needed);
+    // offered strings of at least spliceMin bytes that stay valid until the
+    // writer is done, a gathering writer keeps a reference instead of copying
+    // and adds size to spliced. returning false makes the writer copy it.
+    typedef bool (*Splice)(BufferWriter& writer, const char* data, size_t size);
+
+    BufferWriter(char* b, size_t s, Grow g = nullptr)
+        : buffer(b), buffersize(s), bufferoff(0), grow(g), splice(nullptr), spliceMin(std::numeric_limits<size_t>::max()), spliced(0)
+    {
+    }
+
+    char* buffer;
+    size_t buffersize;
+    size_t bufferoff;
+    Grow grow;
+    Splice splice;
+    size_t spliceMin;
+    size_t spliced;
+
+    void put(char c) { if (bufferoff < buffersize || (grow && grow(*this, bufferoff + 1))) buffer[bufferoff++] = c; else ++bufferoff; }
+    void put(const char* c, size_t s) { if (grow && s > buffersize - bufferoff) grow(*this, bufferoff + s); const ssize_t m = std::min<ssize_t>(s, buffersize - bufferoff); if (m > 0) { memcpy(buffer + bufferoff, c, m); } bufferoff += s; }
+
+    // reserve hands out n bytes at the current offset for the caller to fill
+    // in directly, followed by commit(n). it returns nullptr when fewer than n
+    // bytes are left, the caller then has to fall back to put() which truncates.
+    char* reserve(size_t n) { return (bufferoff <= buffersize && n <= buffersize - bufferoff) || (grow && grow(*this, bufferoff + n)) ? buffer + bufferoff : nullptr; }
+    void commit(size_t n) { bufferoff += n; }
+
+    // data has to outlive the writer, only arguments qualify
+    void putStable(const char* c, size_t s) { if (s < spliceMin || !splice(*this, c, s)) put(c, s); }
+
+    size_t offset() const { return bufferoff + spliced; }
+    size_t size() const { return buffersize; }
+    size_t terminate() { if (bufferoff >= buffersize && grow) grow(*this, bufferoff + 1); if (bufferoff < buffersize) buffer[bufferoff] = '\0'; else buffer[buffersize - 1] = '\0'; return bufferoff + spliced; }
+};
+
+// Appends to a std::string or std::vector<char>. The container is resized to
+// a window past its old end that is handed to the writer, running out of it
+// doubles the window. Only the window is ever zero filled and growing within
+// the container's capacity doesn't allocate. finish() trims the container to
+// what was written.
+template<typename Container>
+struct DynamicWriter : public BufferWriter
+{
+    enum { InitialWindow = 256 };
+
+    DynamicWriter(Container& c)
+        : BufferWriter(nullptr, 0, &DynamicWriter::growContainer), start(c.size()), container(c)
+    {
+        const size_t spare = container.capacity() - start;
+        resize(spare ? std::min<size_t>(spare, InitialWindow) : static_cast<size_t>(InitialWindow));
+    }
+
+    size_t finish()
+    {
+        container.resize(start + bufferoff);
+        return bufferoff;
+    }
+
+protected:
+    // where this writer's output starts in the container
+    const size_t start;
+
+private:
+    void resize(size_t window)
+    {
+        container.resize(start + window);
+        buffer = &container[start];
+        buffersize = window;
+    }
+
+    static bool growContainer(BufferWriter& writer, size_t needed)
+    {
+        DynamicWriter& dynamic = static_cast<DynamicWriter&>(writer);
+        dynamic.resize(std::max<size_t>(needed, dynamic.buffersize * 2));
+        return true;
+    }
+
+    Container& container;
+};
+
+// Format into any writer, the fixed buffer and container variants of
+// print2_helper, print2_execute and print2_append go through these
+int print2_helper(BufferWriter& writer, const char* format, const Arguments& args);
+int print2_execute(BufferWriter& writer, const Print2Program* program, const Arguments& args);
+
+template <std::size_t N, typename T>
+constexpr std::array<T, N> make_array(const T& value)
+{
+    return detail::make_array(value, detail::make_index_sequence<N>());
+}
+
+template<char Pad>
+void writePad(BufferWriter& writer, int num)
+{
+    enum { Size = 64 };
+
+    constexpr auto a = make_array<Size>(Pad);
+
+    while (num > Size) {
+        writer.put(a.data(), Size);
+        num -= Size;
+    }
+    if (num > 0) {
+        writer.put(a.data(), num);
+    }
+}
+
+template<size_t N>
+inline int print2_error(const char (&type)[N])
+{
+    fwrite(type, 1, N, stderr);
+    fwrite("\n", 1, 2, stderr);
+    fflush(stderr);
+    abort();
+    return 0;
+}
+
+template<typename ArgType, typename ReturnArgType = ArgType>
+struct ArgumentGetter
+{
+    static ReturnArgType get(const Arguments& args, size_t idx);
+};
+
+#define GET_ARG(tp, rtp, val)                                   \
+    template<>                                                  \
+    struct ArgumentGetter<tp, rtp>                              \
+    {                                                           \
+        static rtp get(const Arguments& args, size_t idx)       \
+        {                                                       \
+            assert(idx < args.count);                           \
+            return static_cast<rtp>(args.values[idx].val);      \
+        }                                                       \
+    }
+
+GET_ARG(int32_t, int32_t, i32);
+
+#undef GET_ARG
+
+// Reads an argument whose type is already known, the handler table in
+// print2_impl.cpp picks the instantiation from the type tag
+template<Argument::Type Type>
+struct TypedArgumentGetter;
+
+#define GET_TYPED_ARG(tp, rtp, expr)                            \
+    template<>                                                  \
+    struct TypedArgumentGetter<Argument::tp>                    \
+    {                                                           \
+        static rtp get(const Arguments& args, size_t idx)       \
+        {                                                       \
+            assert(idx < args.count);                           \
+            const Argument::Value& value = args.values[idx];    \
+            return expr;                                        \
+        }                                                       \
+    }
+
+GET_TYPED_ARG(Int32, int32_t, value.i32);
+GET_TYPED_ARG(Uint32, uint32_t, value.u32);
+GET_TYPED_ARG(Int64, int64_t, value.i64);
+GET_TYPED_ARG(Uint64, uint64_t, value.u64);
+GET_TYPED_ARG(Double, double, value.dbl);
+GET_TYPED_ARG(Float, float, value.flt);
+// the wide types are only kept as they are when there are kernels for them,
+// otherwise the conversions see them as doubles
+#if defined(PRINT_WIDE_FLOAT)
+GET_TYPED_ARG(LongDouble, long double, *value.ldbl);
+#else
+GET_TYPED_ARG(LongDouble, double, static_cast<double>(*value.ldbl));
+#endif
+#if defined(__SIZEOF_FLOAT128__)
+#if defined(PRINT_WIDE_FLOAT)
+GET_TYPED_ARG(Float128, __float128, *value.f128);
+#else
+GET_TYPED_ARG(Float128, double, static_cast<double>(*value.f128));
+#endif
+#endif
+GET_TYPED_ARG(Pointer, const void*, value.ptr);
+GET_TYPED_ARG(IntPointer, int*, static_cast<int*>(value.ptr));
+GET_TYPED_ARG(CString, const char*, value.cstr);
+GET_TYPED_ARG(String, const Argument::StringType&, args.outOfLine[value.slot].str);
+GET_TYPED_ARG(Custom, const Argument::CustomType&, args.outOfLine[value.slot].custom);
+
+#undef GET_TYPED_ARG
+
+// Handler for one conversion and one argument type, Visitor does the
+// formatting and gets the argument already decoded
+template<typename Visitor, Argument::Type Type>
+void print2_format_typed(BufferWriter& writer, const State& state, const Arguments& args, int argno)
+{
+    Visitor { writer, state }(TypedArgumentGetter<Type>::get(args, argno));
+}
+
+inline size_t print2_field_pad(const State& state, size_t len)
+{
+    if (state.width == State::None)
+        return 0;
+    assert(state.width >= 0);
+    return static_cast<size_t>(state.width) > len ? state.width - len : 0;
+}
+
+// A field is laid out as [pad][extra][zero pad][zeros][digits] when right
+// justified and [extra][zeros][digits][pad] when left justified. extra is the
+// sign or the 0x/0 prefix and is skipped if it starts with a nul.
+//
+// Reserves the whole field in one go and writes everything but the digits,
+// returning where the digits go. Returns nullptr without writing anything
+// when the buffer is too short, the caller then goes through
+// print2_put_field_slow instead.
+inline char* print2_reserve_field(BufferWriter& writer, const State& state, bool zeropad, const char* extra, size_t extrasiz, size_t zeros, size_t digitsiz)
+{
+    if (extrasiz && !extra[0])
+        extrasiz = 0;
+    const bool left = state.flags & State::Flag_LeftJustify;
+    const size_t len = extrasiz + zeros + digitsiz;
+    const size_t pad = print2_field_pad(state, len);
+
+    char* out = writer.reserve(len + pad);
+    if (!out)
+        return nullptr;
+    writer.commit(len + pad);
+
+    if (pad) {
+        if (left) {
+            memset(out + len, ' ', pad);
+        } else if (!zeropad) {
+            memset(out, ' ', pad);
+            out += pad;
+        }
+    }
+    for (size_t i = 0; i < extrasiz; ++i)
+        *out++ = extra[i];
+    if (pad && zeropad && !left) {
+        memset(out, '0', pad);
+        out += pad;
+    }
+    if (zeros) {
+        memset(out, '0', zeros);
+        out += zeros;
+    }
+    return out;
+}
+
+inline void print2_put_field_slow(BufferWriter& writer, const State& state, bool zeropad, const char* extra, size_t extrasiz, size_t zeros, const char* digits, size_t digitsiz)
+{
+    if (extrasiz && !extra[0])
+        extrasiz = 0;
+    const bool left = state.flags & State::Flag_LeftJustify;
+    const size_t pad = print2_field_pad(state, extrasiz + zeros + digitsiz);
+
+    if (pad && !left && !zeropad)
+        writePad<' '>(writer, pad);
+    if (extrasiz)
+        writer.put(extra, extrasiz);
+    if (pad && !left && zeropad)
+        writePad<'0'>(writer, pad);
+    writePad<'0'>(writer, zeros);
+    writer.put(digits, digitsiz);
+    if (pad && left)
+        writePad<' '>(writer, pad);
+}
+
+inline void print2_put_field(BufferWriter& writer, const State& state, bool zeropad, const char* extra, size_t extrasiz, size_t zeros, const char* digits, size_t digitsiz)
+{
+    char* out = print2_reserve_field(writer, state, zeropad, extra, extrasiz, zeros, digitsiz);
+    if (out) {
+        memcpy(out, digits, digitsiz);
+    } else {
+        print2_put_field_slow(writer, state, zeropad, extra, extrasiz, zeros, digits, digitsiz);
+    }
+}
+
+// floating point conversions have already applied the precision
+inline void print2_format_buffer(BufferWriter& writer, const State& state, const char* buffer, size_t bufsiz, const char* extra, size_t extrasiz)
+{
+    print2_put_field(writer, state, state.flags & State::Flag_ZeroPad, extra, extrasiz, 0, buffer, bufsiz);
+}
+
+// for integer conversions the precision is the minimum number of digits, it
+// turns off zero padding and a precision of 0 prints nothing for the value 0
+inline size_t print2_integer_zeros(const State& state, size_t& bufsiz, bool iszero)
+{
+    if (state.precision == State::None)
+        return 0;
+    assert(state.precision >= 0);
+    if (!state.precision && iszero)
+        bufsiz = 0;
+    return static_cast<size_t>(state.precision) > bufsiz ? state.precision - bufsiz : 0;
+}
+
+inline bool print2_integer_zeropad(const State& state)
+{
+    return (state.flags & State::Flag_ZeroPad) && state.precision == State::None;
+}
+
+inline void print2_format_integer(BufferWriter& writer, const State& state, const char* buffer, size_t bufsiz, const char* extra, size_t extrasiz)
+{
+    const size_t zeros = print2_integer_zeros(state, bufsiz, bufsiz == 1 && buffer[0] == '0');
+    print2_put_field(writer, state, print2_integer_zeropad(state), extra, extrasiz, zeros, buffer, bufsiz);
+}
+
+inline void print2_format_ch(BufferWriter& writer, const State& state, int32_t arg)
+{
+    const char ch = static_cast<char>(static_cast<uint32_t>(arg) % 256);
+    print2_put_field(writer, state, false, nullptr, 0, 0, &ch, 1);
+}
+
+struct Print2CharVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_ch(writer, state, static_cast<int32_t>(number)); }
+};
+
+typedef int (*Print2FloatConvert)(double number, uint32_t precision, char* result);
+
+// the length is known up front so ryu writes the digits straight into the
+// field, only a field that doesn't fit goes through scratch memory
+inline void print2_format_float_direct(BufferWriter& writer, const State& state, double number, uint32_t precision, int len, Print2FloatConvert convert, char extra)
+{
+    const bool zeropad = state.flags & State::Flag_ZeroPad;
+    char* out = print2_reserve_field(writer, state, zeropad, &extra, 1, 0, len);
+    if (out) {
+        convert(number, precision, out);
+    } else {
+        std::unique_ptr<char[]> scratch(new char[len]);
+        convert(number, precision, scratch.get());
+        print2_put_field_slow(writer, state, zeropad, &extra, 1, 0, scratch.get(), len);
+    }
+}
+
+// The binary32 %e kernel has no length function, it writes to a buffer.
+// Floats outside of its fast range and %f take the double path, the widening
+// is exact so it prints the same digits.
+inline void print2_format_float_fixed(BufferWriter& writer, const State& state, double number, uint32_t precision, char extra)
+{
+    print2_format_float_direct(writer, state, number, precision, d2fixed_length(number, precision), d2fixed_buffered_n, extra);
+}
+
+inline void print2_format_float_fixed(BufferWriter& writer, const State& state, float number, uint32_t precision, char extra)
+{
+    print2_format_float_fixed(writer, state, static_cast<double>(number), precision, extra);
+}
+
+inline void print2_format_float_scientific(BufferWriter& writer, const State& state, double number, uint32_t precision, bool upper, char extra)
+{
+    print2_format_float_direct(writer, state, number, precision, d2exp_length(number, precision),
+                               upper ? print_exp_upper_n<double> : d2exp_buffered_n, extra);
+}
+
+inline void print2_format_float_scientific(BufferWriter& writer, const State& state, float number, uint32_t precision, bool upper, char extra)
+{
+    if (!print_float_exp_scaled(number, precision)) {
+        print2_format_float_scientific(writer, state, static_cast<double>(number), precision, upper, extra);
+        return;
+    }
+    // sign, first digit, point, 8 digits and e-18
+    char buffer[16];
+    const int n = upper ? print_exp_upper_n(number, precision, buffer) : f2exp_buffered_n(number, precision, buffer);
+    print2_format_buffer(writer, state, buffer, n, &extra, 1);
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+// The wide types write to a buffer as well, sized from the binary exponent
+// when it doesn't fit on the stack
+enum { Print2FloatBuffer = 160 };
+
+template<typename T>
+inline void print2_format_float_wide(BufferWriter& writer, const State& state, T number, uint32_t precision, bool fixed, bool upper, char extra)
+{
+    const size_t bound = fixed ? print_wide_fixed_bound(print_wide_float(number), precision) : precision + PrintWideExpExtra;
+    char stack[Print2FloatBuffer];
+    std::unique_ptr<char[]> heap;
+    char* buffer = stack;
+    if (bound > sizeof(stack)) {
+        heap.reset(new char[bound]);
+        buffer = heap.get();
+    }
+    const int n = fixed ? print_fixed_n(number, precision, buffer) : print_exp_n(number, precision, buffer);
+    if (upper)
+        print_upper(buffer, n);
+    print2_format_buffer(writer, state, buffer, n, &extra, 1);
+}
+
+inline void print2_format_float_fixed(BufferWriter& writer, const State& state, long double number, uint32_t precision, char extra)
+{
+    print2_format_float_wide(writer, state, number, precision, true, false, extra);
+}
+
+inline void print2_format_float_scientific(BufferWriter& writer, const State& state, long double number, uint32_t precision, bool upper, char extra)
+{
+    print2_format_float_wide(writer, state, number, precision, false, upper, extra);
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+inline void print2_format_float_fixed(BufferWriter& writer, const State& state, __float128 number, uint32_t precision, char extra)
+{
+    print2_format_float_wide(writer, state, number, precision, true, false, extra);
+}
+
+inline void print2_format_float_scientific(BufferWriter& writer, const State& state, __float128 number, uint32_t precision, bool upper, char extra)
+{
+    print2_format_float_wide(writer, state, number, precision, false, upper, extra);
+}
+#endif
+#endif
+
+template<typename ArgType>
+void print2_format_float(BufferWriter& writer, const State& state, ArgType number)
+{
+
+    char extra = 0;
+    if (!print_signbit(number)) {
+        if (state.flags & State::Flag_Sign)
+            extra = '+';
+        else if (state.flags & State::Flag_Space)
+            extra = ' ';
+    } else {
+        extra = '-';
+        number = -number;
+    }
+
+    const uint32_t precision = state.precision == State::None ? 6 : state.precision;
+
+    uint64_t scaled;
+    if (print_fixed_scaled(number, precision, scaled)) {
+        int intdigits;
+        const int len = print_fixed_length(scaled, precision, intdigits);
+        const bool zeropad = state.flags & State::Flag_ZeroPad;
+        char* out = print2_reserve_field(writer, state, zeropad, &extra, 1, 0, len);
+        if (out) {
+            print_write_fixed(out, scaled, precision, intdigits);
+        } else {
+            char buffer[48];
+            print_write_fixed(buffer, scaled, precision, intdigits);
+            print2_put_field_slow(writer, state, zeropad, &extra, 1, 0, buffer, len);
+        }
+        return;
+    }
+
+    print2_format_float_fixed(writer, state, number, precision, extra);
+}
+
+struct Print2FloatVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_float<T>(writer, state, number); }
+};
+
+template<typename ArgType, bool Upper = false>
+void print2_format_float_exp(BufferWriter& writer, const State& state, ArgType number)
+{
+
+    char extra = 0;
+    if (!print_signbit(number)) {
+        if (state.flags & State::Flag_Sign)
+            extra = '+';
+        else if (state.flags & State::Flag_Space)
+            extra = ' ';
+    } else {
+        extra = '-';
+        number = -number;
+    }
+
+    const uint32_t precision = state.precision == State::None ? 6 : state.precision;
+    print2_format_float_scientific(writer, state, number, precision, Upper, extra);
+}
+
+template<bool Upper>
+struct Print2FloatExpVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_float_exp<T, Upper>(writer, state, number); }
+};
+
+template<typename ArgType, bool Upper = false>
+void print2_format_float_general(BufferWriter& writer, const State& state, ArgType number)
+{
+
+    char extra = 0;
+    if (!print_signbit(number)) {
+        if (state.flags & State::Flag_Sign)
+            extra = '+';
+        else if (state.flags & State::Flag_Space)
+            extra = ' ';
+    } else {
+        extra = '-';
+        number = -number;
+    }
+
+    const int precision = state.precision == State::None ? 6 : state.precision;
+    const bool alternate = state.flags & State::Flag_Prefix;
+    const int digits = print_general_digits(number, precision, alternate);
+    const size_t size = print_general_size(digits);
+    char stack[PrintGeneralBuffer];
+    std::unique_ptr<char[]> heap;
+    char* buffer = stack;
+    if (size > sizeof(stack)) {
+        heap.reset(new char[size]);
+        buffer = heap.get();
+    }
+    int n;
+    const char* out = print_format_general(number, precision, digits, alternate, Upper, buffer, n);
+
+    print2_format_buffer(writer, state, out, n, &extra, 1);
+}
+
+template<bool Upper>
+struct Print2FloatGeneralVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_float_general<T, Upper>(writer, state, number); }
+};
+
+// shortest round trip, the precision is ignored
+template<typename ArgType>
+void print2_format_float_roundtrip(BufferWriter& writer, const State& state, ArgType number)
+{
+    char extra = 0;
+    if (!print_signbit(number)) {
+        if (state.flags & State::Flag_Sign)
+            extra = '+';
+        else if (state.flags & State::Flag_Space)
+            extra = ' ';
+    } else {
+        extra = '-';
+        number = -number;
+    }
+
+    char buffer[PrintShortestBuffer];
+    const int n = print_format_shortest(number, state.flags & State::Flag_Prefix, buffer);
+
+    print2_format_buffer(writer, state, buffer, n, &extra, 1);
+}
+
+struct Print2FloatRoundTripVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_float_roundtrip<T>(writer, state, number); }
+};
+
+// hex floats, the 0x prefix is part of extra so zero padding goes after it
+template<typename ArgType, bool Upper = false>
+void print2_format_float_hex(BufferWriter& writer, const State& state, ArgType number)
+{
+    char prefix[3] = { 0, '0', Upper ? 'X' : 'x' };
+    if (!print_signbit(number)) {
+        if (state.flags & State::Flag_Sign)
+            prefix[0] = '+';
+        else if (state.flags & State::Flag_Space)
+            prefix[0] = ' ';
+    } else {
+        prefix[0] = '-';
+        number = -number;
+    }
+
+    auto hex = print_hex_float(number);
+    if (hex.special) {
+        char buffer[8];
+        const int n = strlen(hex.special);
+        memcpy(buffer, hex.special, n);
+        if (Upper)
+            print_upper(buffer, n);
+        print2_format_buffer(writer, state, buffer, n, prefix, 1);
+        return;
+    }
+
+    print_hex_round(hex, state.precision);
+    const bool alternate = state.flags & State::Flag_Prefix;
+    const int len = print_hex_float_length(hex, alternate);
+    const char* extra = prefix[0] ? prefix : prefix + 1;
+    const size_t extrasiz = prefix[0] ? 3 : 2;
+    const bool zeropad = state.flags & State::Flag_ZeroPad;
+    char* out = print2_reserve_field(writer, state, zeropad, extra, extrasiz, 0, len);
+    if (out) {
+        print_write_hex_float(out, hex, alternate, Upper);
+    } else {
+        std::unique_ptr<char[]> scratch(new char[len]);
+        print_write_hex_float(scratch.get(), hex, alternate, Upper);
+        print2_put_field_slow(writer, state, zeropad, extra, extrasiz, 0, scratch.get(), len);
+    }
+}
+
+template<bool Upper>
+struct Print2FloatHexVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_float_hex<T, Upper>(writer, state, number); }
+};
+
+template<int Shift>
+inline void print2_write_radix(char* out, uint64_t number, int digits, const char* alphabet)
+{
+    switch (Shift) {
+    case 4:
+        print_write_hex(out, number, digits, alphabet);
+        break;
+    case 3:
+        print_write_octal(out, number, digits);
+        break;
+    case 1:
+        print_write_binary(out, number, digits);
+        break;
+    }
+}
+
+// power of two bases, the digit count comes from the bit width so the digits
+// are written straight into the reserved field
+template<int Shift>
+void print2_format_radix(BufferWriter& writer, const State& state, const char* alphabet, uint64_t number, const char* extra, size_t extrasiz)
+{
+    const int digits = print_radix_length<Shift>(number);
+    size_t len = digits;
+    const size_t zeros = print2_integer_zeros(state, len, number == 0);
+    const bool zeropad = print2_integer_zeropad(state);
+
+    char* out = print2_reserve_field(writer, state, zeropad, extra, extrasiz, zeros, len);
+    if (out) {
+        if (len)
+            print2_write_radix<Shift>(out, number, digits, alphabet);
+    } else {
+        char buffer[64];
+        print2_write_radix<Shift>(buffer, number, digits, alphabet);
+        print2_put_field_slow(writer, state, zeropad, extra, extrasiz, zeros, buffer, len);
+    }
+}
+
+template<typename UnsignedArgType>
+void print2_format_int_8(BufferWriter& writer, const State& state, UnsignedArgType number)
+{
+    // the prefix only has to make sure the output starts with a 0, precision
+    // zeros already do that
+    char extra = 0;
+    if (state.flags & State::Flag_Prefix) {
+        size_t len = print_radix_length<3>(number);
+        if (!print2_integer_zeros(state, len, number == 0) && (number != 0 || !len))
+            extra = '0';
+    }
+
+    print2_format_radix<3>(writer, state, nullptr, number, &extra, 1);
+}
+
+struct Print2OctalVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_int_8<uint64_t>(writer, state, static_cast<uint64_t>(number)); }
+};
+
+template<typename ArgType>
+void print2_format_int_10(BufferWriter& writer, const State& state, ArgType arg)
+{
+    typedef typename std::make_unsigned<ArgType>::type UnsignedArgType;
+
+    const UnsignedArgType unumber = arg < 0 ? UnsignedArgType(0) - static_cast<UnsignedArgType>(arg) : static_cast<UnsignedArgType>(arg);
+
+    char extra = 0;
+    if (arg < 0) {
+        extra = '-';
+    } else if (state.flags & State::Flag_Sign) {
+        extra = '+';
+    } else if (state.flags & State::Flag_Space) {
+        extra = ' ';
+    }
+
+    const int digits = print_decimal_length(unumber);
+    size_t len = digits;
+    const size_t zeros = print2_integer_zeros(state, len, unumber == 0);
+    const bool zeropad = print2_integer_zeropad(state);
+
+    char* out = print2_reserve_field(writer, state, zeropad, &extra, 1, zeros, len);
+    if (out) {
+        if (len)
+            print_write_decimal(out, unumber, digits);
+    } else {
+        char buffer[std::numeric_limits<uint64_t>::digits10 + 1];
+        print_write_decimal(buffer, unumber, digits);
+        print2_put_field_slow(writer, state, zeropad, &extra, 1, zeros, buffer, len);
+    }
+}
+
+template<typename ArgType>
+struct Print2DecimalVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_int_10<ArgType>(writer, state, static_cast<ArgType>(number)); }
+};
+
+template<typename UnsignedArgType>
+void print2_format_int_16(BufferWriter& writer, const State& state, const char* alphabet, UnsignedArgType number)
+{
+    char extra[2] = { 0, 0 };
+    if ((state.flags & State::Flag_Prefix) && number != 0) {
+        extra[0] = '0';
+        extra[1] = alphabet[16];
+    }
+
+    print2_format_radix<4>(writer, state, alphabet, number, extra, 2);
+}
+
+template<bool Upper>
+struct Print2HexVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const
+    {
+        print2_format_int_16<uint64_t>(writer, state, Upper ? "0123456789ABCDEFX" : "0123456789abcdefx", static_cast<uint64_t>(number));
+    }
+};
+
+template<typename UnsignedArgType>
+void print2_format_int_2(BufferWriter& writer, const State& state, UnsignedArgType number)
+{
+    char extra[2] = { 0, 0 };
+    if ((state.flags & State::Flag_Prefix) && number != 0) {
+        extra[0] = '0';
+        extra[1] = 'b';
+    }
+
+    print2_format_radix<1>(writer, state, nullptr, number, extra, 2);
+}
+
+struct Print2BinaryVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    template<typename T>
+    void operator()(T number) const { print2_format_int_2<uint64_t>(writer, state, static_cast<uint64_t>(number)); }
+};
+
+inline void print2_format_ptr(BufferWriter& writer, const State& state, const char* alphabet, uintptr_t number)
+{
+    if (number == 0) {
+        print2_format_buffer(writer, state, "(nil)", 5, "", 0);
+        return;
+    }
+
+    const char extra[2] = { '0', 'x' };
+    const size_t digits = print_radix_length<4>(number);
+    char* out = print2_reserve_field(writer, state, state.flags & State::Flag_ZeroPad, extra, 2, 0, digits);
+    if (out) {
+        print_write_hex(out, number, digits, alphabet);
+    } else {
+        char buffer[16];
+        print_write_hex(buffer, number, digits, alphabet);
+        print2_put_field_slow(writer, state, state.flags & State::Flag_ZeroPad, extra, 2, 0, buffer, digits);
+    }
+}
+
+// any pointer argument, %p of a C string prints the address
+struct Print2PtrVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    void operator()(const void* ptr) const { print2_format_ptr(writer, state, "0123456789abcdefx", reinterpret_cast<uintptr_t>(ptr)); }
+};
+
+// %s of an argument, which lives until the call returns so a long one can be
+// spliced into a gathering writer instead of copied
+inline void print2_format_string(BufferWriter& writer, const State& state, const char* str, size_t len)
+{
+    if (state.precision != State::None && static_cast<size_t>(state.precision) < len) {
+        assert(state.precision >= 0);
+        len = state.precision;
+    }
+    if (len < writer.spliceMin) {
+        print2_put_field(writer, state, false, nullptr, 0, 0, str, len);
+        return;
+    }
+    const bool left = state.flags & State::Flag_LeftJustify;
+    const size_t pad = print2_field_pad(state, len);
+    if (pad && !left)
+        writePad<' '>(writer, pad);
+    writer.putStable(str, len);
+    if (pad && left)
+        writePad<' '>(writer, pad);
+}
+
+struct Print2StrVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    void operator()(const char* str) const
+    {
+        // like printf, nothing past the precision is read
+        const size_t len = state.precision >= 0 ? strnlen(str, state.precision) : strlen(str);
+        print2_format_string(writer, state, str, len);
+    }
+    void operator()(const Argument::StringType& str) const { print2_format_string(writer, state, str.str, str.len); }
+    void operator()(const Argument::CustomType& custom) const { custom.format(writer, state, custom.data); }
+};
+
+struct Print2StoreVisitor
+{
+    BufferWriter& writer;
+    const State& state;
+
+    void operator()(int* ptr) const { *ptr = static_cast<int>(writer.offset()); }
+};
+
+#endif // PRINT2_IMPL_H
@@ -0,0 +1,266 @@
+#include "print2_impl.h"
+#include <memory>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// The first 4KB of the file. committed counts the bytes of complete
+// messages following the header, it is stored with release once a message
+// is done so anyone reading it sees no partial message.
+struct Print2MapHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t committed;
+};
+
+const char print2_map_magic[8] = { 'p', 'r', 'i', 'n', 't', '2', 'l', 'g' };
+
+enum { Print2MapVersion = 1, Print2MapHeaderSize = 4096 };
+
+bool print2_map_valid(const Print2MapHeader& header, off_t fileSize)
+{
+    return !memcmp(header.magic, print2_map_magic, sizeof(print2_map_magic))
+        && header.version == Print2MapVersion
+        && header.headerSize == Print2MapHeaderSize
+        && header.committed <= static_cast<uint64_t>(fileSize - Print2MapHeaderSize);
+}
+
+} // anonymous namespace
+
+struct Print2MapSink
+{
+    Print2MapSink(int f, size_t p, size_t c)
+        : fd(f), pageSize(p), chunkSize(c), header(nullptr), window(nullptr), windowStart(0), windowSize(0),
+          fileSize(0), cursor(Print2MapHeaderSize), failed(false)
+    {
+    }
+    ~Print2MapSink()
+    {
+        if (window)
+            munmap(window, windowSize);
+        if (header)
+            munmap(header, Print2MapHeaderSize);
+        close(fd);
+    }
+
+    bool extend(off_t size);
+    bool map(off_t start, size_t needed);
+
+    const int fd;
+    // windows start on a page, the header's size is part of the format and
+    // doesn't have to be one
+    const size_t pageSize;
+    const size_t chunkSize;
+    Print2MapHeader* header;
+    // what's mapped and where it is in the file
+    char* window;
+    off_t windowStart;
+    size_t windowSize;
+    off_t fileSize;
+    // file offset the next message starts at
+    off_t cursor;
+    bool failed;
+};
+
+// The file grows in whole chunks. The blocks are allocated up front, storing
+// to a page of a sparse file the disk has no room for would be a SIGBUS.
+bool Print2MapSink::extend(off_t size)
+{
+    if (size <= fileSize)
+        return true;
+    const off_t chunks = (size + chunkSize - 1) / chunkSize;
+    const off_t extended = chunks * chunkSize;
+    if (posix_fallocate(fd, fileSize, extended - fileSize))
+        return false;
+    fileSize = extended;
+    return true;
+}
+
+// maps a window with at least needed bytes from start, starting at the page
+// start is on. bytes of the message already formatted before start + needed
+// are in the file, the new window sees them where the old one had them.
+bool Print2MapSink::map(off_t start, size_t needed)
+{
+    const off_t page = pageSize;
+    const off_t begin = start / page * page;
+    const size_t span = (start - begin + needed + page - 1) / page * page;
+    const size_t size = std::max(chunkSize, span);
+    if (!extend(begin + size))
+        return false;
+    // faulting the window in up front is one call per chunk instead of a
+    // page fault every few dozen lines
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;
+#endif
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, begin);
+    if (mapped == MAP_FAILED)
+        return false;
+    if (window)
+        munmap(window, windowSize);
+    window = static_cast<char*>(mapped);
+    windowStart = begin;
+    windowSize = size;
+    return true;
+}
+
+namespace {
+
+// Writes a message at the cursor, running out of window moves the window
+struct Print2MapWriter : public BufferWriter
+{
+    Print2MapWriter(Print2MapSink* s)
+        : BufferWriter(s->window + (s->cursor - s->windowStart), s->windowStart + s->windowSize - s->cursor, &Print2MapWriter::moveWindow),
+          sink(s)
+    {
+    }
+
+    static bool moveWindow(BufferWriter& writer, size_t needed)
+    {
+        Print2MapWriter& map = static_cast<Print2MapWriter&>(writer);
+        Print2MapSink* sink = map.sink;
+        // doubling keeps a message that spans many windows from remapping
+        // on every put
+        if (!sink->map(sink->cursor, std::max(needed, map.buffersize * 2))) {
+            sink->failed = true;
+            return false;
+        }
+        map.buffer = sink->window + (sink->cursor - sink->windowStart);
+        map.buffersize = sink->windowStart + sink->windowSize - sink->cursor;
+        return true;
+    }
+
+    Print2MapSink* sink;
+};
+
+int print2_map_run(BufferWriter& writer, const char* format, const Arguments& args)
+{
+    return print2_helper(writer, format, args);
+}
+
+int print2_map_run(BufferWriter& writer, const Print2Program* program, const Arguments& args)
+{
+    return print2_execute(writer, program, args);
+}
+
+} // anonymous namespace
+
+Print2MapSink* print2_map_open(const char* path, size_t chunkSize)
+{
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1)
+        return nullptr;
+    const size_t page = sysconf(_SC_PAGESIZE);
+    std::unique_ptr<Print2MapSink> sink(new Print2MapSink(fd, page, std::max(page, (chunkSize + page - 1) / page * page)));
+
+    struct stat st;
+    if (fstat(fd, &st))
+        return nullptr;
+    sink->fileSize = st.st_size;
+    Print2MapHeader existing;
+    if (st.st_size) {
+        // carry on after what the last run committed, if it's a log at all
+        if (st.st_size < Print2MapHeaderSize
+            || pread(fd, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing))
+            || !print2_map_valid(existing, st.st_size))
+            return nullptr;
+        sink->cursor = Print2MapHeaderSize + existing.committed;
+    }
+
+    if (!sink->extend(Print2MapHeaderSize))
+        return nullptr;
+    void* header = mmap(nullptr, Print2MapHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED)
+        return nullptr;
+    sink->header = static_cast<Print2MapHeader*>(header);
+    if (!st.st_size) {
+        sink->header->version = Print2MapVersion;
+        sink->header->headerSize = Print2MapHeaderSize;
+        sink->header->committed = 0;
+        memcpy(sink->header->magic, print2_map_magic, sizeof(print2_map_magic));
+    }
+
+    if (!sink->map(sink->cursor, 1))
+        return nullptr;
+    return sink.release();
+}
+
+int print2_map_close(Print2MapSink* sink)
+{
+    // a log that was closed is only as long as what's in it
+    const bool ok = ftruncate(sink->fd, sink->cursor) == 0 && !sink->failed;
+    delete sink;
+    return ok ? 0 : -1;
+}
+
+int print2_map_sync(Print2MapSink* sink)
+{
+    // covers the pages of windows that have been unmapped since, too
+    return fdatasync(sink->fd);
+}
+
+// A message is formatted in place at the cursor, the cursor and the header
+// only move once it's complete. The window always has room for the
+// terminator print2_helper writes, it's overwritten by the next message.
+template<typename Source>
+static int print2_map_format(Print2MapSink* sink, Source source, const Arguments& args)
+{
+    if (sink->failed)
+        return -1;
+    if (sink->cursor >= sink->windowStart + static_cast<off_t>(sink->windowSize) && !sink->map(sink->cursor, 1)) {
+        sink->failed = true;
+        return -1;
+    }
+
+    Print2MapWriter writer(sink);
+    const int n = print2_map_run(writer, source, args);
+    if (sink->failed)
+        return -1;
+    sink->cursor += n;
+    __atomic_store_n(&sink->header->committed, static_cast<uint64_t>(sink->cursor - Print2MapHeaderSize), __ATOMIC_RELEASE);
+    return n;
+}
+
+int print2_map_print(Print2MapSink* sink, const char* format, const Arguments& args)
+{
+    return print2_map_format(sink, format, args);
+}
+
+int print2_map_print(Print2MapSink* sink, const Print2Program* program, const Arguments& args)
+{
+    return print2_map_format(sink, program, args);
+}
+
+bool print2_map_recover(const char* path, std::string& out)
+{
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    Print2MapHeader header;
+    bool ok = !fstat(fd, &st) && st.st_size >= Print2MapHeaderSize
+        && pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+        && print2_map_valid(header, st.st_size);
+    if (ok) {
+        out.resize(header.committed);
+        size_t off = 0;
+        while (off < out.size()) {
+            const ssize_t r = pread(fd, &out[off], out.size() - off, Print2MapHeaderSize + off);
+            if (r <= 0) {
+                if (r < 0 && errno == EINTR)
+                    continue;
+                ok = false;
+                break;
+            }
+            off += r;
+        }
+    }
+    close(fd);
+    return ok;
+}
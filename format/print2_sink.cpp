@@ -0,0 +1,552 @@
+#include "print2.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define PRINT2_URING
+#endif
+#endif
+
+#if defined(PRINT2_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+struct SinkBuffer
+{
+    char* data;
+    // bytes formatted into data and how many of them have been written
+    size_t size;
+    size_t written;
+    // where data goes in the file when the descriptor is seekable
+    off_t offset;
+};
+
+#if defined(PRINT2_URING)
+// io_uring through the raw syscalls, there's no liburing to lean on. One
+// producer, entries is at least the number of writes that can be in flight
+// so the submission queue never fills up.
+struct Print2Ring
+{
+    Print2Ring()
+        : fd(-1), sqMap(MAP_FAILED), cqMap(MAP_FAILED), sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), pending(0)
+    {
+    }
+    ~Print2Ring()
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqMap != MAP_FAILED && cqMap != sqMap)
+            munmap(cqMap, cqSize);
+        if (sqMap != MAP_FAILED)
+            munmap(sqMap, sqSize);
+        if (fd != -1)
+            ::close(fd);
+    }
+
+    Print2Ring(const Print2Ring&) = delete;
+    Print2Ring& operator=(const Print2Ring&) = delete;
+
+    bool setup(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            fd = -1;
+            return false;
+        }
+        // writes at the file position for descriptors that can't seek came
+        // in the same release as IORING_OP_WRITE
+        if (!(params.features & IORING_FEAT_RW_CUR_POS))
+            return false;
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            sqSize = cqSize = std::max(sqSize, cqSize);
+        sqMap = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED)
+            return false;
+        cqMap = single ? sqMap : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED)
+            return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+            return false;
+
+        char* sq = static_cast<char*>(sqMap);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cqMap);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool registerBuffers(const iovec* iov, unsigned count)
+    {
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, count) == 0;
+    }
+
+    // the next sqe, zeroed. it isn't visible to the kernel until queue()
+    io_uring_sqe* prepare()
+    {
+        io_uring_sqe* sqe = &sqes[*sqTail & sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    void queue()
+    {
+        const unsigned tail = *sqTail;
+        sqArray[tail & sqMask] = tail & sqMask;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++pending;
+    }
+
+    // submits everything queued and optionally waits for a completion
+    bool enter(unsigned wait)
+    {
+        do {
+            const int r = static_cast<int>(syscall(__NR_io_uring_enter, fd, pending, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            pending -= r;
+            wait = 0;
+        } while (pending);
+        return true;
+    }
+
+    template<typename Complete>
+    void reap(Complete complete)
+    {
+        unsigned head = *cqHead;
+        const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & cqMask];
+            complete(static_cast<unsigned>(cqe.user_data), cqe.res);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    int fd;
+    void* sqMap;
+    void* cqMap;
+    io_uring_sqe* sqes;
+    size_t sqSize, cqSize, sqesSize;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+    // queued and not yet handed to the kernel
+    unsigned pending;
+};
+#endif
+
+} // anonymous namespace
+
+struct Print2Sink
+{
+    enum { None = ~0u };
+
+    Print2Sink(int f, const Print2SinkOptions& o)
+        : fd(f), options(o), backend(Print2Sink_Thread), seekable(false), offset(0), failed(false),
+          memory(nullptr), current(None), fixed(false), inFlight(0), busy(0), stop(false)
+    {
+    }
+    ~Print2Sink()
+    {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cond.notify_all();
+            writer.join();
+        }
+        free(memory);
+    }
+
+    bool setupRing();
+    void submitReady(bool force);
+    void complete(unsigned index, int res);
+    void submitWrite(unsigned index);
+    void runWriter();
+
+    void poll();
+    bool acquire();
+    void handOff();
+    void write(const char* data, size_t size);
+    bool drain();
+
+    const int fd;
+    const Print2SinkOptions options;
+    Print2SinkBackend backend;
+    // seekable descriptors get explicit offsets so writes can complete in any
+    // order, anything else has one write in flight at a time
+    bool seekable;
+    off_t offset;
+    std::atomic<bool> failed;
+
+    char* memory;
+    std::vector<SinkBuffer> buffers;
+    // free to format into, and handed off but not yet submitted or picked up
+    std::vector<unsigned> freeBuffers;
+    std::deque<unsigned> ready;
+    unsigned current;
+    // a single call's output when it doesn't fit in a buffer
+    std::string overflow;
+
+#if defined(PRINT2_URING)
+    Print2Ring ring;
+#endif
+    bool fixed;
+    unsigned inFlight;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cond;
+    unsigned busy;
+    bool stop;
+};
+
+#if defined(PRINT2_URING)
+bool Print2Sink::setupRing()
+{
+    if (!ring.setup(options.depth))
+        return false;
+    // registered buffers spare the kernel from pinning the pages on every
+    // write, they count against RLIMIT_MEMLOCK so plain writes are the fallback
+    std::vector<iovec> iov(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i)
+        iov[i] = { buffers[i].data, options.bufferSize };
+    fixed = ring.registerBuffers(iov.data(), static_cast<unsigned>(iov.size()));
+    return true;
+}
+
+void Print2Sink::submitWrite(unsigned index)
+{
+    const SinkBuffer& buffer = buffers[index];
+    io_uring_sqe* sqe = ring.prepare();
+    sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(buffer.data + buffer.written);
+    sqe->len = static_cast<unsigned>(buffer.size - buffer.written);
+    sqe->off = seekable ? static_cast<uint64_t>(buffer.offset + buffer.written) : static_cast<uint64_t>(-1);
+    if (fixed)
+        sqe->buf_index = static_cast<uint16_t>(index);
+    sqe->user_data = index;
+    ring.queue();
+    ++inFlight;
+}
+
+void Print2Sink::complete(unsigned index, int res)
+{
+    --inFlight;
+    SinkBuffer& buffer = buffers[index];
+    if (res > 0) {
+        buffer.written += res;
+        if (buffer.written < buffer.size) {
+            submitWrite(index);
+            return;
+        }
+    } else if (res == -EINTR || res == -EAGAIN) {
+        submitWrite(index);
+        return;
+    } else {
+        failed = true;
+    }
+    freeBuffers.push_back(index);
+}
+
+// Handed off buffers go into the submission queue as ordering allows. The
+// kernel gets them once batch are queued or when it has nothing else to do,
+// force submits regardless.
+void Print2Sink::submitReady(bool force)
+{
+    while (!ready.empty() && (seekable || !inFlight)) {
+        submitWrite(ready.front());
+        ready.pop_front();
+    }
+    if (ring.pending && (force || ring.pending >= options.batch || ring.pending == inFlight)) {
+        if (!ring.enter(0))
+            failed = true;
+    }
+}
+#else
+bool Print2Sink::setupRing()
+{
+    return false;
+}
+
+void Print2Sink::submitReady(bool)
+{
+}
+#endif
+
+void Print2Sink::runWriter()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cond.wait(lock, [this]() { return stop || !ready.empty(); });
+        if (ready.empty())
+            return;
+        const unsigned index = ready.front();
+        ready.pop_front();
+        ++busy;
+        lock.unlock();
+
+        const SinkBuffer& buffer = buffers[index];
+        bool ok = true;
+        size_t off = 0;
+        while (off < buffer.size) {
+            const ssize_t w = ::write(fd, buffer.data + off, buffer.size - off);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                ok = false;
+                break;
+            }
+            off += w;
+        }
+
+        lock.lock();
+        if (!ok)
+            failed = true;
+        --busy;
+        freeBuffers.push_back(index);
+        cond.notify_all();
+    }
+}
+
+// picks up completions without waiting. a descriptor that can't seek has
+// buffers queued behind its one write, the next one goes out as soon as
+// that write is done rather than when the current buffer fills up.
+void Print2Sink::poll()
+{
+#if defined(PRINT2_URING)
+    ring.reap([this](unsigned index, int res) { complete(index, res); });
+    submitReady(false);
+#endif
+}
+
+// makes a free buffer current, blocks while all of them are in flight.
+// false if the ring broke and nothing will come back.
+bool Print2Sink::acquire()
+{
+    if (backend == Print2Sink_Uring) {
+#if defined(PRINT2_URING)
+        ring.reap([this](unsigned index, int res) { complete(index, res); });
+        if (freeBuffers.empty())
+            submitReady(true);
+        while (freeBuffers.empty()) {
+            if (!ring.enter(1)) {
+                failed = true;
+                return false;
+            }
+            ring.reap([this](unsigned index, int res) { complete(index, res); });
+            submitReady(false);
+        }
+        current = freeBuffers.back();
+        freeBuffers.pop_back();
+#endif
+    } else {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return !freeBuffers.empty(); });
+        current = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+    buffers[current].size = 0;
+    buffers[current].written = 0;
+    return true;
+}
+
+void Print2Sink::handOff()
+{
+    SinkBuffer& buffer = buffers[current];
+    buffer.offset = offset;
+    offset += buffer.size;
+    if (backend == Print2Sink_Uring) {
+        ready.push_back(current);
+        submitReady(false);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(current);
+        }
+        cond.notify_all();
+    }
+    current = None;
+}
+
+void Print2Sink::write(const char* data, size_t size)
+{
+    while (size) {
+        if (current == None && !acquire())
+            return;
+        SinkBuffer& buffer = buffers[current];
+        const size_t n = std::min(size, options.bufferSize - buffer.size);
+        memcpy(buffer.data + buffer.size, data, n);
+        buffer.size += n;
+        data += n;
+        size -= n;
+        if (buffer.size == options.bufferSize)
+            handOff();
+    }
+}
+
+// waits until everything handed off is written
+bool Print2Sink::drain()
+{
+    if (backend == Print2Sink_Uring) {
+#if defined(PRINT2_URING)
+        submitReady(true);
+        while (inFlight || !ready.empty()) {
+            if (!ring.enter(1))
+                return false;
+            ring.reap([this](unsigned index, int res) { complete(index, res); });
+            submitReady(true);
+        }
+        // the writes went to explicit offsets, leave the file position
+        // where write(2) would have
+        if (seekable)
+            lseek(fd, offset, SEEK_SET);
+#endif
+    } else {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return ready.empty() && !busy; });
+    }
+    return !failed;
+}
+
+Print2Sink* print2_sink_open(int fd, const Print2SinkOptions& options)
+{
+    // the space left in the current buffer always has room for the
+    // terminator print2_helper writes
+    if (options.bufferSize < 2 || !options.depth)
+        return nullptr;
+
+    std::unique_ptr<Print2Sink> sink(new Print2Sink(fd, options));
+    void* memory;
+    if (posix_memalign(&memory, 4096, options.bufferSize * options.depth))
+        return nullptr;
+    sink->memory = static_cast<char*>(memory);
+    sink->buffers.resize(options.depth);
+    for (unsigned i = 0; i < options.depth; ++i) {
+        sink->buffers[i] = { sink->memory + i * options.bufferSize, 0, 0, 0 };
+        sink->freeBuffers.push_back(options.depth - 1 - i);
+    }
+
+    const off_t position = lseek(fd, 0, SEEK_CUR);
+    const int flags = fcntl(fd, F_GETFL);
+    sink->seekable = position >= 0 && flags != -1 && !(flags & O_APPEND);
+    sink->offset = sink->seekable ? position : 0;
+
+    if (options.backend != Print2Sink_Thread) {
+        if (sink->setupRing())
+            sink->backend = Print2Sink_Uring;
+        else if (options.backend == Print2Sink_Uring)
+            return nullptr;
+    }
+    if (sink->backend == Print2Sink_Thread) {
+        Print2Sink* s = sink.get();
+        sink->writer = std::thread([s]() { s->runWriter(); });
+    }
+    return sink.release();
+}
+
+int print2_sink_close(Print2Sink* sink)
+{
+    const int r = print2_sink_flush(sink);
+    delete sink;
+    return r;
+}
+
+Print2SinkBackend print2_sink_backend(const Print2Sink* sink)
+{
+    return sink->backend;
+}
+
+static int print2_sink_run(char* buffer, size_t size, const char* format, const Arguments& args)
+{
+    return print2_helper(buffer, size, format, args);
+}
+
+static int print2_sink_run(char* buffer, size_t size, const Print2Program* program, const Arguments& args)
+{
+    return print2_execute(buffer, size, program, args);
+}
+
+// Formats straight into the current buffer. Output that doesn't fit in
+// what's left of it is formatted again into the next one, or, when it's
+// bigger than a buffer, into overflow and copied across as many as it takes.
+template<typename Source>
+static int print2_sink_format(Print2Sink* sink, Source source, const Arguments& args)
+{
+    if (sink->failed)
+        return -1;
+    if (sink->backend == Print2Sink_Uring && !sink->ready.empty())
+        sink->poll();
+    if (sink->current == Print2Sink::None && !sink->acquire())
+        return -1;
+
+    SinkBuffer* buffer = &sink->buffers[sink->current];
+    const size_t room = sink->options.bufferSize - buffer->size;
+    const int n = print2_sink_run(buffer->data + buffer->size, room, source, args);
+    if (static_cast<size_t>(n) < room) {
+        buffer->size += n;
+    } else if (static_cast<size_t>(n) < sink->options.bufferSize) {
+        sink->handOff();
+        if (!sink->acquire())
+            return -1;
+        buffer = &sink->buffers[sink->current];
+        buffer->size = print2_sink_run(buffer->data, sink->options.bufferSize, source, args);
+    } else {
+        sink->overflow.clear();
+        print2_append(sink->overflow, source, args);
+        sink->write(sink->overflow.data(), sink->overflow.size());
+    }
+    return sink->failed ? -1 : n;
+}
+
+int print2_sink_print(Print2Sink* sink, const char* format, const Arguments& args)
+{
+    return print2_sink_format(sink, format, args);
+}
+
+int print2_sink_print(Print2Sink* sink, const Print2Program* program, const Arguments& args)
+{
+    return print2_sink_format(sink, program, args);
+}
+
+int print2_sink_flush(Print2Sink* sink)
+{
+    if (sink->current != Print2Sink::None && sink->buffers[sink->current].size)
+        sink->handOff();
+    return sink->drain() ? 0 : -1;
+}
@@ -0,0 +1,148 @@
+#ifndef PRINT_DIGITS_H
+#define PRINT_DIGITS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <ryu/digit_table.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Number of decimal digits in v, 1 for 0. The bit width times log10(2)
+// (1233 / 4096) is either the digit count or one too many, a single compare
+// against a power of ten settles it.
+inline int print_decimal_length(uint64_t v)
+{
+    static const uint64_t powers[] = {
+        1ull,
+        10ull,
+        100ull,
+        1000ull,
+        10000ull,
+        100000ull,
+        1000000ull,
+        10000000ull,
+        100000000ull,
+        1000000000ull,
+        10000000000ull,
+        100000000000ull,
+        1000000000000ull,
+        10000000000000ull,
+        100000000000000ull,
+        1000000000000000ull,
+        10000000000000000ull,
+        100000000000000000ull,
+        1000000000000000000ull,
+        10000000000000000000ull
+    };
+    v |= 1;
+    const int t = ((64 - __builtin_clzll(v)) * 1233) >> 12;
+    return t + (v >= powers[t]);
+}
+
+// Writes the digits of v backwards from end, two at a time out of ryu's
+// DIGIT_TABLE. Chunks of eight digits are split off first so the inner loop
+// runs on 32 bit values.
+inline void print_write_decimal_backwards(char* end, uint64_t v)
+{
+    while (v >= 100000000) {
+        uint32_t chunk = static_cast<uint32_t>(v % 100000000);
+        v /= 100000000;
+        for (int i = 0; i < 4; ++i) {
+            end -= 2;
+            memcpy(end, DIGIT_TABLE + (chunk % 100) * 2, 2);
+            chunk /= 100;
+        }
+    }
+    uint32_t rest = static_cast<uint32_t>(v);
+    while (rest >= 100) {
+        end -= 2;
+        memcpy(end, DIGIT_TABLE + (rest % 100) * 2, 2);
+        rest /= 100;
+    }
+    if (rest >= 10) {
+        end -= 2;
+        memcpy(end, DIGIT_TABLE + rest * 2, 2);
+    } else {
+        *--end = static_cast<char>('0' + rest);
+    }
+}
+
+// Writes exactly len digits of v to out, len has to be
+// print_decimal_length(v)
+inline void print_write_decimal(char* out, uint64_t v, int len)
+{
+    print_write_decimal_backwards(out + len, v);
+}
+
+// Number of digits of v in base 2^Shift, 1 for 0. Comes straight from the
+// bit width, unlike digits10 which is the decimal digit count.
+template<int Shift>
+inline int print_radix_length(uint64_t v)
+{
+    return (64 - __builtin_clzll(v | 1) + Shift - 1) / Shift;
+}
+
+// Writes the len hex digits of v to out. alphabet is "0123456789abcdef" or
+// the upper case version. With SSE2 all sixteen nibbles are expanded at once
+// and the wanted tail is copied out.
+inline void print_write_hex(char* out, uint64_t v, int len, const char* alphabet)
+{
+#if defined(__SSE2__)
+    // bytes in memory order with the most significant first, split into
+    // high and low nibbles and interleaved back into digit order
+    const __m128i bytes = _mm_cvtsi64_si128(static_cast<long long>(__builtin_bswap64(v)));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    const __m128i lo = _mm_and_si128(bytes, mask);
+    const __m128i nibbles = _mm_unpacklo_epi8(hi, lo);
+
+    // '0' + n for 0-9, then skip ahead to the alphabet's letters for 10-15
+    const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)),
+                                          _mm_set1_epi8(static_cast<char>(alphabet[10] - '0' - 10)));
+    const __m128i digits = _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+
+    char tmp[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(tmp), digits);
+    memcpy(out, tmp + 16 - len, len);
+#else
+    char* end = out + len;
+    for (int i = 0; i < len; ++i) {
+        *--end = alphabet[v & 0xf];
+        v >>= 4;
+    }
+#endif
+}
+
+inline void print_write_octal(char* out, uint64_t v, int len)
+{
+    char* end = out + len;
+    for (int i = 0; i < len; ++i) {
+        *--end = static_cast<char>('0' + (v & 0x7));
+        v >>= 3;
+    }
+}
+
+// binary digits go out a nibble at a time
+inline void print_write_binary(char* out, uint64_t v, int len)
+{
+    static const char nibbles[16][4] = {
+        { '0', '0', '0', '0' }, { '0', '0', '0', '1' }, { '0', '0', '1', '0' }, { '0', '0', '1', '1' },
+        { '0', '1', '0', '0' }, { '0', '1', '0', '1' }, { '0', '1', '1', '0' }, { '0', '1', '1', '1' },
+        { '1', '0', '0', '0' }, { '1', '0', '0', '1' }, { '1', '0', '1', '0' }, { '1', '0', '1', '1' },
+        { '1', '1', '0', '0' }, { '1', '1', '0', '1' }, { '1', '1', '1', '0' }, { '1', '1', '1', '1' }
+    };
+    char* end = out + len;
+    while (end - out >= 4) {
+        end -= 4;
+        memcpy(end, nibbles[v & 0xf], 4);
+        v >>= 4;
+    }
+    while (end > out) {
+        *--end = static_cast<char>('0' + (v & 0x1));
+        v >>= 1;
+    }
+}
+
+#endif // PRINT_DIGITS_H
@@ -0,0 +1,795 @@
+#ifndef PRINT_FLOAT_H
+#define PRINT_FLOAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include "print_digits.h"
+#include <ryu/ryu.h>
+#include <ryu/ryu2.h>
+#if defined(__SIZEOF_INT128__)
+#include <float.h>
+#include <ryu/ryu_generic_128.h>
+#define PRINT_WIDE_FLOAT
+#endif
+
+// ryu's %e conversion by argument type
+inline int print_exp_n(double number, uint32_t precision, char* out)
+{
+    return d2exp_buffered_n(number, precision, out);
+}
+
+// The binary32 %e kernel only beats d2exp while it gets its digits from one
+// exact 128 bit quotient, up to 8 digits after the point for values the 5^k
+// table reaches with any of those precisions. Its bigint fallback is slower,
+// so everything else is widened to double, which prints the same digits.
+inline bool print_float_exp_scaled(float number, uint32_t precision)
+{
+    const float magnitude = std::fabs(number);
+    return precision <= 8 && (magnitude == 0 || (magnitude >= 1e-18f && magnitude < 1e26f));
+}
+
+inline int print_exp_n(float number, uint32_t precision, char* out)
+{
+    if (print_float_exp_scaled(number, precision))
+        return f2exp_buffered_n(number, precision, out);
+    return d2exp_buffered_n(static_cast<double>(number), precision, out);
+}
+
+// %f for floats goes through d2fixed as well, f2fixed's bigint is slower
+inline int print_fixed_n(double number, uint32_t precision, char* out)
+{
+    return d2fixed_buffered_n(number, precision, out);
+}
+
+// std::signbit has no __float128 overload
+template<typename T>
+inline bool print_signbit(T number)
+{
+    return std::signbit(number);
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+// long double and __float128 go through ryu's generic 128 bit conversions,
+// which take the raw bits and a description of the format
+struct PrintWideFloat
+{
+    unsigned __int128 bits;
+    uint32_t mantissabits;
+    uint32_t exponentbits;
+    bool explicitleading;
+};
+
+inline PrintWideFloat print_wide_float(long double number)
+{
+    static_assert(LDBL_MANT_DIG == 53 || LDBL_MANT_DIG == 64 || LDBL_MANT_DIG == 113, "Unsupported long double format");
+    PrintWideFloat wide = { 0, 0, 0, false };
+    if (LDBL_MANT_DIG == 64) {
+        // x87 extended precision, the 80 bits are followed by padding
+        memcpy(&wide.bits, &number, 10);
+        wide.mantissabits = 64;
+        wide.exponentbits = 15;
+        wide.explicitleading = true;
+    } else if (LDBL_MANT_DIG == 113) {
+        memcpy(&wide.bits, &number, 16);
+        wide.mantissabits = 112;
+        wide.exponentbits = 15;
+    } else {
+        memcpy(&wide.bits, &number, 8);
+        wide.mantissabits = 52;
+        wide.exponentbits = 11;
+    }
+    return wide;
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+inline PrintWideFloat print_wide_float(__float128 number)
+{
+    PrintWideFloat wide = { 0, 112, 15, false };
+    memcpy(&wide.bits, &number, 16);
+    return wide;
+}
+
+template<>
+inline bool print_signbit<__float128>(__float128 number)
+{
+    return (print_wide_float(number).bits >> 127) != 0;
+}
+#endif
+
+// Upper bound of the %f output length, sign, integer digits and point
+// included, from the binary exponent
+inline size_t print_wide_fixed_bound(const PrintWideFloat& wide, uint32_t precision)
+{
+    const int bias = (1 << (wide.exponentbits - 1)) - 1;
+    const int exponent = static_cast<int>((wide.bits >> wide.mantissabits) & ((1u << wide.exponentbits) - 1));
+    // the value is below 2^(exponent - bias + 1), inf and nan fit as well
+    const int bits = exponent - bias + 1;
+    const size_t intdigits = bits > 0 ? static_cast<size_t>(bits) * 30103 / 100000 + 1 : 1;
+    return 2 + intdigits + precision;
+}
+
+// The %e output, sign, digit, point and e-4951 around the precision digits
+enum { PrintWideExpExtra = 9 };
+
+// ryu only fails when it can't get scratch memory for an extreme exponent,
+// that aborts like every other formatting error in print and print2
+inline int print_wide_result(int n)
+{
+    if (n < 0) {
+        static const char message[] = "Out of memory converting a wide float\n";
+        fwrite(message, 1, sizeof(message) - 1, stderr);
+        fflush(stderr);
+        abort();
+    }
+    return n;
+}
+
+template<typename T>
+inline int print_wide_exp_n(T number, uint32_t precision, char* out)
+{
+    const PrintWideFloat wide = print_wide_float(number);
+    return print_wide_result(generic_binary_to_exp(wide.bits, wide.mantissabits, wide.exponentbits,
+                                                   wide.explicitleading, precision, out));
+}
+
+template<typename T>
+inline int print_wide_fixed_n(T number, uint32_t precision, char* out)
+{
+    const PrintWideFloat wide = print_wide_float(number);
+    return print_wide_result(generic_binary_to_fixed(wide.bits, wide.mantissabits, wide.exponentbits,
+                                                     wide.explicitleading, precision, out));
+}
+
+inline int print_exp_n(long double number, uint32_t precision, char* out)
+{
+    return print_wide_exp_n(number, precision, out);
+}
+
+inline int print_fixed_n(long double number, uint32_t precision, char* out)
+{
+    return print_wide_fixed_n(number, precision, out);
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+inline int print_exp_n(__float128 number, uint32_t precision, char* out)
+{
+    return print_wide_exp_n(number, precision, out);
+}
+
+inline int print_fixed_n(__float128 number, uint32_t precision, char* out)
+{
+    return print_wide_fixed_n(number, precision, out);
+}
+#endif
+#endif // PRINT_WIDE_FLOAT
+
+// The upper case conversions print the same characters with the letters
+// upper cased, the exponent's e and the words for infinity and nan
+inline void print_upper(char* out, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        if (out[i] >= 'a' && out[i] <= 'z')
+            out[i] -= 'a' - 'A';
+    }
+}
+
+template<typename T>
+inline int print_exp_upper_n(T number, uint32_t precision, char* out)
+{
+    const int n = print_exp_n(number, precision, out);
+    print_upper(out, n);
+    return n;
+}
+
+// Room print_format_general needs in front of the d2exp output to turn it
+// into the fixed form, "0.000" for the smallest exponent %g keeps fixed.
+// PrintGeneralBuffer is the stack space callers start with, it covers
+// precisions up to about 50.
+enum {
+    PrintGeneralPrefix = 8,
+    PrintGeneralBuffer = 64
+};
+
+// Upper bound of the significant digits in the exact decimal expansion of
+// m * 2^e2, m odd and bits long. Below 1 those are the digits of m * 5^-e2,
+// which end in a 5, so everything past them is zeros.
+inline int print_exact_digits(int bits, int e2)
+{
+    if (e2 >= 0)
+        return (bits + e2) * 30103 / 100000 + 1;
+    return (bits * 30103 + -e2 * 69898) / 100000 + 1;
+}
+
+inline int print_exact_digits(double number)
+{
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    const int exponent = static_cast<int>((bits >> 52) & 0x7ff);
+    uint64_t m = bits & ((1ull << 52) - 1);
+    if (exponent)
+        m |= 1ull << 52;
+    if (exponent == 0x7ff || !m)
+        return 1;
+    const int zeros = __builtin_ctzll(m);
+    return print_exact_digits(64 - __builtin_clzll(m) - zeros, (exponent ? exponent : 1) - 1075 + zeros);
+}
+
+inline int print_exact_digits(float number)
+{
+    return print_exact_digits(static_cast<double>(number));
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+template<typename T>
+inline int print_wide_exact_digits(T number)
+{
+    const PrintWideFloat wide = print_wide_float(number);
+    const unsigned __int128 one = 1;
+    const uint32_t maxexponent = (1u << wide.exponentbits) - 1;
+    const uint32_t exponent = static_cast<uint32_t>(wide.bits >> wide.mantissabits) & maxexponent;
+    unsigned __int128 m = wide.bits & ((one << wide.mantissabits) - 1);
+    if (exponent && !wide.explicitleading)
+        m |= one << wide.mantissabits;
+    if (exponent == maxexponent || !m)
+        return 1;
+
+    // x87's explicit leading bit is one of the mantissa bits
+    const int fraction = wide.explicitleading ? wide.mantissabits - 1 : wide.mantissabits;
+    const int bias = (1 << (wide.exponentbits - 1)) - 1;
+    const uint64_t low = static_cast<uint64_t>(m);
+    const uint64_t high = static_cast<uint64_t>(m >> 64);
+    const int zeros = low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(high);
+    const int top = high ? 128 - __builtin_clzll(high) : 64 - __builtin_clzll(low);
+    return print_exact_digits(top - zeros, (exponent ? static_cast<int>(exponent) : 1) - bias - fraction + zeros);
+}
+
+inline int print_exact_digits(long double number)
+{
+    return print_wide_exact_digits(number);
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+inline int print_exact_digits(__float128 number)
+{
+    return print_wide_exact_digits(number);
+}
+#endif
+#endif
+
+// The significant digits %g converts for precision. Without # the trailing
+// zeros are dropped, so the conversion stops at the last digit of the exact
+// value instead of generating the zeros only to strip them.
+template<typename T>
+inline int print_general_digits(T number, int precision, bool alternate)
+{
+    if (precision == 0)
+        precision = 1;
+    if (alternate)
+        return precision;
+    const int exact = print_exact_digits(number);
+    return exact < precision ? exact : precision;
+}
+
+// The buffer print_format_general needs for digits
+inline size_t print_general_size(int digits)
+{
+    return static_cast<size_t>(digits) + PrintGeneralPrefix + 8;
+}
+
+// Formats a non-negative number the way %g does and returns where the result
+// starts within buffer, the length goes into len. digits comes from
+// print_general_digits and buffer holds print_general_size(digits) bytes.
+//
+// There's a single d2exp conversion with digits - 1 digits after the point.
+// Its exponent X is the one C uses to pick the style, and when the fixed
+// style wins (precision > X >= -4) the fixed digits are exactly the same
+// significant digits, so the point is moved in place instead of running
+// d2fixed as well. Works for float and double.
+template<typename T>
+inline const char* print_format_general(T number, int precision, int digits, bool alternate, bool upper, char* buffer, int& len)
+{
+    if (precision == 0)
+        precision = 1;
+
+    char* out = buffer + PrintGeneralPrefix;
+    const int n = print_exp_n(number, digits - 1, out);
+
+    // infinity and nan have no exponent
+    int e = n - 1;
+    while (e > 0 && out[e] != 'e')
+        --e;
+    if (!e) {
+        if (upper)
+            print_upper(out, n);
+        len = n;
+        return out;
+    }
+
+    int exponent = 0;
+    for (int i = e + 2; i < n; ++i)
+        exponent = exponent * 10 + (out[i] - '0');
+    if (out[e + 1] == '-')
+        exponent = -exponent;
+
+    // significant digits are out[0] and out[2, e), the point sits at out[1]
+    char* end;
+    if (exponent < -4 || exponent >= precision) {
+        char sign[8];
+        const int explen = n - e - 1;
+        memcpy(sign, out + e + 1, explen);
+
+        end = out + e;
+        if (digits == 1) {
+            if (alternate)
+                *end++ = '.';
+        } else if (!alternate) {
+            while (end[-1] == '0')
+                --end;
+            if (end[-1] == '.')
+                --end;
+        }
+        *end++ = upper ? 'E' : 'e';
+        memcpy(end, sign, explen);
+        len = static_cast<int>(end - out) + explen;
+        return out;
+    }
+
+    const char* fraction;
+    if (exponent >= 0) {
+        // shift the first exponent digits over the point
+        if (digits > 1) {
+            memmove(out + 1, out + 2, exponent);
+            out[exponent + 1] = '.';
+        }
+        fraction = out + exponent + 2;
+        end = out + (digits > 1 ? e : 1);
+    } else {
+        // drop the point after the first digit and put 0.000 in front
+        out[1] = out[0];
+        ++out;
+        end = out + (digits > 1 ? e - 1 : 1);
+        const int zeros = -exponent - 1;
+        out -= zeros;
+        memset(out, '0', zeros);
+        *--out = '.';
+        *--out = '0';
+        fraction = out + 2;
+    }
+
+    if (!alternate) {
+        while (end > fraction && end[-1] == '0')
+            --end;
+        if (end == fraction)
+            --end;
+    } else if (end < fraction) {
+        // # keeps the point even when there are no digits after it
+        *end++ = '.';
+    }
+    len = static_cast<int>(end - out);
+    return out;
+}
+
+// Shortest output stays in fixed notation for decimal exponents in
+// [PrintShortestMinExponent, PrintShortestMaxExponent), the %g rule for 17
+// significant digits
+enum {
+    PrintShortestMinExponent = -4,
+    PrintShortestMaxExponent = 17,
+    PrintShortestBuffer = 64
+};
+
+// Rewrites ryu's d2s/f2s output ("d.dddE-x") into the printf style the other
+// conversions use. Fixed notation where %g with 17 digits would pick it,
+// otherwise d.ddde-xx with at least two exponent digits. # adds ".0" to
+// integral fixed output so it reads back as a floating point number.
+inline int print_format_shortest_rewrite(const char* in, int n, bool alternate, char* out)
+{
+    int e = n - 1;
+    while (e > 0 && in[e] != 'E')
+        --e;
+    if (!e) {
+        memcpy(out, in, n);
+        return n;
+    }
+
+    // significant digits without the point, up to 36 for binary128
+    char digits[40];
+    int ndigits = 0;
+    for (int i = 0; i < e; ++i) {
+        if (in[i] != '.')
+            digits[ndigits++] = in[i];
+    }
+
+    int exponent = 0;
+    const bool negative = in[e + 1] == '-';
+    for (int i = e + 1 + negative; i < n; ++i)
+        exponent = exponent * 10 + (in[i] - '0');
+    if (negative)
+        exponent = -exponent;
+
+    char* o = out;
+    if (exponent < PrintShortestMinExponent || exponent >= PrintShortestMaxExponent) {
+        *o++ = digits[0];
+        if (ndigits > 1) {
+            *o++ = '.';
+            memcpy(o, digits + 1, ndigits - 1);
+            o += ndigits - 1;
+        }
+        *o++ = 'e';
+        *o++ = negative ? '-' : '+';
+        int absexp = negative ? -exponent : exponent;
+        if (absexp >= 1000) {
+            // long double and binary128 reach e-4966
+            *o++ = static_cast<char>('0' + absexp / 1000);
+            absexp %= 1000;
+            *o++ = static_cast<char>('0' + absexp / 100);
+            absexp %= 100;
+        } else if (absexp >= 100) {
+            *o++ = static_cast<char>('0' + absexp / 100);
+            absexp %= 100;
+        }
+        *o++ = static_cast<char>('0' + absexp / 10);
+        *o++ = static_cast<char>('0' + absexp % 10);
+    } else if (exponent < 0) {
+        *o++ = '0';
+        *o++ = '.';
+        memset(o, '0', -exponent - 1);
+        o += -exponent - 1;
+        memcpy(o, digits, ndigits);
+        o += ndigits;
+    } else if (ndigits > exponent + 1) {
+        memcpy(o, digits, exponent + 1);
+        o += exponent + 1;
+        *o++ = '.';
+        memcpy(o, digits + exponent + 1, ndigits - exponent - 1);
+        o += ndigits - exponent - 1;
+    } else {
+        memcpy(o, digits, ndigits);
+        o += ndigits;
+        memset(o, '0', exponent + 1 - ndigits);
+        o += exponent + 1 - ndigits;
+        if (alternate) {
+            *o++ = '.';
+            *o++ = '0';
+        }
+    }
+    return static_cast<int>(o - out);
+}
+
+// The shortest output that reads back to the same value, out needs
+// PrintShortestBuffer bytes
+inline int print_format_shortest(double number, bool alternate, char* out)
+{
+    char buffer[PrintShortestBuffer];
+    return print_format_shortest_rewrite(buffer, d2s_buffered_n(number, buffer), alternate, out);
+}
+
+inline int print_format_shortest(float number, bool alternate, char* out)
+{
+    char buffer[PrintShortestBuffer];
+    return print_format_shortest_rewrite(buffer, f2s_buffered_n(number, buffer), alternate, out);
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+template<typename T>
+inline int print_format_shortest_wide(T number, bool alternate, char* out)
+{
+    const PrintWideFloat wide = print_wide_float(number);
+    const floating_decimal_128 decimal = generic_binary_to_decimal(wide.bits, wide.mantissabits, wide.exponentbits,
+                                                                   wide.explicitleading);
+    char buffer[PrintShortestBuffer];
+    return print_format_shortest_rewrite(buffer, generic_to_chars(decimal, buffer), alternate, out);
+}
+
+inline int print_format_shortest(long double number, bool alternate, char* out)
+{
+    return print_format_shortest_wide(number, alternate, out);
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+inline int print_format_shortest(__float128 number, bool alternate, char* out)
+{
+    return print_format_shortest_wide(number, alternate, out);
+}
+#endif
+#endif
+
+// %a works on the bits. The value is lead.fraction * 2^exponent with the
+// fraction's hex digits left aligned in Word, so rounding to a precision is
+// a mask and an add. Doubles print the way glibc does, a lead of 1 (0 for
+// subnormals), and x87 long doubles put the top four bits of their explicit
+// mantissa in front of the point.
+template<typename Word>
+struct PrintHexFloat
+{
+    Word fraction;
+    int digits; // fraction digits, print_hex_round turns it into the number printed
+    uint32_t lead;
+    int exponent;
+    const char* special; // infinity and nan, nullptr otherwise
+};
+
+inline PrintHexFloat<uint64_t> print_hex_float(double number)
+{
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    const uint64_t mantissa = bits & ((1ull << 52) - 1);
+    const int exponent = static_cast<int>((bits >> 52) & 0x7ff);
+
+    PrintHexFloat<uint64_t> hex = { mantissa << 12, 13, exponent != 0, 0, nullptr };
+    if (exponent == 0x7ff)
+        hex.special = mantissa ? "nan" : "Infinity";
+    else if (exponent)
+        hex.exponent = exponent - 1023;
+    else if (mantissa)
+        hex.exponent = -1022;
+    return hex;
+}
+
+// floats are promoted to double for %a in C as well
+inline PrintHexFloat<uint64_t> print_hex_float(float number)
+{
+    return print_hex_float(static_cast<double>(number));
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+inline PrintHexFloat<unsigned __int128> print_hex_float_binary128(unsigned __int128 bits)
+{
+    const unsigned __int128 mantissa = bits & ((static_cast<unsigned __int128>(1) << 112) - 1);
+    const int exponent = static_cast<int>((bits >> 112) & 0x7fff);
+
+    PrintHexFloat<unsigned __int128> hex = { mantissa << 16, 28, exponent != 0, 0, nullptr };
+    if (exponent == 0x7fff)
+        hex.special = mantissa ? "nan" : "Infinity";
+    else if (exponent)
+        hex.exponent = exponent - 16383;
+    else if (mantissa)
+        hex.exponent = -16382;
+    return hex;
+}
+
+#if LDBL_MANT_DIG == 64
+inline PrintHexFloat<uint64_t> print_hex_float(long double number)
+{
+    const unsigned __int128 bits = print_wide_float(number).bits;
+    const uint64_t mantissa = static_cast<uint64_t>(bits);
+    const int exponent = static_cast<int>((bits >> 64) & 0x7fff);
+
+    // the exponent is the one of the first hex digit
+    PrintHexFloat<uint64_t> hex = { mantissa << 4, 15, static_cast<uint32_t>(mantissa >> 60), 0, nullptr };
+    if (exponent == 0x7fff)
+        hex.special = (mantissa << 1) ? "nan" : "Infinity";
+    else if (mantissa)
+        hex.exponent = (exponent ? exponent : 1) - 16383 - 3;
+    return hex;
+}
+#elif LDBL_MANT_DIG == 113
+inline PrintHexFloat<unsigned __int128> print_hex_float(long double number)
+{
+    return print_hex_float_binary128(print_wide_float(number).bits);
+}
+#else
+inline PrintHexFloat<uint64_t> print_hex_float(long double number)
+{
+    return print_hex_float(static_cast<double>(number));
+}
+#endif
+
+#if defined(__SIZEOF_FLOAT128__)
+inline PrintHexFloat<unsigned __int128> print_hex_float(__float128 number)
+{
+    return print_hex_float_binary128(print_wide_float(number).bits);
+}
+#endif
+#endif // PRINT_WIDE_FLOAT
+
+// Applies the precision, a negative one keeps every digit up to the last
+// non-zero one. Dropped digits round to nearest with ties to even, like
+// glibc in the default rounding mode. A carry out of an x87 lead of f
+// renormalizes to 1 with the exponent moved by four.
+template<typename Word>
+inline void print_hex_round(PrintHexFloat<Word>& hex, int precision)
+{
+    enum { Bits = sizeof(Word) * 8 };
+    if (precision < 0) {
+        while (hex.digits && !((hex.fraction >> (Bits - 4 * hex.digits)) & 0xf))
+            --hex.digits;
+        return;
+    }
+    if (precision >= hex.digits) {
+        hex.digits = precision;
+        return;
+    }
+
+    bool carry;
+    if (!precision) {
+        const Word half = static_cast<Word>(1) << (Bits - 1);
+        carry = hex.fraction > half || (hex.fraction == half && (hex.lead & 1));
+        hex.fraction = 0;
+    } else {
+        const int shift = Bits - 4 * precision;
+        const Word unit = static_cast<Word>(1) << shift;
+        const Word rest = hex.fraction & (unit - 1);
+        const Word half = unit >> 1;
+        hex.fraction -= rest;
+        carry = false;
+        if (rest > half || (rest == half && (hex.fraction & unit))) {
+            hex.fraction += unit;
+            carry = !hex.fraction;
+        }
+    }
+    hex.digits = precision;
+    if (carry && ++hex.lead == 16) {
+        hex.lead = 1;
+        hex.exponent += 4;
+    }
+}
+
+// Length of what print_write_hex_float writes, the 0x prefix goes with the
+// sign so zero padding lands between the two
+template<typename Word>
+inline int print_hex_float_length(const PrintHexFloat<Word>& hex, bool alternate)
+{
+    const uint32_t exponent = hex.exponent < 0 ? -hex.exponent : hex.exponent;
+    return 1 + (hex.digits || alternate) + hex.digits + 2 + print_decimal_length(exponent);
+}
+
+inline char* print_write_hex_fraction(char* out, uint64_t fraction, int digits, const char* alphabet)
+{
+    const int n = digits < 16 ? digits : 16;
+    if (n)
+        print_write_hex(out, fraction >> (64 - 4 * n), n, alphabet);
+    memset(out + n, '0', digits - n);
+    return out + digits;
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+inline char* print_write_hex_fraction(char* out, unsigned __int128 fraction, int digits, const char* alphabet)
+{
+    if (digits <= 16)
+        return print_write_hex_fraction(out, static_cast<uint64_t>(fraction >> 64), digits, alphabet);
+    print_write_hex(out, static_cast<uint64_t>(fraction >> 64), 16, alphabet);
+    return print_write_hex_fraction(out + 16, static_cast<uint64_t>(fraction), digits - 16, alphabet);
+}
+#endif
+
+template<typename Word>
+inline void print_write_hex_float(char* out, const PrintHexFloat<Word>& hex, bool alternate, bool upper)
+{
+    const char* alphabet = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    *out++ = alphabet[hex.lead];
+    if (hex.digits || alternate)
+        *out++ = '.';
+    out = print_write_hex_fraction(out, hex.fraction, hex.digits, alphabet);
+    *out++ = upper ? 'P' : 'p';
+    *out++ = hex.exponent < 0 ? '-' : '+';
+    const uint32_t exponent = hex.exponent < 0 ? -hex.exponent : hex.exponent;
+    print_write_decimal(out, exponent, print_decimal_length(exponent));
+}
+
+// 10^n for n <= 19
+inline uint64_t print_fixed_power(uint32_t n)
+{
+    static const uint64_t powers[] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+        100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+        10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+        100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+    };
+    return powers[n];
+}
+
+// %.Nf fast path. With d = m * 2^e, d * 10^N is m * 10^N shifted right by
+// -e, which for N <= 19 is an exact 128 bit product. The bits shifted out
+// decide the rounding exactly (ties to even, like d2fixed), so there is no
+// approximation to guard against. Returns false for anything it doesn't
+// cover: inf/nan, N > 19 and results of 2^64 or more, ryu takes those.
+inline bool print_fixed_scaled(double number, uint32_t precision, uint64_t& scaled)
+{
+#if defined(__SIZEOF_INT128__)
+    if (precision > 19)
+        return false;
+
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    const uint64_t mantissa = bits & ((1ull << 52) - 1);
+    const int exponent = static_cast<int>((bits >> 52) & 0x7ff);
+    if (exponent == 0x7ff)
+        return false;
+
+    const uint64_t m = exponent ? mantissa | (1ull << 52) : mantissa;
+    const int shift = 1075 - (exponent ? exponent : 1);
+    if (shift <= 0) {
+        // an integer, there is no fraction to round
+        if (shift < -11 || m > (~0ull >> -shift))
+            return false;
+        const unsigned __int128 product = static_cast<unsigned __int128>(m << -shift) * print_fixed_power(precision);
+        if (product >> 64)
+            return false;
+        scaled = static_cast<uint64_t>(product);
+        return true;
+    }
+
+    const unsigned __int128 product = static_cast<unsigned __int128>(m) * print_fixed_power(precision);
+    if (shift >= 118) {
+        // the product is below 2^117, less than half of the unit
+        scaled = 0;
+        return true;
+    }
+    const unsigned __int128 quotient = product >> shift;
+    if (quotient >> 64)
+        return false;
+    const unsigned __int128 rest = product & ((static_cast<unsigned __int128>(1) << shift) - 1);
+    const unsigned __int128 half = static_cast<unsigned __int128>(1) << (shift - 1);
+    scaled = static_cast<uint64_t>(quotient);
+    if (rest > half || (rest == half && (scaled & 1))) {
+        if (!++scaled)
+            return false;
+    }
+    return true;
+#else
+    (void)number;
+    (void)precision;
+    (void)scaled;
+    return false;
+#endif
+}
+
+// Floats take the double path, the 64 bit arithmetic a float overload can
+// get away with measured no faster than the widened double
+inline bool print_fixed_scaled(float number, uint32_t precision, uint64_t& scaled)
+{
+    return print_fixed_scaled(static_cast<double>(number), precision, scaled);
+}
+
+#if defined(PRINT_WIDE_FLOAT)
+// Wider types take the fast path when they hold a double exactly, which
+// covers the many long doubles that came from double arithmetic
+inline bool print_fixed_scaled(long double number, uint32_t precision, uint64_t& scaled)
+{
+    const double narrow = static_cast<double>(number);
+    return narrow == number && print_fixed_scaled(narrow, precision, scaled);
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+inline bool print_fixed_scaled(__float128 number, uint32_t precision, uint64_t& scaled)
+{
+    const double narrow = static_cast<double>(number);
+    return narrow == number && print_fixed_scaled(narrow, precision, scaled);
+}
+#endif
+#endif
+
+// Length of the %.Nf output for print_fixed_scaled's value, the integer
+// digits go into intdigits
+inline int print_fixed_length(uint64_t scaled, uint32_t precision, int& intdigits)
+{
+    intdigits = print_decimal_length(scaled / print_fixed_power(precision));
+    return intdigits + (precision ? 1 + static_cast<int>(precision) : 0);
+}
+
+inline void print_write_fixed(char* out, uint64_t scaled, uint32_t precision, int intdigits)
+{
+    const uint64_t power = print_fixed_power(precision);
+    uint64_t fraction = scaled % power;
+    print_write_decimal(out, scaled / power, intdigits);
+    if (!precision)
+        return;
+
+    // the fraction keeps its leading zeros, DIGIT_TABLE pairs include them
+    out[intdigits] = '.';
+    char* end = out + intdigits + 1 + precision;
+    uint32_t left = precision;
+    for (; left >= 2; left -= 2) {
+        end -= 2;
+        memcpy(end, DIGIT_TABLE + (fraction % 100) * 2, 2);
+        fraction /= 100;
+    }
+    if (left)
+        *--end = static_cast<char>('0' + fraction);
+}
+
+#endif // PRINT_FLOAT_H
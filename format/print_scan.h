@@ -0,0 +1,153 @@
+#ifndef PRINT_SCAN_H
+#define PRINT_SCAN_H
+
+#include <atomic>
+#include <stdint.h>
+#include <ryu/simd.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PRINT_SCAN_X86
+#endif
+
+// The blocks the vector kernels load start before str and run past the
+// terminator. That's safe on the hardware but not to AddressSanitizer, which
+// sees the bytes outside the allocation, so the kernels aren't instrumented.
+#if defined(__GNUC__) || defined(__clang__)
+#define PRINT_SCAN_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define PRINT_SCAN_NO_ASAN
+#endif
+
+// print_scan_literal returns a pointer to the first '%' or '\0' at or after
+// str, with the kernel for ryu_simd_level().
+//
+// The vector versions only do aligned loads. An aligned load never crosses a
+// page boundary, so reading the bytes around the terminator can't fault. Bytes
+// in front of str that share the first block are masked off.
+typedef const char* (*PrintScanLiteral)(const char* str);
+
+inline const char* print_scan_literal_generic(const char* str)
+{
+    while (*str != '%' && *str != '\0')
+        ++str;
+    return str;
+}
+
+#if defined(PRINT_SCAN_X86)
+__attribute__((target("sse2"))) PRINT_SCAN_NO_ASAN inline const char* print_scan_literal_sse2(const char* str)
+{
+    enum { Block = 16 };
+    const uintptr_t misalign = reinterpret_cast<uintptr_t>(str) & (Block - 1);
+    const char* block = str - misalign;
+    const __m128i percent = _mm_set1_epi8('%');
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, percent),
+                                                                         _mm_cmpeq_epi8(chunk, zero))));
+    mask >>= misalign;
+    if (mask)
+        return str + __builtin_ctz(mask);
+    for (;;) {
+        block += Block;
+        chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+        mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, percent),
+                                                                    _mm_cmpeq_epi8(chunk, zero))));
+        if (mask)
+            return block + __builtin_ctz(mask);
+    }
+}
+
+__attribute__((target("avx2"))) PRINT_SCAN_NO_ASAN inline const char* print_scan_literal_avx2(const char* str)
+{
+    enum { Block = 32 };
+    const uintptr_t misalign = reinterpret_cast<uintptr_t>(str) & (Block - 1);
+    const char* block = str - misalign;
+    const __m256i percent = _mm256_set1_epi8('%');
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, percent),
+                                                                               _mm256_cmpeq_epi8(chunk, zero))));
+    mask >>= misalign;
+    if (mask)
+        return str + __builtin_ctz(mask);
+    for (;;) {
+        block += Block;
+        chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+        mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, percent),
+                                                                          _mm256_cmpeq_epi8(chunk, zero))));
+        if (mask)
+            return block + __builtin_ctz(mask);
+    }
+}
+
+// AVX-512BW compares straight into 64 bit masks, no movemask needed
+__attribute__((target("avx512f,avx512bw"))) PRINT_SCAN_NO_ASAN inline const char* print_scan_literal_avx512(const char* str)
+{
+    enum { Block = 64 };
+    const uintptr_t misalign = reinterpret_cast<uintptr_t>(str) & (Block - 1);
+    const char* block = str - misalign;
+    const __m512i percent = _mm512_set1_epi8('%');
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i chunk = _mm512_load_si512(block);
+    uint64_t mask = _mm512_cmpeq_epi8_mask(chunk, percent) | _mm512_cmpeq_epi8_mask(chunk, zero);
+    mask >>= misalign;
+    if (mask)
+        return str + __builtin_ctzll(mask);
+    for (;;) {
+        block += Block;
+        chunk = _mm512_load_si512(block);
+        mask = _mm512_cmpeq_epi8_mask(chunk, percent) | _mm512_cmpeq_epi8_mask(chunk, zero);
+        if (mask)
+            return block + __builtin_ctzll(mask);
+    }
+}
+#endif
+
+// The kernel for level, or the best one below it that's compiled in
+inline PrintScanLiteral print_scan_literal_kernel(ryu_simd level)
+{
+#if defined(PRINT_SCAN_X86)
+    switch (level) {
+    case RYU_SIMD_AVX512:
+        return print_scan_literal_avx512;
+    case RYU_SIMD_AVX2:
+        return print_scan_literal_avx2;
+    case RYU_SIMD_SSE2:
+        return print_scan_literal_sse2;
+    case RYU_SIMD_GENERIC:
+        break;
+    }
+#else
+    (void)level;
+#endif
+    return print_scan_literal_generic;
+}
+
+// A template only so the pointer can live in this header. It starts out at
+// resolve, which swaps in the kernel on the first call.
+template<typename Unused = void>
+struct PrintScanDispatch
+{
+    static const char* resolve(const char* str)
+    {
+        const PrintScanLiteral kernel = print_scan_literal_kernel(ryu_simd_level());
+        literal.store(kernel, std::memory_order_relaxed);
+        return kernel(str);
+    }
+
+    static std::atomic<PrintScanLiteral> literal;
+};
+
+template<typename Unused>
+std::atomic<PrintScanLiteral> PrintScanDispatch<Unused>::literal(&PrintScanDispatch<Unused>::resolve);
+
+inline const char* print_scan_literal(const char* str)
+{
+    return PrintScanDispatch<>::literal.load(std::memory_order_relaxed)(str);
+}
+
+#endif // PRINT_SCAN_H
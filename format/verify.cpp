@@ -1,72 +1,87 @@
+#include "print2_impl.h"
 #include <stdio.h>
+#include <stddef.h>
 #include <string_view>
 #include <type_traits>
 #include <utility>
 #include <string>
+#include <chrono>
+
+using namespace std::chrono;
 
 #define ifc if constexpr
 #define elifc else if constexpr
 
+// Walks the format string at compile time. Besides checking the arguments
+// against the format, every literal run is emitted as a fixed size put and
+// every conversion as a direct call to the matching print2_format_* routine
+// with the State baked in, so nothing is parsed or dispatched at runtime.
+
 template<typename T> struct dependent_false : std::false_type
 {
 };
 
-template<size_t Idx, typename String, typename ...Args>
-constexpr void parsePercentFlags(String string, Args&& ...args);
+template<typename T>
+using remove_cvref_t = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
+
+template<size_t Idx, int32_t Flags, typename String, typename ...Args>
+void parsePercentFlags(BufferWriter& writer, String string, Args&& ...args);
 
-template<size_t Idx, typename String, typename ...Args>
-constexpr void parseChar(String string, Args&& ...args)
+constexpr size_t findPercent(std::string_view text, size_t idx)
+{
+    while (idx < text.size() && text[idx] != '%')
+        ++idx;
+    return idx;
+}
+
+template<size_t Start, typename String, typename ...Args>
+void parseChar(BufferWriter& writer, String string, Args&& ...args)
 {
     constexpr std::string_view text = string();
-    ifc (text[Idx] == '%') {
-        parsePercentFlags<Idx + 1>(string, std::forward<Args>(args)...);
-    } elifc (Idx < text.size()) {
-        parseChar<Idx + 1>(string, std::forward<Args>(args)...);
-    } elifc (sizeof...(args) > 0) {
-        static_assert(dependent_false<String>::value, "Extraneous arguments passed");
+    constexpr size_t Idx = findPercent(text, Start);
+    ifc (Idx < text.size() && text.data()[Idx + 1] == '%') {
+        writer.put(text.data() + Start, Idx + 1 - Start);
+        parseChar<Idx + 2>(writer, string, std::forward<Args>(args)...);
+    } else {
+        ifc (Idx > Start) {
+            writer.put(text.data() + Start, Idx - Start);
+        }
+        ifc (Idx < text.size()) {
+            parsePercentFlags<Idx + 1, State::Flag_None>(writer, string, std::forward<Args>(args)...);
+        } elifc (sizeof...(args) > 0) {
+            static_assert(dependent_false<String>::value, "Extraneous arguments passed");
+        }
     }
 }
 
-template<size_t Idx, typename FormatType, typename String, typename Arg, typename ...Args>
-constexpr void parseInt(String string, Arg i, Args&& ...args)
+template<typename FormatType, typename Arg>
+constexpr void checkInt()
 {
-    using ArgType = typename std::remove_cv<typename std::remove_reference<Arg>::type>::type;
+    using ArgType = remove_cvref_t<Arg>;
     static_assert(std::is_integral<ArgType>::value, "Argument is not integral");
     static_assert(sizeof(ArgType) <= sizeof(FormatType), "Wrong int type");
-    parseChar<Idx>(string, std::forward<Args>(args)...);
 }
 
-template<size_t Idx, typename FormatType, typename String, typename Arg, typename ...Args>
-constexpr void parseExact(String string, Arg i, Args&& ...args)
+template<typename FormatType, typename Arg>
+constexpr void checkExact()
 {
-    using ArgType = typename std::remove_cv<typename std::remove_reference<Arg>::type>::type;
+    using ArgType = remove_cvref_t<Arg>;
     static_assert(std::is_same<ArgType, FormatType>::value, "Invalid argument type");
-    parseChar<Idx>(string, std::forward<Args>(args)...);
 }
 
-template<size_t Idx, typename FormatType, typename String, typename Arg, typename ...Args>
-constexpr void parseDouble(String string, Arg f, Args&& ...args)
+template<typename FormatType, typename Arg>
+constexpr void checkDouble()
 {
-    using ArgType = typename std::remove_cv<typename std::remove_reference<Arg>::type>::type;
+    using ArgType = remove_cvref_t<Arg>;
     static_assert((std::is_same<ArgType, float>::value && std::is_same<FormatType, double>::value) || std::is_same<ArgType, FormatType>::value, "Wrong double type");
-    parseChar<Idx>(string, std::forward<Args>(args)...);
 }
 
-template<size_t Idx, typename String, typename Arg, typename ...Args>
-constexpr void parsePointer(String string, Arg f, Args&& ...args)
+template<typename Arg>
+constexpr void checkPointer()
 {
-    static_assert(std::is_pointer<Arg>::value, "Argument is not a pointer");
-    parseChar<Idx>(string, std::forward<Args>(args)...);
+    static_assert(std::is_pointer<remove_cvref_t<Arg> >::value, "Argument is not a pointer");
 }
 
-template<class T>
-struct is_c_string : std::integral_constant<
-    bool,
-    std::is_same<const char*, typename std::decay<T>::type>::value ||
-    std::is_same<char*, typename std::decay<T>::type>::value>
-{
-};
-
 template<class T>
 struct is_string : std::integral_constant<
     bool,
@@ -75,40 +90,29 @@ struct is_string : std::integral_constant<
 {
 };
 
-struct Foobar1
-{
-};
-
-static std::string to_string(const Foobar1&)
-{
-}
-
-struct Foobar2
-{
-};
-
-static std::string to_string(const Foobar2&)
+template<typename Arg>
+constexpr void checkString()
 {
+    using ArgType = remove_cvref_t<Arg>;
+    static_assert(is_string<ArgType>::value || has_global_to_string<ArgType>::value || has_member_to_string<ArgType>::value,
+                  "Needs to be a string or have a to_string");
 }
-struct FoobarNo
-{
-};
-
-template<typename, typename = void>
-struct has_global_to_string : std::false_type
-{
-};
-
-template<typename T>
-struct has_global_to_string<T, std::void_t<decltype(to_string(std::declval<T>()))> > : std::true_type
-{
-};
 
-template<size_t Idx, typename String, typename Arg, typename ...Args>
-constexpr void parseString(String string, Arg s, Args&& ...args)
-{
-    static_assert(is_string<Arg>::value || has_global_to_string<Arg>::value, "Needs to be a string or have a global to_string");
-    parseChar<Idx>(string, std::forward<Args>(args)...);
+template<typename Arg>
+void emitString(BufferWriter& writer, const State& state, Arg&& arg)
+{
+    using ArgType = remove_cvref_t<Arg>;
+    ifc (is_c_string<ArgType>::value) {
+        print2_format_generic(writer, state, typename Argument::StringType { arg, strlen(arg) });
+    } elifc (std::is_same<std::string, ArgType>::value) {
+        print2_format_generic(writer, state, typename Argument::StringType { arg.c_str(), arg.size() });
+    } elifc (has_global_to_string<ArgType>::value) {
+        const std::string& str = to_string(arg);
+        print2_format_generic(writer, state, typename Argument::StringType { str.c_str(), str.size() });
+    } else {
+        const std::string& str = arg.to_string();
+        print2_format_generic(writer, state, typename Argument::StringType { str.c_str(), str.size() });
+    }
 }
 
 enum class LengthType
@@ -239,157 +243,290 @@ struct TypeType<double, LengthType::L>
     typedef long double type;
 };
 
-template<size_t Idx, size_t Stars, LengthType Length, typename String, typename ...Args>
-constexpr void parsePercentSpecifier(String string, Args&& ...args);
+
+template<size_t Idx, LengthType Length, typename String, typename Arg, typename ...Args>
+void parsePercentConversion(BufferWriter& writer, const State& state, String string, Arg&& arg, Args&& ...args)
+{
+    constexpr const char* text = string();
+    ifc (text[Idx] == 'd' || text[Idx] == 'i') {
+        ifc (Length == LengthType::z) {
+            checkExact<ssize_t, Arg>();
+        } else {
+            checkInt<typename TypeType<int, Length>::type, Arg>();
+        }
+        print2_format_int_10<int64_t>(writer, state, static_cast<int64_t>(arg));
+    } elifc (text[Idx] == 'u' || text[Idx] == 'o' || text[Idx] == 'b' || text[Idx] == 'x' || text[Idx] == 'X') {
+        ifc (Length == LengthType::z) {
+            checkExact<size_t, Arg>();
+        } else {
+            checkInt<typename TypeType<unsigned int, Length>::type, Arg>();
+        }
+        ifc (text[Idx] == 'u') {
+            print2_format_int_10<uint64_t>(writer, state, static_cast<uint64_t>(arg));
+        } elifc (text[Idx] == 'o') {
+            print2_format_int_8<uint64_t>(writer, state, static_cast<uint64_t>(arg));
+        } elifc (text[Idx] == 'b') {
+            print2_format_int_2<uint64_t>(writer, state, static_cast<uint64_t>(arg));
+        } elifc (text[Idx] == 'x') {
+            print2_format_int_16<uint64_t>(writer, state, "0123456789abcdefx", static_cast<uint64_t>(arg));
+        } else {
+            print2_format_int_16<uint64_t>(writer, state, "0123456789ABCDEFX", static_cast<uint64_t>(arg));
+        }
+    } elifc (text[Idx] == 's') {
+        static_assert(Length == LengthType::None, "Invalid string length");
+        checkString<Arg>();
+        emitString(writer, state, std::forward<Arg>(arg));
+    } elifc (text[Idx] == 'p') {
+        static_assert(Length == LengthType::None, "Invalid pointer length");
+        checkPointer<Arg>();
+        print2_format_ptr(writer, state, "0123456789abcdefx", reinterpret_cast<uintptr_t>(arg));
+    } elifc (text[Idx] == 'c') {
+        checkInt<typename TypeType<signed char, Length>::type, Arg>();
+        print2_format_ch(writer, state, static_cast<int32_t>(arg));
+    } elifc (text[Idx] == 'n') {
+        using StoreType = typename TypeType<int, Length>::type;
+        checkExact<typename std::add_pointer<StoreType>::type, Arg>();
+        *arg = static_cast<StoreType>(writer.offset());
+    } elifc (text[Idx] == 'f' || text[Idx] == 'F' || text[Idx] == 'e' || text[Idx] == 'E' || text[Idx] == 'g' || text[Idx] == 'G'
+             || text[Idx] == 'a' || text[Idx] == 'A' || text[Idx] == 'r') {
+        static_assert(Length == LengthType::None || Length == LengthType::L, "Invalid floating point length");
+        checkDouble<typename TypeType<double, Length>::type, Arg>();
+        // floats and long doubles keep their type and use their own conversions
+        using FloatType = remove_cvref_t<Arg>;
+        ifc (text[Idx] == 'e') {
+            print2_format_float_exp<FloatType>(writer, state, arg);
+        } elifc (text[Idx] == 'E') {
+            print2_format_float_exp<FloatType, true>(writer, state, arg);
+        } elifc (text[Idx] == 'a') {
+            print2_format_float_hex<FloatType>(writer, state, arg);
+        } elifc (text[Idx] == 'A') {
+            print2_format_float_hex<FloatType, true>(writer, state, arg);
+        } elifc (text[Idx] == 'g') {
+            print2_format_float_general<FloatType>(writer, state, arg);
+        } elifc (text[Idx] == 'G') {
+            print2_format_float_general<FloatType, true>(writer, state, arg);
+        } elifc (text[Idx] == 'r') {
+            print2_format_float_roundtrip<FloatType>(writer, state, arg);
+        } else {
+            print2_format_float<FloatType>(writer, state, arg);
+        }
+    } else {
+        static_assert(dependent_false<String>::value, "Invalid format specifier");
+    }
+    parseChar<Idx + 1>(writer, string, std::forward<Args>(args)...);
+}
+
+template<size_t Idx, LengthType Length, typename String>
+void parsePercentConversion(BufferWriter& writer, const State& state, String string)
+{
+    static_assert(dependent_false<String>::value, "Not enough arguments");
+}
 
 template<size_t Idx, size_t Stars, LengthType Length, typename String, typename Arg, typename ...Args>
-constexpr void parsePercentStars(String string, Arg i, Args&& ...args)
+void parsePercentStars(BufferWriter& writer, State state, String string, Arg&& i, Args&& ...args)
 {
-    using ArgType = typename std::remove_cv<typename std::remove_reference<Arg>::type>::type;
-    static_assert(std::is_same<ArgType, int>::value, "Star argument must be int");
+    static_assert(std::is_same<remove_cvref_t<Arg>, int>::value, "Star argument must be int");
     static_assert(Stars > 0 && Stars <= 2, "Invalid star count");
+    if (state.width == State::Star) {
+        state.width = i;
+    } else {
+        state.precision = i;
+    }
     ifc (Stars > 1) {
-        parsePercentStars<Idx, Stars - 1, Length>(string, std::forward<Args>(args)...);
+        parsePercentStars<Idx, Stars - 1, Length>(writer, state, string, std::forward<Args>(args)...);
     } else {
-        parsePercentSpecifier<Idx, Stars - 1, Length>(string, std::forward<Args>(args)...);
+        parsePercentConversion<Idx, Length>(writer, state, string, std::forward<Args>(args)...);
     }
 }
 
-template<size_t Idx, size_t Stars, LengthType Length, typename String, typename ...Args>
-constexpr void parsePercentSpecifier(String string, Args&& ...args)
+template<size_t Idx, size_t Stars, LengthType Length, typename String>
+void parsePercentStars(BufferWriter& writer, State state, String string)
+{
+    static_assert(dependent_false<String>::value, "No star argument");
+}
+
+template<size_t Idx, size_t Stars, LengthType Length, int32_t Flags, int32_t Width, int32_t Precision, typename String, typename ...Args>
+void parsePercentSpecifier(BufferWriter& writer, String string, Args&& ...args)
 {
+    constexpr State state = { Flags, static_cast<State::Length>(Length), Width, Precision };
     ifc (Stars > 0) {
-        parsePercentStars<Idx, Stars, Length>(string, std::forward<Args>(args)...);
+        parsePercentStars<Idx, Stars, Length>(writer, state, string, std::forward<Args>(args)...);
     } else {
-        constexpr std::string_view text = string();
-        ifc (text[Idx] == 'd' || text[Idx] == 'i') {
-            ifc (Length == LengthType::z) {
-                parseExact<Idx + 1, ssize_t>(string, std::forward<Args>(args)...);
-            } else {
-                parseInt<Idx + 1, typename TypeType<int, Length>::type>(string, std::forward<Args>(args)...);
-            }
-        } elifc (text[Idx] == 'u' || text[Idx] == 'o' || text[Idx] == 'x' || text[Idx] == 'X') {
-            ifc (Length == LengthType::z) {
-                parseExact<Idx + 1, size_t>(string, std::forward<Args>(args)...);
-            } else {
-                parseInt<Idx + 1, typename TypeType<unsigned int, Length>::type>(string, std::forward<Args>(args)...);
-            }
-        } elifc (text[Idx] == 's') {
-            ifc (Length == LengthType::None) {
-                parseString<Idx + 1>(string, std::forward<Args>(args)...);
-            } else {
-                static_assert(dependent_false<String>::value, "Invalid string length");
-            }
-        } elifc (text[Idx] == 'p') {
-            ifc (Length == LengthType::None) {
-                parsePointer<Idx + 1>(string, std::forward<Args>(args)...);
-            } else {
-                static_assert(dependent_false<String>::value, "Invalid pointer length");
-            }
-        } elifc (text[Idx] == 'c') {
-            parseInt<Idx + 1, typename TypeType<signed char, Length>::type>(string, std::forward<Args>(args)...);
-        } elifc (text[Idx] == 'n') {
-            parseExact<Idx + 1, typename std::add_pointer<typename TypeType<int, Length>::type>::type>(string, std::forward<Args>(args)...);
-        } elifc (text[Idx] == 'f' || text[Idx] == 'F' || text[Idx] == 'e' || text[Idx] == 'E' || text[Idx] == 'g' || text[Idx] == 'G' || text[Idx] == 'a' || text[Idx] == 'A') {
-            parseDouble<Idx + 1, typename TypeType<double, Length>::type>(string, std::forward<Args>(args)...);
-        } else {
-            static_assert(dependent_false<String>::value, "Invalid format specifier");
-        }
+        parsePercentConversion<Idx, Length>(writer, state, string, std::forward<Args>(args)...);
     }
 }
 
-template<size_t Idx, size_t Stars, typename String, typename ...Args>
-constexpr void parsePercentLength(String string, Args&& ...args)
+template<size_t Idx, size_t Stars, int32_t Flags, int32_t Width, int32_t Precision, typename String, typename ...Args>
+void parsePercentLength(BufferWriter& writer, String string, Args&& ...args)
 {
-    constexpr std::string_view text = string();
+    constexpr const char* text = string();
     ifc (text[Idx] == 'h' && text[Idx + 1] == 'h') {
-        parsePercentSpecifier<Idx + 2, Stars, LengthType::hh>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 2, Stars, LengthType::hh, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 'h') {
-        parsePercentSpecifier<Idx + 1, Stars, LengthType::h>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 1, Stars, LengthType::h, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 'l' && text[Idx + 1] == 'l') {
-        parsePercentSpecifier<Idx + 2, Stars, LengthType::ll>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 2, Stars, LengthType::ll, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 'l') {
-        parsePercentSpecifier<Idx + 1, Stars, LengthType::l>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 1, Stars, LengthType::l, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 'j') {
-        parsePercentSpecifier<Idx + 1, Stars, LengthType::j>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 1, Stars, LengthType::j, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 'z') {
-        parsePercentSpecifier<Idx + 1, Stars, LengthType::z>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 1, Stars, LengthType::z, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 't') {
-        parsePercentSpecifier<Idx + 1, Stars, LengthType::t>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 1, Stars, LengthType::t, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == 'L') {
-        parsePercentSpecifier<Idx + 1, Stars, LengthType::L>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx + 1, Stars, LengthType::L, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '\0') {
+        static_assert(dependent_false<String>::value, "Zero termination encountered in length extraction");
     } else {
-        parsePercentSpecifier<Idx, Stars, LengthType::None>(string, std::forward<Args>(args)...);
+        parsePercentSpecifier<Idx, Stars, LengthType::None, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     }
 }
 
-template<size_t Idx, size_t Stars, typename String, typename ...Args>
-constexpr void parsePercentPrecision(String string, Args&& ...args)
+template<size_t Idx, size_t Stars, int32_t Flags, int32_t Width, int32_t Precision, typename String, typename ...Args>
+void parsePercentPrecision(BufferWriter& writer, String string, Args&& ...args)
 {
-    constexpr std::string_view text = string();
+    constexpr const char* text = string();
     ifc (text[Idx] == '*') {
-        parsePercentLength<Idx + 1, Stars + 1>(string, std::forward<Args>(args)...);
+        static_assert(Precision == 0, "Precision digits before star");
+        parsePercentLength<Idx + 1, Stars + 1, Flags, Width, State::Star>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] >= '0' && text[Idx] <= '9') {
-        parsePercentPrecision<Idx + 1, Stars>(string, std::forward<Args>(args)...);
+        parsePercentPrecision<Idx + 1, Stars, Flags, Width, std::min<int32_t>(Precision * 10 + (text[Idx] - '0'), 200)>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '\0') {
+        static_assert(dependent_false<String>::value, "Zero termination encountered in precision extraction");
     } else {
-        parsePercentLength<Idx + 1, Stars>(string, std::forward<Args>(args)...);
+        parsePercentLength<Idx, Stars, Flags, Width, Precision>(writer, string, std::forward<Args>(args)...);
     }
 }
 
-template<size_t Idx, size_t Stars, typename String, typename ...Args>
-constexpr void parsePercentWidth(String string, Args&& ...args)
+template<size_t Idx, size_t Stars, int32_t Flags, int32_t Width, typename String, typename ...Args>
+void parsePercentWidth(BufferWriter& writer, String string, Args&& ...args)
 {
-    constexpr std::string_view text = string();
+    constexpr const char* text = string();
     ifc (text[Idx] >= '0' && text[Idx] <= '9') {
-        parsePercentWidth<Idx + 1, Stars>(string, std::forward<Args>(args)...);
+        static_assert(Width != State::Star, "Width digits after star");
+        parsePercentWidth<Idx + 1, Stars, Flags, std::min<int32_t>(Width * 10 + (text[Idx] - '0'), 1024)>(writer, string, std::forward<Args>(args)...);
     } elifc (text[Idx] == '*') {
-        ifc (Stars == 0) {
-            parsePercentWidth<Idx + 1, Stars + 1>(string, std::forward<Args>(args)...);
+        ifc (Stars == 0 && Width == 0) {
+            parsePercentWidth<Idx + 1, Stars + 1, Flags, State::Star>(writer, string, std::forward<Args>(args)...);
         } else {
             static_assert(dependent_false<String>::value, "Too many stars in width");
         }
     } elifc (text[Idx] == '.') {
-        parsePercentPrecision<Idx + 1, Stars>(string, std::forward<Args>(args)...);
+        parsePercentPrecision<Idx + 1, Stars, Flags, Width, 0>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '\0') {
+        static_assert(dependent_false<String>::value, "Zero termination encountered in width extraction");
     } else {
-        parsePercentLength<Idx, Stars>(string, std::forward<Args>(args)...);
+        parsePercentLength<Idx, Stars, Flags, Width, State::None>(writer, string, std::forward<Args>(args)...);
     }
 }
 
-template<size_t Idx, typename String, typename ...Args>
-constexpr void parsePercentFlags(String string, Args&& ...args)
-{
-    constexpr std::string_view text = string();
-    ifc (text[Idx] == '-' || text[Idx] == '+' || text[Idx] == ' ' || text[Idx] == '#' || text[Idx] == '0') {
-        parsePercentFlags<Idx + 1>(string, std::forward<Args>(args)...);
+template<size_t Idx, int32_t Flags, typename String, typename ...Args>
+void parsePercentFlags(BufferWriter& writer, String string, Args&& ...args)
+{
+    constexpr const char* text = string();
+    ifc (text[Idx] == '-') {
+        parsePercentFlags<Idx + 1, Flags | State::Flag_LeftJustify>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '+') {
+        parsePercentFlags<Idx + 1, Flags | State::Flag_Sign>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == ' ') {
+        parsePercentFlags<Idx + 1, Flags | State::Flag_Space>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '#') {
+        parsePercentFlags<Idx + 1, Flags | State::Flag_Prefix>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '0') {
+        parsePercentFlags<Idx + 1, Flags | State::Flag_ZeroPad>(writer, string, std::forward<Args>(args)...);
+    } elifc (text[Idx] == '\0') {
+        static_assert(dependent_false<String>::value, "Zero termination encountered in flags extraction");
     } else {
-        parsePercentWidth<Idx, 0>(string, std::forward<Args>(args)...);
+        parsePercentWidth<Idx, 0, Flags, 0>(writer, string, std::forward<Args>(args)...);
     }
 }
 
 template<typename String, typename ...Args>
-constexpr void parse(String string, Args&& ...args)
+int snprint2_compiled(char* buffer, size_t bufsiz, String string, Args&& ...args)
 {
     constexpr std::string_view text = string();
-    static_assert(text[text.size()] == '\0');
-    parseChar<0>(string, std::forward<Args>(args)...);
+    static_assert(text.data()[text.size()] == '\0');
+    BufferWriter writer(buffer, bufsiz);
+    parseChar<0>(writer, string, std::forward<Args>(args)...);
+    return writer.terminate();
 }
 
-#define NERROR(str, ...)                        \
-    parse([]() { return str; }, ##__VA_ARGS__);
+#define SNPRINT2C(buffer, bufsiz, str, ...)                                     \
+    snprint2_compiled(buffer, bufsiz, []() { return str; }, ##__VA_ARGS__)
+
+struct Foobar
+{
+    std::string str;
+
+    std::string to_string() const
+    {
+        return str;
+    }
+};
 
 int main(int, char**)
 {
-    //auto foo = []() { return "hoo %s bafr\n"; };
-    uint32_t ball = 1;
-    uint64_t ball64 = 2;
-    signed char i;
-    //NERROR("ghod %llu%s%u\n", ball, "ting", 1u);
-    Foobar2 f;
-    std::string s;
-    size_t sz;
-    //NERROR("ghod %llu%s%u %s %u %zu %20s\n", ball, f, 1u, std::move(s), 1, sz, f);
-    //NERROR("hey %*.*s %f %n\n", 1, 1, "foo", 1, ball64);
-    long double a = 1.2;
-    NERROR("hey %*.*s %hhn%p%fe\n", 1, 1, f, &i, &i, 1.);
-    //parse(foo);
+    Foobar foobar { "foobar" };
+    int n = 0;
+    char buffer1[1024];
+    char buffer2[1024];
+    int r1 = SNPRINT2C(buffer1, sizeof(buffer1), "hey %*.*s %5.2s|%n%p%%%-6x|%08.3f %e\n", 1, 1, foobar, "abc", &n, &n, 255u, 1.5, 2.);
+    int r2 = snprint2(buffer2, sizeof(buffer2), "hey %*.*s %5.2s|%n%p%%%-6x|%08.3f %e\n", 1, 1, foobar, "abc", &n, &n, 255u, 1.5, 2.);
+    if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+        printf("verify failed\n%s%s", buffer1, buffer2);
+        return 1;
+    }
+
+    r1 = SNPRINT2C(buffer1, sizeof(buffer1), "%#b %-10G| %r %+r\n", 5u, 0.000012345, 0.1, 0.1f);
+    r2 = snprint2(buffer2, sizeof(buffer2), "%#b %-10G| %r %+r\n", 5u, 0.000012345, 0.1, 0.1f);
+    if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+        printf("verify failed\n%s%s", buffer1, buffer2);
+        return 1;
+    }
+
+    r1 = SNPRINT2C(buffer1, sizeof(buffer1), "%.20Lf %Le %Lg\n", 1.0L / 3.0L, -1e4000L, 0.1L);
+    r2 = snprintf(buffer2, sizeof(buffer2), "%.20Lf %Le %Lg\n", 1.0L / 3.0L, -1e4000L, 0.1L);
+    if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+        printf("verify failed\n%s%s", buffer1, buffer2);
+        return 1;
+    }
+
+    r1 = SNPRINT2C(buffer1, sizeof(buffer1), "%a %-12.3A| %+E %La\n", 0.1, -1.0 / 3.0, 6.02214076e23, 0.1L);
+    r2 = snprintf(buffer2, sizeof(buffer2), "%a %-12.3A| %+E %La\n", 0.1, -1.0 / 3.0, 6.02214076e23, 0.1L);
+    if (r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+        printf("verify failed\n%s%s", buffer1, buffer2);
+        return 1;
+    }
+
+    int fn1, fn2;
+
+    enum { Iter = 100000 };
+
+    auto t1 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i) {
+        r1 = snprint2(buffer1, sizeof(buffer1), "hello2 %#x%s%*u%p%s%f%-+20d\n%n", 1234567, "jappja", 140, 12345, &fn1, "trall og trall", 123.456, 99, &fn1);
+    }
+
+    auto t2 = steady_clock::now();
+    double delta1 = duration_cast<nanoseconds>(t2 - t1).count() / static_cast<double>(Iter);
+
+    auto t3 = steady_clock::now();
+    for (int i = 0; i < Iter; ++i) {
+        r2 = SNPRINT2C(buffer2, sizeof(buffer2), "hello2 %#x%s%*u%p%s%f%-+20d\n%n", 1234567, "jappja", 140, 12345, &fn1, "trall og trall", 123.456, 99, &fn2);
+    }
+
+    auto t4 = steady_clock::now();
+    double delta2 = duration_cast<nanoseconds>(t4 - t3).count() / static_cast<double>(Iter);
+
+    if (fn1 != fn2 || r1 != r2 || memcmp(buffer1, buffer2, r1 + 1) != 0) {
+        printf("verify failed (%d,%d) - (%d,%d)\n", fn1, fn2, r1, r2);
+        return 1;
+    }
+
+    printf("took, runtime  %f\n", delta1);
+    printf("took, compiled %f\n", delta2);
+    printf("verified %d\n", fn1);
+
+    return 0;
 }
@@ -67,6 +67,22 @@ static inline uint32_t log10Pow5(const int32_t e) {
   return (((uint32_t) e) * 732923) >> 20;
 }
 
+// Returns floor(log_2(10^e)) for e of either sign.
+static inline int32_t floorLog2Pow10(const int32_t e) {
+  // Exact for -1233 <= e <= 1232, the shift rounds toward minus infinity.
+  assert(e >= -1233);
+  assert(e <= 1232);
+  return (e * 1741647) >> 19;
+}
+
+// Returns floor(log_10(2^e)), or floor(log_10(3/4 * 2^e)) if threeQuarters,
+// for e of either sign.
+static inline int32_t floorLog10Pow2(const int32_t e, const bool threeQuarters) {
+  assert(e >= -1500);
+  assert(e <= 1500);
+  return (e * 1262611 - (threeQuarters ? 524031 : 0)) >> 22;
+}
+
 static inline int copy_special_str(char * const result, const bool sign, const bool exponent, const bool mantissa) {
   if (mantissa) {
     memcpy(result, "NaN", 3);
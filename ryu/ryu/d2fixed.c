@@ -22,6 +22,11 @@
 //     depending on your compiler.
 //
 // -DRYU_AVOID_UINT128 Avoid using uint128_t. Slower, depending on your compiler.
+//
+// -DRYU_D2FIXED_OPTIMIZE_SIZE Compute the POW10_SPLIT multipliers when they
+//     are first needed instead of storing them, see d2fixed_small_table.h.
+//     Removes about 100 KB of tables at the cost of a few microseconds
+//     whenever a row isn't in the per thread cache.
 
 #include "ryu/ryu2.h"
 
@@ -45,7 +50,20 @@ typedef __uint128_t uint128_t;
 
 #include "ryu/common.h"
 #include "ryu/digit_table.h"
+#if defined(RYU_D2FIXED_OPTIMIZE_SIZE)
+#include "ryu/d2fixed_small_table.h"
+#else
 #include "ryu/d2fixed_full_table.h"
+
+static inline const uint64_t* pow10Split(const uint32_t idx, const uint32_t i) {
+  return POW10_SPLIT[POW10_OFFSET[idx] + i];
+}
+
+static inline const uint64_t* pow10Split2(const uint32_t idx, const uint32_t p) {
+  (void) idx;
+  return POW10_SPLIT_2[p];
+}
+#endif
 #include "ryu/d2s_intrinsics.h"
 
 #define DOUBLE_MANTISSA_BITS 52
@@ -412,7 +430,7 @@ int d2fixed_buffered_n(double d, uint32_t precision, char* result) {
       const uint32_t j = p10bits - e2;
       // Temporary: j is usually around 128, and by shifting a bit, we push it to 128 or above, which is
       // a slightly faster code path in mulShift_mod1e9. Instead, we can just increase the multipliers.
-      const uint32_t digits = mulShift_mod1e9(m2 << 8, POW10_SPLIT[POW10_OFFSET[idx] + i], (int32_t) (j + 8));
+      const uint32_t digits = mulShift_mod1e9(m2 << 8, pow10Split(idx, (uint32_t) i), (int32_t) (j + 8));
       if (nonzero) {
         append_nine_digits(digits, result + index);
         index += 9;
@@ -464,7 +482,7 @@ int d2fixed_buffered_n(double d, uint32_t precision, char* result) {
       }
       // Temporary: j is usually around 128, and by shifting a bit, we push it to 128 or above, which is
       // a slightly faster code path in mulShift_mod1e9. Instead, we can just increase the multipliers.
-      uint32_t digits = mulShift_mod1e9(m2 << 8, POW10_SPLIT_2[p], j + 8);
+      uint32_t digits = mulShift_mod1e9(m2 << 8, pow10Split2((uint32_t) idx, p), j + 8);
 #ifdef RYU_DEBUG
       printf("digits=%u\n", digits);
 #endif
@@ -627,7 +645,7 @@ int d2exp_buffered_n(double d, uint32_t precision, char* result) {
       const uint32_t j = p10bits - e2;
       // Temporary: j is usually around 128, and by shifting a bit, we push it to 128 or above, which is
       // a slightly faster code path in mulShift_mod1e9. Instead, we can just increase the multipliers.
-      digits = mulShift_mod1e9(m2 << 8, POW10_SPLIT[POW10_OFFSET[idx] + i], (int32_t) (j + 8));
+      digits = mulShift_mod1e9(m2 << 8, pow10Split(idx, (uint32_t) i), (int32_t) (j + 8));
       if (printedDigits != 0) {
         if (printedDigits + 9 > precision) {
           availableDigits = 9;
@@ -664,9 +682,9 @@ int d2exp_buffered_n(double d, uint32_t precision, char* result) {
       const uint32_t p = POW10_OFFSET_2[idx] + (uint32_t) i - MIN_BLOCK_2[idx];
       // Temporary: j is usually around 128, and by shifting a bit, we push it to 128 or above, which is
       // a slightly faster code path in mulShift_mod1e9. Instead, we can just increase the multipliers.
-      digits = (p >= POW10_OFFSET_2[idx + 1]) ? 0 : mulShift_mod1e9(m2 << 8, POW10_SPLIT_2[p], j + 8);
+      digits = (p >= POW10_OFFSET_2[idx + 1]) ? 0 : mulShift_mod1e9(m2 << 8, pow10Split2((uint32_t) idx, p), j + 8);
 #ifdef RYU_DEBUG
-      printf("exact=%" PRIu64 " * (%" PRIu64 " + %" PRIu64 " << 64) >> %d\n", m2, POW10_SPLIT_2[p][0], POW10_SPLIT_2[p][1], j);
+      printf("exact=%" PRIu64 " * (%" PRIu64 " + %" PRIu64 " << 64) >> %d\n", m2, pow10Split2((uint32_t) idx, p)[0], pow10Split2((uint32_t) idx, p)[1], j);
       printf("digits=%u\n", digits);
 #endif
       if (printedDigits != 0) {
@@ -810,3 +828,147 @@ char* d2exp(double d, uint32_t precision) {
   buffer[index] = '\0';
   return buffer;
 }
+
+// The doubles nearest to 10^0 .. 10^308. A double compares against them the
+// same way it compares against the exact power of ten unless it is equal to
+// one of them, the rounded power may be on either side of the exact one.
+static const double POW10_DOUBLE[309] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+  1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22, 1e23,
+  1e24, 1e25, 1e26, 1e27, 1e28, 1e29, 1e30, 1e31,
+  1e32, 1e33, 1e34, 1e35, 1e36, 1e37, 1e38, 1e39,
+  1e40, 1e41, 1e42, 1e43, 1e44, 1e45, 1e46, 1e47,
+  1e48, 1e49, 1e50, 1e51, 1e52, 1e53, 1e54, 1e55,
+  1e56, 1e57, 1e58, 1e59, 1e60, 1e61, 1e62, 1e63,
+  1e64, 1e65, 1e66, 1e67, 1e68, 1e69, 1e70, 1e71,
+  1e72, 1e73, 1e74, 1e75, 1e76, 1e77, 1e78, 1e79,
+  1e80, 1e81, 1e82, 1e83, 1e84, 1e85, 1e86, 1e87,
+  1e88, 1e89, 1e90, 1e91, 1e92, 1e93, 1e94, 1e95,
+  1e96, 1e97, 1e98, 1e99, 1e100, 1e101, 1e102, 1e103,
+  1e104, 1e105, 1e106, 1e107, 1e108, 1e109, 1e110, 1e111,
+  1e112, 1e113, 1e114, 1e115, 1e116, 1e117, 1e118, 1e119,
+  1e120, 1e121, 1e122, 1e123, 1e124, 1e125, 1e126, 1e127,
+  1e128, 1e129, 1e130, 1e131, 1e132, 1e133, 1e134, 1e135,
+  1e136, 1e137, 1e138, 1e139, 1e140, 1e141, 1e142, 1e143,
+  1e144, 1e145, 1e146, 1e147, 1e148, 1e149, 1e150, 1e151,
+  1e152, 1e153, 1e154, 1e155, 1e156, 1e157, 1e158, 1e159,
+  1e160, 1e161, 1e162, 1e163, 1e164, 1e165, 1e166, 1e167,
+  1e168, 1e169, 1e170, 1e171, 1e172, 1e173, 1e174, 1e175,
+  1e176, 1e177, 1e178, 1e179, 1e180, 1e181, 1e182, 1e183,
+  1e184, 1e185, 1e186, 1e187, 1e188, 1e189, 1e190, 1e191,
+  1e192, 1e193, 1e194, 1e195, 1e196, 1e197, 1e198, 1e199,
+  1e200, 1e201, 1e202, 1e203, 1e204, 1e205, 1e206, 1e207,
+  1e208, 1e209, 1e210, 1e211, 1e212, 1e213, 1e214, 1e215,
+  1e216, 1e217, 1e218, 1e219, 1e220, 1e221, 1e222, 1e223,
+  1e224, 1e225, 1e226, 1e227, 1e228, 1e229, 1e230, 1e231,
+  1e232, 1e233, 1e234, 1e235, 1e236, 1e237, 1e238, 1e239,
+  1e240, 1e241, 1e242, 1e243, 1e244, 1e245, 1e246, 1e247,
+  1e248, 1e249, 1e250, 1e251, 1e252, 1e253, 1e254, 1e255,
+  1e256, 1e257, 1e258, 1e259, 1e260, 1e261, 1e262, 1e263,
+  1e264, 1e265, 1e266, 1e267, 1e268, 1e269, 1e270, 1e271,
+  1e272, 1e273, 1e274, 1e275, 1e276, 1e277, 1e278, 1e279,
+  1e280, 1e281, 1e282, 1e283, 1e284, 1e285, 1e286, 1e287,
+  1e288, 1e289, 1e290, 1e291, 1e292, 1e293, 1e294, 1e295,
+  1e296, 1e297, 1e298, 1e299, 1e300, 1e301, 1e302, 1e303,
+  1e304, 1e305, 1e306, 1e307, 1e308
+};
+
+// Bit k is set when POW10_DOUBLE[k] >= 10^k, which settles the comparison
+// for a double equal to the rounded power.
+static const uint64_t POW10_DOUBLE_NOT_BELOW_BITS[5] = {
+  0xc3c59f114e7fffffu,
+  0x063e5593f87950e1u,
+  0xf15774930db1ff25u,
+  0x197f5dc8e502e2c3u,
+  0x0014fa57d7b167d7u
+};
+
+#define POW10_DOUBLE_NOT_BELOW(k) ((POW10_DOUBLE_NOT_BELOW_BITS[(k) / 64] >> ((k) % 64)) & 1)
+
+static inline int special_length_printf(const bool sign, const uint64_t mantissa) {
+#if defined(_MSC_VER)
+  if (mantissa) {
+    return sign + (mantissa < (1ull << (DOUBLE_MANTISSA_BITS - 1)) ? 9 : 3);
+  }
+#else
+  if (mantissa) {
+    return 3;
+  }
+#endif
+  return sign + 8;
+}
+
+// Converts into scratch memory for the values whose length can't be told
+// from the exponent alone.
+static int length_by_conversion(double d, uint32_t precision, int (*convert)(double, uint32_t, char*)) {
+  // sign, 309 integer digits, point and exponent all fit in the 330
+  char* const buffer = (char*) malloc(precision + 330);
+  const int index = convert(d, precision, buffer);
+  free(buffer);
+  return index;
+}
+
+int d2fixed_length(double d, uint32_t precision) {
+  const uint64_t bits = double_to_bits(d);
+  const bool ieeeSign = ((bits >> (DOUBLE_MANTISSA_BITS + DOUBLE_EXPONENT_BITS)) & 1) != 0;
+  const uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
+  const uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1));
+
+  if (ieeeExponent == ((1u << DOUBLE_EXPONENT_BITS) - 1u)) {
+    return special_length_printf(ieeeSign, ieeeMantissa);
+  }
+  const int fraction = precision > 0 ? 1 + (int) precision : 0;
+  if (ieeeExponent < DOUBLE_BIAS) {
+    // below one the integer part is a single 0 or 1, even after rounding
+    return ieeeSign + 1 + fraction;
+  }
+
+  // 2^e <= |d| < 2^(e+1), so |d| has log10Pow2(e) + 1 or + 2 digits
+  const double v = ieeeSign ? -d : d;
+  const int32_t e = (int32_t) ieeeExponent - DOUBLE_BIAS;
+  int digits = (int) log10Pow2(e) + 1;
+  if (v > POW10_DOUBLE[digits] || (v == POW10_DOUBLE[digits] && POW10_DOUBLE_NOT_BELOW(digits))) {
+    ++digits;
+  }
+  // an integer part of all nines gets one more digit when the fraction rounds
+  // up into it. There are fraction bits only below 2^52 where the powers and
+  // the distance to them are exact. The fraction has to be within half a
+  // unit of the last place, with a little slack for the inexact bound, and
+  // past 16 digits no fraction of a double is that close.
+  if (e < DOUBLE_MANTISSA_BITS && precision <= 16 && v > POW10_DOUBLE[digits] - 1.0) {
+    const double rest = POW10_DOUBLE[digits] - v;
+    if (rest <= 0.5 / POW10_DOUBLE[precision] * (1.0 + 1e-9)) {
+      return length_by_conversion(d, precision, d2fixed_buffered_n);
+    }
+  }
+  return ieeeSign + digits + fraction;
+}
+
+int d2exp_length(double d, uint32_t precision) {
+  const uint64_t bits = double_to_bits(d);
+  const bool ieeeSign = ((bits >> (DOUBLE_MANTISSA_BITS + DOUBLE_EXPONENT_BITS)) & 1) != 0;
+  const uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
+  const uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1));
+
+  if (ieeeExponent == ((1u << DOUBLE_EXPONENT_BITS) - 1u)) {
+    return special_length_printf(ieeeSign, ieeeMantissa);
+  }
+  const int mantissa = 1 + (precision > 0 ? 1 + (int) precision : 0);
+
+  // only the number of exponent digits depends on the value. The exponent
+  // gets three digits from 1e100 up and below 1e-99, after rounding. Around
+  // those two boundaries rounding can move the value across, so convert.
+  const double v = ieeeSign ? -d : d;
+  int exponentDigits;
+  if (v > 1e100 || (v < 9e-100 && v != 0)) {
+    exponentDigits = 3;
+  } else if (v < 9e99 && v > 1e-99) {
+    exponentDigits = 2;
+  } else if (v == 0) {
+    exponentDigits = 2;
+  } else {
+    return length_by_conversion(d, precision, d2exp_buffered_n);
+  }
+  return ieeeSign + mantissa + 2 + exponentDigits;
+}
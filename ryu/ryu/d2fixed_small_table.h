@@ -0,0 +1,231 @@
+// Copyright 2018 Ulf Adams
+//
+// The contents of this file may be used under the terms of the Apache License,
+// Version 2.0.
+//
+//    (See accompanying file LICENSE-Apache or copy at
+//     http://www.apache.org/licenses/LICENSE-2.0)
+//
+// Alternatively, the contents of this file may be used under the terms of
+// the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE-Boost or copy at
+//     https://www.boost.org/LICENSE_1_0.txt)
+//
+// Unless required by applicable law or agreed to in writing, this software
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.
+#ifndef RYU_D2FIXED_SMALL_TABLE_H
+#define RYU_D2FIXED_SMALL_TABLE_H
+
+// The RYU_D2FIXED_OPTIMIZE_SIZE replacement for d2fixed_full_table.h. Only
+// the row offsets are stored, the multipliers are computed on first use:
+//
+//   POW10_SPLIT[idx][i]   = (floor(2^(16 idx + 120) / 10^(9 i)) + 1) mod (10^9 2^136)
+//   POW10_SPLIT_2[idx][i] = floor(10^(9 (i + 1)) 2^(120 - 16 idx)) mod (10^9 2^136)
+//
+// with a little base 2^32 bigint, dividing or multiplying by 10^9 per entry.
+// The last few rows of each are kept per thread. That takes a few hundred
+// bytes of rodata instead of about 100 KB, and costs a few microseconds when
+// a row isn't cached.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define RYU_THREAD_LOCAL __declspec(thread)
+#else
+#define RYU_THREAD_LOCAL _Thread_local
+#endif
+
+#define TABLE_SIZE 64
+
+static const uint16_t POW10_OFFSET[TABLE_SIZE] = {
+  0, 2, 5, 8, 12, 16, 21, 26, 32, 39,
+  46, 54, 62, 71, 80, 90, 100, 111, 122, 134,
+  146, 159, 173, 187, 202, 217, 233, 249, 266, 283,
+  301, 319, 338, 357, 377, 397, 418, 440, 462, 485,
+  508, 532, 556, 581, 606, 632, 658, 685, 712, 740,
+  769, 798, 828, 858, 889, 920, 952, 984, 1017, 1050,
+  1084, 1118, 1153, 1188
+};
+
+// POW10_SPLIT has 1224 entries, at most 36 in a row and the last row is
+// 2^1128 based, 36 limbs
+#define POW10_SPLIT_SIZE 1224
+#define POW10_ROW_MAX 36
+#define POW10_LIMBS 36
+
+#define TABLE_SIZE_2 69
+#define ADDITIONAL_BITS_2 120
+
+static const uint16_t POW10_OFFSET_2[TABLE_SIZE_2] = {
+     0,    2,    6,   12,   20,   29,   40,   52,   66,   80,
+    95,  112,  130,  150,  170,  192,  215,  240,  265,  292,
+   320,  350,  381,  413,  446,  480,  516,  552,  590,  629,
+   670,  712,  755,  799,  845,  892,  940,  989, 1040, 1092,
+  1145, 1199, 1254, 1311, 1369, 1428, 1488, 1550, 1613, 1678,
+  1743, 1810, 1878, 1947, 2017, 2088, 2161, 2235, 2311, 2387,
+  2465, 2544, 2625, 2706, 2789, 2873, 2959, 3046, 3133
+};
+
+static const uint8_t MIN_BLOCK_2[TABLE_SIZE_2] = {
+     0,    0,    0,    0,    0,    0,    1,    1,    2,    3,
+     3,    4,    4,    5,    5,    6,    6,    7,    7,    8,
+     8,    9,    9,   10,   11,   11,   12,   12,   13,   13,
+    14,   14,   15,   15,   16,   16,   17,   17,   18,   19,
+    19,   20,   20,   21,   21,   22,   22,   23,   23,   24,
+    24,   25,   26,   26,   27,   27,   28,   28,   29,   29,
+    30,   30,   31,   31,   32,   32,   33,   34,    0
+};
+
+// POW10_SPLIT_2 has 3133 entries, at most 87 in a row and the last one is
+// 10^(9 * 121) based, 3618 bits
+#define POW10_SPLIT_2_SIZE 3133
+#define POW10_ROW_MAX_2 87
+#define POW10_LIMBS_2 114
+
+// Cached rows per thread, for each of the two tables
+#define POW10_ROW_CACHE 2
+
+// tag is idx + 1, 0 for a slot that hasn't been filled
+typedef struct {
+  uint32_t tag;
+  uint64_t entries[POW10_ROW_MAX][3];
+} pow10_row;
+
+// POW10_SPLIT_2 rows are filled as far as they are used, d2fixed and d2exp
+// stop at the requested precision. power is 10^(9 count), one more factor of
+// 10^9 gives the next entry.
+typedef struct {
+  uint32_t tag;
+  uint32_t count;
+  int32_t limbs;
+  uint32_t power[POW10_LIMBS_2];
+  uint64_t entries[POW10_ROW_MAX_2][3];
+} pow10_row_2;
+
+// 32 bits of the number in limbs starting at bit, with zeros outside of it
+static inline uint32_t pow10_limb_bits(const uint32_t* const limbs, const int32_t count, const int32_t bit) {
+  const int32_t limb = bit >= 0 ? bit / 32 : -((31 - bit) / 32);
+  const int32_t shift = bit - 32 * limb;
+  const uint64_t lo = limb >= 0 && limb < count ? limbs[limb] : 0;
+  const uint64_t hi = limb + 1 >= 0 && limb + 1 < count ? limbs[limb + 1] : 0;
+  return (uint32_t) (((hi << 32) | lo) >> shift);
+}
+
+// floor(limbs / 2^shift) mod (10^9 2^136) as three 64 bit words, a negative
+// shift multiplies
+static inline void pow10_reduce(const uint32_t* const limbs, const int32_t count, const int32_t shift, uint64_t* const entry) {
+  uint32_t low[5];
+  for (int32_t k = 0; k < 5; ++k) {
+    low[k] = pow10_limb_bits(limbs, count, shift + 32 * k);
+  }
+  // the bits above 136 mod 10^9, most significant chunk first
+  uint64_t high = 0;
+  for (int32_t k = (32 * count - shift - 136 + 31) / 32; k >= 0; --k) {
+    high = ((high << 32) | pow10_limb_bits(limbs, count, shift + 136 + 32 * k)) % 1000000000;
+  }
+  entry[0] = low[0] | ((uint64_t) low[1] << 32);
+  entry[1] = low[2] | ((uint64_t) low[3] << 32);
+  entry[2] = (low[4] & 0xff) | (high << 8);
+}
+
+static void pow10_compute_row(const uint32_t idx, uint64_t (*const entries)[3]) {
+  // 2^(16 idx + 120), divided by 10^9 for every entry
+  uint32_t limbs[POW10_LIMBS];
+  const int32_t bits = 16 * (int32_t) idx + 120;
+  int32_t count = bits / 32 + 1;
+  memset(limbs, 0, sizeof(limbs));
+  limbs[bits / 32] = 1u << (bits % 32);
+  const uint32_t len = (idx + 1 < TABLE_SIZE ? POW10_OFFSET[idx + 1] : POW10_SPLIT_SIZE) - POW10_OFFSET[idx];
+  for (uint32_t i = 0; i < len; ++i) {
+    if (i > 0) {
+      uint64_t rest = 0;
+      for (int32_t k = count - 1; k >= 0; --k) {
+        const uint64_t v = (rest << 32) | limbs[k];
+        limbs[k] = (uint32_t) (v / 1000000000);
+        rest = v % 1000000000;
+      }
+      while (count > 1 && limbs[count - 1] == 0) {
+        --count;
+      }
+    }
+    uint64_t* const entry = entries[i];
+    pow10_reduce(limbs, count, 0, entry);
+    // + 1, wrapping around at 10^9 2^136
+    if (++entry[0] == 0 && ++entry[1] == 0) {
+      ++entry[2];
+    }
+    if ((entry[2] >> 8) == 1000000000) {
+      entry[2] &= 0xff;
+    }
+  }
+}
+
+// 10^(9 (i + 1)) for i from MIN_BLOCK_2[idx], multiplied by 10^9 for every
+// entry
+static void pow10_extend_row_2(const uint32_t idx, pow10_row_2* const row, const uint32_t i) {
+  const int32_t shift = 16 * (int32_t) idx - 120;
+  uint32_t* const limbs = row->power;
+  int32_t count = row->limbs;
+  for (; row->count <= i; ++row->count) {
+    uint64_t carry = 0;
+    for (int32_t k = 0; k < count; ++k) {
+      const uint64_t v = (uint64_t) limbs[k] * 1000000000 + carry;
+      limbs[k] = (uint32_t) v;
+      carry = v >> 32;
+    }
+    if (carry != 0) {
+      limbs[count++] = (uint32_t) carry;
+    }
+    if (row->count >= MIN_BLOCK_2[idx]) {
+      pow10_reduce(limbs, count, shift, row->entries[row->count - MIN_BLOCK_2[idx]]);
+    }
+  }
+  row->limbs = count;
+}
+
+static RYU_THREAD_LOCAL pow10_row POW10_ROWS[POW10_ROW_CACHE];
+static RYU_THREAD_LOCAL pow10_row_2 POW10_ROWS_2[POW10_ROW_CACHE];
+static RYU_THREAD_LOCAL uint32_t POW10_ROWS_NEXT;
+static RYU_THREAD_LOCAL uint32_t POW10_ROWS_NEXT_2;
+
+static inline const uint64_t* pow10Split(const uint32_t idx, const uint32_t i) {
+  for (uint32_t k = 0; k < POW10_ROW_CACHE; ++k) {
+    if (POW10_ROWS[k].tag == idx + 1) {
+      return POW10_ROWS[k].entries[i];
+    }
+  }
+  pow10_row* const row = &POW10_ROWS[POW10_ROWS_NEXT];
+  POW10_ROWS_NEXT = (POW10_ROWS_NEXT + 1) % POW10_ROW_CACHE;
+  row->tag = idx + 1;
+  pow10_compute_row(idx, row->entries);
+  return row->entries[i];
+}
+
+// p is the POW10_SPLIT_2 index, POW10_OFFSET_2[idx] + i - MIN_BLOCK_2[idx]
+static inline const uint64_t* pow10Split2(const uint32_t idx, const uint32_t p) {
+  const uint32_t i = p - POW10_OFFSET_2[idx] + MIN_BLOCK_2[idx];
+  pow10_row_2* row = NULL;
+  for (uint32_t k = 0; k < POW10_ROW_CACHE; ++k) {
+    if (POW10_ROWS_2[k].tag == idx + 1) {
+      row = &POW10_ROWS_2[k];
+      break;
+    }
+  }
+  if (row == NULL) {
+    row = &POW10_ROWS_2[POW10_ROWS_NEXT_2];
+    POW10_ROWS_NEXT_2 = (POW10_ROWS_NEXT_2 + 1) % POW10_ROW_CACHE;
+    row->tag = idx + 1;
+    row->count = 0;
+    row->limbs = 1;
+    row->power[0] = 1;
+  }
+  if (i >= row->count) {
+    pow10_extend_row_2(idx, row, i);
+  }
+  return row->entries[i - MIN_BLOCK_2[idx]];
+}
+
+#endif // RYU_D2FIXED_SMALL_TABLE_H
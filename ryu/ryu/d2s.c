@@ -26,8 +26,13 @@
 //     intermediate values with a multiplication. This reduces the lookup table
 //     size by about 10x (only one case, and only double) at the cost of some
 //     performance. Currently requires MSVC intrinsics.
+//
+// -DRYU_SCHUBFACH Use the Schubfach engine for d2s_buffered_n and d2s_batch
+//     instead of Ryu's, see d2d_schubfach. Both are always available as
+//     d2s_ryu_buffered_n and d2s_schubfach_buffered_n.
 
 #include "ryu/ryu.h"
+#include "ryu/simd.h"
 
 #include <assert.h>
 #include <stdbool.h>
@@ -40,6 +45,10 @@
 #include <stdio.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // ABSL avoids uint128_t on Win32 even if __SIZEOF_INT128__ is defined.
 // Let's do the same for now.
 #if defined(__SIZEOF_INT128__) && !defined(_MSC_VER) && !defined(RYU_ONLY_64_BIT_OPS)
@@ -52,6 +61,13 @@
 #include "ryu/digit_table.h"
 #include "ryu/d2s.h"
 #include "ryu/d2s_intrinsics.h"
+#include "ryu/d2s_schubfach_table.h"
+
+#if defined(RYU_SCHUBFACH)
+#define RYU_USE_SCHUBFACH true
+#else
+#define RYU_USE_SCHUBFACH false
+#endif
 
 // We need a 64x128-bit multiplication and a subsequent 128-bit shift.
 // Multiplication:
@@ -210,7 +226,11 @@ typedef struct floating_decimal_64 {
   int32_t exponent;
 } floating_decimal_64;
 
-static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa, const uint32_t ieeeExponent) {
+// chunked is a constant at every call site. It takes the removable digits 8
+// and 4 at a time before the usual 2 and 1, which pays off for short outputs
+// but costs full length ones a few multiplications, so only d2s_batch asks
+// for it when a column looks short.
+static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa, const uint32_t ieeeExponent, const bool chunked) {
   int32_t e2;
   uint64_t m2;
   if (ieeeExponent == 0) {
@@ -383,6 +403,28 @@ static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa, const uint32_
   } else {
     // Specialized for the common case (~99.3%). Percentages below are relative to this.
     bool roundUp = false;
+    if (chunked) {
+      const uint64_t vpDiv1e8 = div1e8(vp);
+      const uint64_t vmDiv1e8 = div1e8(vm);
+      if (vpDiv1e8 > vmDiv1e8) {
+        const uint64_t vrDiv1e8 = div1e8(vr);
+        roundUp = vr - 100000000 * vrDiv1e8 >= 50000000;
+        vr = vrDiv1e8;
+        vp = vpDiv1e8;
+        vm = vmDiv1e8;
+        removed += 8;
+      }
+      const uint64_t vpDiv10000 = div10000(vp);
+      const uint64_t vmDiv10000 = div10000(vm);
+      if (vpDiv10000 > vmDiv10000) {
+        const uint64_t vrDiv10000 = div10000(vr);
+        roundUp = vr - 10000 * vrDiv10000 >= 5000;
+        vr = vrDiv10000;
+        vp = vpDiv10000;
+        vm = vmDiv10000;
+        removed += 4;
+      }
+    }
     const uint64_t vpDiv100 = div100(vp);
     const uint64_t vmDiv100 = div100(vm);
     if (vpDiv100 > vmDiv100) { // Optimization: remove two digits at a time (~86.2%).
@@ -433,6 +475,136 @@ static inline floating_decimal_64 d2d(const uint64_t ieeeMantissa, const uint32_
   return fd;
 }
 
+// Returns the top 64 bits of the 64x128-bit product of cp and the Schubfach
+// multiplier g, with the lowest bit set if any of the bits below are (rounded
+// to odd). That keeps every comparison in d2d_schubfach exact.
+#if defined(HAS_UINT128)
+static inline uint64_t roundToOdd(const uint64_t* const g, const uint64_t cp) {
+  const uint128_t x = ((uint128_t) g[0]) * cp;
+  const uint128_t y = ((uint128_t) g[1]) * cp + (uint64_t) (x >> 64);
+  const uint64_t y1 = (uint64_t) (y >> 64);
+  const uint64_t y0 = (uint64_t) y;
+  return y1 | (y0 > 1);
+}
+#else
+static inline uint64_t roundToOdd(const uint64_t* const g, const uint64_t cp) {
+  uint64_t xHi;
+  umul128(g[0], cp, &xHi);
+  uint64_t y1;
+  const uint64_t yLo = umul128(g[1], cp, &y1);
+  const uint64_t y0 = yLo + xHi;
+  y1 += y0 < yLo;
+  return y1 | (y0 > 1);
+}
+#endif
+
+// Schubfach (Raffaello Giulietti, "The Schubfach way to render doubles")
+// finds the same shortest, closest, ties-to-even output as d2d. The value and
+// the two halfway points are scaled by 10^-k, with k = floor(log_10(2^e2)),
+// and the interval between the scaled halfway points is less than 10^(k+1)
+// wide. So it holds at most one number with a digit less, and otherwise the
+// closest of the candidates 10^k apart is it; no digit by digit removal. Each
+// scaling is a single roundToOdd against a table of 617 powers of ten.
+static inline floating_decimal_64 d2d_schubfach(const uint64_t ieeeMantissa, const uint32_t ieeeExponent) {
+  int32_t e2;
+  uint64_t m2;
+  if (ieeeExponent == 0) {
+    e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+    m2 = ieeeMantissa;
+  } else {
+    e2 = (int32_t) ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+    m2 = (1ull << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+  }
+  const bool acceptBounds = (m2 & 1) == 0;
+
+  // The value and the halfway points in units of 2^(e2 - 2), as in d2d.
+  const uint64_t mv = 4 * m2;
+  const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+  const uint64_t mp = 4 * m2 + 2;
+  const uint64_t mm = 4 * m2 - 1 - mmShift;
+
+  // Scaled to units of 10^k / 4. The shift h is between 1 and 4.
+  const int32_t k = floorLog10Pow2(e2, mmShift == 0);
+  const int32_t h = e2 + floorLog2Pow10(-k) + 1;
+  const uint64_t* const g = DOUBLE_POW10_SIGNIFICANDS[-k - DOUBLE_POW10_MIN];
+  const uint64_t vr = roundToOdd(g, mv << h);
+  const uint64_t vp = roundToOdd(g, mp << h) - !acceptBounds;
+  const uint64_t vm = roundToOdd(g, mm << h) + !acceptBounds;
+
+  floating_decimal_64 fd;
+  const uint64_t s = vr >> 2;
+  const uint64_t sp = div10(s);
+  const bool upInside = vm <= 40 * sp;
+  const bool wpInside = 40 * sp + 40 <= vp;
+  if (s >= 10 && upInside != wpInside) {
+    // One digit less fits.
+    fd.mantissa = sp + wpInside;
+    fd.exponent = k + 1;
+  } else {
+    const bool uInside = vm <= 4 * s;
+    const bool wInside = 4 * s + 4 <= vp;
+    if (uInside != wInside) {
+      fd.mantissa = s + wInside;
+    } else {
+      // Both are inside, take the closer one, or the even one on a tie.
+      const uint64_t mid = 4 * s + 2;
+      fd.mantissa = s + (vr > mid || (vr == mid && (s & 1) != 0));
+    }
+    fd.exponent = k;
+  }
+
+  // Shorter numbers than s / 10 show up as trailing zeros, up to 16 of them.
+  uint64_t q = div10(fd.mantissa);
+  if (((uint32_t) fd.mantissa) == 10 * (uint32_t) q) {
+    fd.mantissa = q;
+    ++fd.exponent;
+    q = div1e8(fd.mantissa);
+    while (((uint32_t) fd.mantissa) == 100000000 * (uint32_t) q) {
+      fd.mantissa = q;
+      fd.exponent += 8;
+      q = div1e8(q);
+    }
+    q = div10000(fd.mantissa);
+    if (((uint32_t) fd.mantissa) == 10000 * (uint32_t) q) {
+      fd.mantissa = q;
+      fd.exponent += 4;
+    }
+    q = div100(fd.mantissa);
+    if (((uint32_t) fd.mantissa) == 100 * (uint32_t) q) {
+      fd.mantissa = q;
+      fd.exponent += 2;
+    }
+    q = div10(fd.mantissa);
+    if (((uint32_t) fd.mantissa) == 10 * (uint32_t) q) {
+      fd.mantissa = q;
+      ++fd.exponent;
+    }
+  }
+  return fd;
+}
+
+static inline int to_chars_exponent(int32_t exp, char* const result) {
+  int index = 0;
+  result[index++] = 'E';
+  if (exp < 0) {
+    result[index++] = '-';
+    exp = -exp;
+  }
+
+  if (exp >= 100) {
+    const int32_t c = exp % 10;
+    memcpy(result + index, DIGIT_TABLE + 2 * (exp / 10), 2);
+    result[index + 2] = (char) ('0' + c);
+    index += 3;
+  } else if (exp >= 10) {
+    memcpy(result + index, DIGIT_TABLE + 2 * exp, 2);
+    index += 2;
+  } else {
+    result[index++] = (char) ('0' + exp);
+  }
+  return index;
+}
+
 static inline int to_chars(const floating_decimal_64 v, const bool sign, char* const result) {
   // Step 5: Print the decimal representation.
   int index = 0;
@@ -519,26 +691,7 @@ static inline int to_chars(const floating_decimal_64 v, const bool sign, char* c
   }
 
   // Print the exponent.
-  result[index++] = 'E';
-  int32_t exp = v.exponent + (int32_t) olength - 1;
-  if (exp < 0) {
-    result[index++] = '-';
-    exp = -exp;
-  }
-
-  if (exp >= 100) {
-    const int32_t c = exp % 10;
-    memcpy(result + index, DIGIT_TABLE + 2 * (exp / 10), 2);
-    result[index + 2] = (char) ('0' + c);
-    index += 3;
-  } else if (exp >= 10) {
-    memcpy(result + index, DIGIT_TABLE + 2 * exp, 2);
-    index += 2;
-  } else {
-    result[index++] = (char) ('0' + exp);
-  }
-
-  return index;
+  return index + to_chars_exponent(v.exponent + (int32_t) olength - 1, result + index);
 }
 
 static inline bool d2d_small_int(const uint64_t ieeeMantissa, const uint32_t ieeeExponent,
@@ -573,7 +726,34 @@ static inline bool d2d_small_int(const uint64_t ieeeMantissa, const uint32_t iee
   return true;
 }
 
-int d2s_buffered_n(double f, char* result) {
+// Steps 2 to 4 for anything but zero, infinity and NaN, with either engine.
+static inline floating_decimal_64 d2d_shortest(const uint64_t ieeeMantissa, const uint32_t ieeeExponent,
+  const bool chunked, const bool schubfach) {
+  floating_decimal_64 v;
+  const bool isSmallInt = d2d_small_int(ieeeMantissa, ieeeExponent, &v);
+  if (isSmallInt) {
+    // For small integers in the range [1, 2^53), v.mantissa might contain trailing (decimal) zeros.
+    // For scientific notation we need to move these zeros into the exponent.
+    // (This is not needed for fixed-point notation, so it might be beneficial to trim
+    // trailing zeros in to_chars only if needed - once fixed-point notation output is implemented.)
+    for (;;) {
+      const uint64_t q = div10(v.mantissa);
+      const uint32_t r = ((uint32_t) v.mantissa) - 10 * ((uint32_t) q);
+      if (r != 0) {
+        break;
+      }
+      v.mantissa = q;
+      ++v.exponent;
+    }
+  } else if (schubfach) {
+    v = d2d_schubfach(ieeeMantissa, ieeeExponent);
+  } else {
+    v = d2d(ieeeMantissa, ieeeExponent, chunked);
+  }
+  return v;
+}
+
+static inline int d2s_engine_buffered_n(double f, char* result, const bool schubfach) {
   // Step 1: Decode the floating-point number, and unify normalized and subnormal cases.
   const uint64_t bits = double_to_bits(f);
 
@@ -594,29 +774,22 @@ int d2s_buffered_n(double f, char* result) {
     return copy_special_str(result, ieeeSign, ieeeExponent, ieeeMantissa);
   }
 
-  floating_decimal_64 v;
-  const bool isSmallInt = d2d_small_int(ieeeMantissa, ieeeExponent, &v);
-  if (isSmallInt) {
-    // For small integers in the range [1, 2^53), v.mantissa might contain trailing (decimal) zeros.
-    // For scientific notation we need to move these zeros into the exponent.
-    // (This is not needed for fixed-point notation, so it might be beneficial to trim
-    // trailing zeros in to_chars only if needed - once fixed-point notation output is implemented.)
-    for (;;) {
-      const uint64_t q = div10(v.mantissa);
-      const uint32_t r = ((uint32_t) v.mantissa) - 10 * ((uint32_t) q);
-      if (r != 0) {
-        break;
-      }
-      v.mantissa = q;
-      ++v.exponent;
-    }
-  } else {
-    v = d2d(ieeeMantissa, ieeeExponent);
-  }
-
+  const floating_decimal_64 v = d2d_shortest(ieeeMantissa, ieeeExponent, false, schubfach);
   return to_chars(v, ieeeSign, result);
 }
 
+int d2s_ryu_buffered_n(double f, char* result) {
+  return d2s_engine_buffered_n(f, result, false);
+}
+
+int d2s_schubfach_buffered_n(double f, char* result) {
+  return d2s_engine_buffered_n(f, result, true);
+}
+
+int d2s_buffered_n(double f, char* result) {
+  return d2s_engine_buffered_n(f, result, RYU_USE_SCHUBFACH);
+}
+
 void d2s_buffered(double f, char* result) {
   const int index = d2s_buffered_n(f, result);
 
@@ -629,3 +802,141 @@ char* d2s(double f) {
   d2s_buffered(f, result);
   return result;
 }
+
+#if defined(__SSE2__)
+static const uint64_t POW10_17[17] = {
+  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+  1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+  100000000000000ull, 1000000000000000ull, 10000000000000000ull
+};
+
+// The 16 digits of b and c, both less than 10^8, as ASCII.
+// Each half is split into two 4-digit numbers abcd and efgh. These are spread
+// over four 16-bit lanes each and divided by 1000, 100, 10 and 1 with
+// multiply-high by fixed-point reciprocals, giving a, ab, abc, abcd. Taking
+// ten times the lane to the left away leaves a single digit per lane. The
+// reciprocals are exact for all inputs below 10^4.
+static inline __m128i digits16(const uint32_t b, const uint32_t c) {
+  const __m128i x = _mm_set_epi64x(c, b);
+  const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(x, _mm_set1_epi32((int) 0xd1b71759)), 45);
+  const __m128i efgh = _mm_sub_epi32(x, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+  // 4 * [abcd(b), efgh(b), abcd(c), efgh(c)] in 16-bit lanes, then each one four times.
+  const __m128i halves = _mm_or_si128(abcd, _mm_slli_epi64(efgh, 32));
+  const __m128i quads = _mm_slli_epi16(_mm_packs_epi32(halves, halves), 2);
+  const __m128i pairs = _mm_unpacklo_epi16(quads, quads);
+  const __m128i reciprocals = _mm_set_epi16(
+    (short) 32768, 13108, 5243, 8389, (short) 32768, 13108, 5243, 8389);
+  const __m128i shifts = _mm_set_epi16(
+    (short) (1 << 15), 1 << 13, 1 << 11, 1 << 7, (short) (1 << 15), 1 << 13, 1 << 11, 1 << 7);
+  const __m128i ten = _mm_set1_epi16(10);
+  __m128i hi = _mm_mulhi_epu16(_mm_mulhi_epu16(_mm_unpacklo_epi32(pairs, pairs), reciprocals), shifts);
+  __m128i lo = _mm_mulhi_epu16(_mm_mulhi_epu16(_mm_unpackhi_epi32(pairs, pairs), reciprocals), shifts);
+  hi = _mm_sub_epi16(hi, _mm_slli_epi64(_mm_mullo_epi16(hi, ten), 16));
+  lo = _mm_sub_epi16(lo, _mm_slli_epi64(_mm_mullo_epi16(lo, ten), 16));
+  return _mm_add_epi8(_mm_packus_epi16(hi, lo), _mm_set1_epi8('0'));
+}
+
+// The same output as to_chars. Scaling the mantissa by 10^(17 - olength)
+// left aligns the digits, so the first one is always the 10^16 digit and the
+// rest go out as one block of 16 after the decimal dot, whatever olength is.
+// The exponent overwrites what's past the last digit. Writes at most 24 bytes,
+// like to_chars.
+static inline int to_chars_sse2(const floating_decimal_64 v, const bool sign, char* const result) {
+  int index = 0;
+  if (sign) {
+    result[index++] = '-';
+  }
+
+  const uint32_t olength = decimalLength17(v.mantissa);
+  const uint64_t output = v.mantissa * POW10_17[17 - olength];
+  const uint64_t q = div1e8(output);
+  const uint32_t c = ((uint32_t) output) - 100000000 * ((uint32_t) q);
+  const uint32_t first = ((uint32_t) q) / 100000000;
+  const uint32_t b = ((uint32_t) q) - 100000000 * first;
+
+  result[index] = (char) ('0' + first);
+  result[index + 1] = '.';
+  _mm_storeu_si128((__m128i*) (result + index + 2), digits16(b, c));
+  index += olength > 1 ? olength + 1 : 1;
+
+  return index + to_chars_exponent(v.exponent + (int32_t) olength - 1, result + index);
+}
+#endif
+
+// The batch loop with the SSE2 digit writer or with to_chars, sse2 is a
+// constant at every call site.
+static inline size_t d2s_batch_with(const double* values, size_t count, char* result, uint32_t* offsets,
+  const bool sse2) {
+  // Values in a column tend to be alike, so the previous output's length picks
+  // Ryu's digit removal for the next one.
+  bool chunked = false;
+  size_t index = 0;
+  for (size_t i = 0; i < count; ++i) {
+    offsets[i] = (uint32_t) index;
+
+    const uint64_t bits = double_to_bits(values[i]);
+    const bool ieeeSign = ((bits >> (DOUBLE_MANTISSA_BITS + DOUBLE_EXPONENT_BITS)) & 1) != 0;
+    const uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
+    const uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1));
+    if (ieeeExponent == ((1u << DOUBLE_EXPONENT_BITS) - 1u) || (ieeeExponent == 0 && ieeeMantissa == 0)) {
+      index += copy_special_str(result + index, ieeeSign, ieeeExponent, ieeeMantissa);
+      continue;
+    }
+
+    const floating_decimal_64 v = chunked
+      ? d2d_shortest(ieeeMantissa, ieeeExponent, true, RYU_USE_SCHUBFACH)
+      : d2d_shortest(ieeeMantissa, ieeeExponent, false, RYU_USE_SCHUBFACH);
+    chunked = v.mantissa < 10000000000ull;
+#if defined(__SSE2__)
+    if (sse2) {
+      index += to_chars_sse2(v, ieeeSign, result + index);
+      continue;
+    }
+#else
+    (void) sse2;
+#endif
+    index += to_chars(v, ieeeSign, result + index);
+  }
+  offsets[count] = (uint32_t) index;
+  return index;
+}
+
+typedef size_t (*d2s_batch_fn)(const double* values, size_t count, char* result, uint32_t* offsets);
+
+static size_t d2s_batch_generic(const double* values, size_t count, char* result, uint32_t* offsets) {
+  return d2s_batch_with(values, count, result, offsets, false);
+}
+
+#if defined(__SSE2__)
+static size_t d2s_batch_sse2(const double* values, size_t count, char* result, uint32_t* offsets) {
+  return d2s_batch_with(values, count, result, offsets, true);
+}
+#endif
+
+// d2s_batch_impl starts out here and is replaced by the variant for
+// ryu_simd_level() on the first call.
+static size_t d2s_batch_resolve(const double* values, size_t count, char* result, uint32_t* offsets);
+static d2s_batch_fn d2s_batch_impl = d2s_batch_resolve;
+
+static size_t d2s_batch_resolve(const double* values, size_t count, char* result, uint32_t* offsets) {
+  d2s_batch_fn impl = d2s_batch_generic;
+#if defined(__SSE2__)
+  if (ryu_simd_level() >= RYU_SIMD_SSE2) {
+    impl = d2s_batch_sse2;
+  }
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+  __atomic_store_n(&d2s_batch_impl, impl, __ATOMIC_RELAXED);
+#else
+  d2s_batch_impl = impl;
+#endif
+  return impl(values, count, result, offsets);
+}
+
+size_t d2s_batch(const double* values, size_t count, char* result, uint32_t* offsets) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __atomic_load_n(&d2s_batch_impl, __ATOMIC_RELAXED)(values, count, result, offsets);
+#else
+  return d2s_batch_impl(values, count, result, offsets);
+#endif
+}
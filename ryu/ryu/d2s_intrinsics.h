@@ -130,6 +130,10 @@ static inline uint64_t div100(const uint64_t x) {
   return umulh(x >> 2, 0x28F5C28F5C28F5C3u) >> 2;
 }
 
+static inline uint64_t div10000(const uint64_t x) {
+  return umulh(x >> 4, 0x346DC5D63886594Bu) >> 7;
+}
+
 static inline uint64_t div1e8(const uint64_t x) {
   return umulh(x, 0xABCC77118461CEFDu) >> 26;
 }
@@ -165,6 +169,10 @@ static inline uint64_t div100(const uint64_t x) {
   return x / 100;
 }
 
+static inline uint64_t div10000(const uint64_t x) {
+  return x / 10000;
+}
+
 static inline uint64_t div1e8(const uint64_t x) {
   return x / 100000000;
 }
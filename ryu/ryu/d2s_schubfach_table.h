@@ -0,0 +1,339 @@
+// Copyright 2018 Ulf Adams
+//
+// The contents of this file may be used under the terms of the Apache License,
+// Version 2.0.
+//
+//    (See accompanying file LICENSE-Apache or copy at
+//     http://www.apache.org/licenses/LICENSE-2.0)
+//
+// Alternatively, the contents of this file may be used under the terms of
+// the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE-Boost or copy at
+//     https://www.boost.org/LICENSE_1_0.txt)
+//
+// Unless required by applicable law or agreed to in writing, this software
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.
+#ifndef RYU_D2S_SCHUBFACH_TABLE_H
+#define RYU_D2S_SCHUBFACH_TABLE_H
+
+#include <stdint.h>
+
+// The Schubfach multipliers: entry k - DOUBLE_POW10_MIN is
+// floor(10^k * 2^(127 - floor(log_2(10^k)))) + 1 as { low, high } 64-bit
+// halves, for -292 <= k <= 324.
+#define DOUBLE_POW10_MIN -292
+#define DOUBLE_POW10_MAX 324
+static const uint64_t DOUBLE_POW10_SIGNIFICANDS[617][2] = {
+  {  2731688931043774331u, 18408377700990114895u }, {  8624834609543440813u, 11505236063118821809u },
+  { 15392729280356688920u, 14381545078898527261u }, {  5405853545163697438u, 17976931348623159077u },
+  {  5684501474941004851u, 11235582092889474423u }, {  2493940825248868160u, 14044477616111843029u },
+  {  7729112049988473104u, 17555597020139803786u }, {  9442381049670183594u, 10972248137587377366u },
+  {  2579604275232953684u, 13715310171984221708u }, {  3224505344041192105u, 17144137714980277135u },
+  {  8932844867666826922u, 10715086071862673209u }, { 15777742103010921556u, 13393857589828341511u },
+  { 15110491610336264041u, 16742321987285426889u }, {  2526528228819083170u, 10463951242053391806u },
+  { 12381532322878629771u, 13079939052566739757u }, {  1641857348316123501u, 16349923815708424697u },
+  { 12555375888766046948u, 10218702384817765435u }, { 11082533842530170781u, 12773377981022206794u },
+  {  4629795266307937668u, 15966722476277758493u }, {  5199465050656154995u,  9979201547673599058u },
+  { 15722703350174969552u, 12474001934591998822u }, { 10430007150863936131u, 15592502418239998528u },
+  {  6518754469289960082u,  9745314011399999080u }, {  8148443086612450103u, 12181642514249998850u },
+  {   962181821410786820u, 15227053142812498563u }, { 16742264702877599427u,  9516908214257811601u },
+  {  7092772823314835571u, 11896135267822264502u }, { 18089338065998320272u, 14870169084777830627u },
+  {  8999993282035256218u,  9293855677986144142u }, {  2026619565689294465u, 11617319597482680178u },
+  { 11756646493966393889u, 14521649496853350222u }, {  5472436080603216553u, 18152061871066687778u },
+  {  8031958568804398250u, 11345038669416679861u }, { 14651634229432885716u, 14181298336770849826u },
+  {  9091170749936331337u, 17726622920963562283u }, {  3376138709496513134u, 11079139325602226427u },
+  { 18055231442152805129u, 13848924157002783033u }, {  8733981247408842699u, 17311155196253478792u },
+  {  5458738279630526687u, 10819471997658424245u }, { 11435108867965546263u, 13524339997073030306u },
+  {  5070514048102157021u, 16905424996341287883u }, {   863228270850154186u, 10565890622713304927u },
+  { 14914093393844856444u, 13207363278391631158u }, {  9419244705451294747u, 16509204097989538948u },
+  { 15110399977761835025u, 10318252561243461842u }, {  9664627935347517974u, 12897815701554327303u },
+  {  7469098900757009563u, 16122269626942909129u }, { 16197401859041600737u, 10076418516839318205u },
+  {  6411694268519837209u, 12595523146049147757u }, { 12626303854077184415u, 15744403932561434696u },
+  {  7891439908798240260u,  9840252457850896685u }, { 14475985904425188228u, 12300315572313620856u },
+  { 18094982380531485285u, 15375394465392026070u }, {  6697677969404790400u,  9609621540870016294u },
+  { 17595469498610763807u, 12012026926087520367u }, { 17382650854836066855u, 15015033657609400459u },
+  {  8558313775058847833u,  9384396036005875287u }, {  6086206200396171887u, 11730495045007344109u },
+  { 12219443768922602762u, 14663118806259180136u }, { 15274304711153253453u, 18328898507823975170u },
+  { 14158126462898171312u, 11455561567389984481u }, {  3862600023340550428u, 14319451959237480602u },
+  { 14051622066030463843u, 17899314949046850752u }, {  8782263791269039902u, 11187071843154281720u },
+  { 10977829739086299877u, 13983839803942852150u }, {  4498915137003099038u, 17479799754928565188u },
+  { 12035193997481712707u, 10924874846830353242u }, {  5820620459997365076u, 13656093558537941553u },
+  { 11887461593424094249u, 17070116948172426941u }, {  9735506505103752858u, 10668823092607766838u },
+  {  2946011094524915264u, 13336028865759708548u }, {  3682513868156144080u, 16670036082199635685u },
+  {  4607414176811284002u, 10418772551374772303u }, {  1147581702586717098u, 13023465689218465379u },
+  { 15269535183515560085u, 16279332111523081723u }, {  7237616480483531101u, 10174582569701926077u },
+  { 13658706619031801780u, 12718228212127407596u }, { 17073383273789752225u, 15897785265159259495u },
+  { 17588393573759676997u,  9936115790724537184u }, {  3538747893490044630u, 12420144738405671481u },
+  {  9035120885289943692u, 15525180923007089351u }, { 12564479580947296664u,  9703238076879430844u },
+  { 15705599476184120829u, 12129047596099288555u }, { 15020313326802763132u, 15161309495124110694u },
+  {  4776009810824339054u,  9475818434452569184u }, {  5970012263530423817u, 11844773043065711480u },
+  {  7462515329413029772u, 14805966303832139350u }, {    52386062455755703u,  9253728939895087094u },
+  {  9288854614924470437u, 11567161174868858867u }, {  6999382250228200142u, 14458951468586073584u },
+  {  8749227812785250178u, 18073689335732591980u }, { 14691639419845557169u, 11296055834832869987u },
+  { 13752863256379558557u, 14120069793541087484u }, { 17191079070474448197u, 17650087241926359355u },
+  {  8438581409832836171u, 11031304526203974597u }, { 15159912780718433118u, 13789130657754968246u },
+  {  9726518939043265589u, 17236413322193710308u }, { 15302446373756816801u, 10772758326371068942u },
+  {  9904685930341245194u, 13465947907963836178u }, {  3157485376071780684u, 16832434884954795223u },
+  {  8890957387685944784u, 10520271803096747014u }, {  1890324697752655171u, 13150339753870933768u },
+  {  2362905872190818964u, 16437924692338667210u }, {  6088502188546649757u, 10273702932711667006u },
+  { 16833999772538088004u, 12842128665889583757u }, {  7207441660390446293u, 16052660832361979697u },
+  { 16033866083812498693u, 10032913020226237310u }, { 10818960567910847558u, 12541141275282796638u },
+  {  4300328673033783640u, 15676426594103495798u }, { 16522763475928278487u,  9797766621314684873u },
+  {  6818396289628184397u, 12247208276643356092u }, {  8522995362035230496u, 15309010345804195115u },
+  {  3021029092058325108u,  9568131466127621947u }, { 17611344420355070097u, 11960164332659527433u },
+  {  8179122470161673909u, 14950205415824409292u }, { 14335323580705822001u,  9343878384890255807u },
+  { 13307468457454889597u, 11679847981112819759u }, { 12022649553391224093u, 14599809976391024699u },
+  { 10416625923311642212u, 18249762470488780874u }, { 11122077220497164287u, 11406101544055488046u },
+  {  4679224488766679550u, 14257626930069360058u }, { 15072402647813125245u, 17822033662586700072u },
+  {  9420251654883203279u, 11138771039116687545u }, { 16387000587031392002u, 13923463798895859431u },
+  { 15872064715361852098u, 17404329748619824289u }, {  3002511419460075706u, 10877706092887390181u },
+  {  8364825292752482536u, 13597132616109237726u }, {  1232659579085827362u, 16996415770136547158u },
+  { 14605470292210805813u, 10622759856335341973u }, {  4421779809981343555u, 13278449820419177467u },
+  {   915538744049291539u, 16598062275523971834u }, {  5183897733458195116u, 10373788922202482396u },
+  {  6479872166822743895u, 12967236152753102995u }, {  3488154190101041965u, 16209045190941378744u },
+  {  2180096368813151228u, 10130653244338361715u }, { 16560178516298602747u, 12663316555422952143u },
+  { 16088537126945865530u, 15829145694278690179u }, {  7749492695127472004u,  9893216058924181362u },
+  {   463493832054564197u, 12366520073655226703u }, { 14414425345350368958u, 15458150092069033378u },
+  { 13620701859271368503u,  9661343807543145861u }, {  3190819268807046917u, 12076679759428932327u },
+  { 17823582141290972358u, 15095849699286165408u }, { 11139738838306857724u,  9434906062053853380u },
+  { 13924673547883572155u, 11793632577567316725u }, {  3570783879572301481u, 14742040721959145907u },
+  { 18298537904747540563u, 18427550902448932383u }, { 18354115218108294708u, 11517219314030582739u },
+  { 18330958004207980481u, 14396524142538228424u }, {  4466953431550423985u, 17995655178172785531u },
+  {   486002885505321039u, 11247284486357990957u }, {  5219189625309039203u, 14059105607947488696u },
+  {  6523987031636299003u, 17573882009934360870u }, { 17912549950054850589u, 10983676256208975543u },
+  { 17779001419141175332u, 13729595320261219429u }, {  8388693718644305453u, 17161994150326524287u },
+  { 12160462601793772765u, 10726246343954077679u }, { 10588892233814828052u, 13407807929942597099u },
+  {  8624429273841147160u, 16759759912428246374u }, {   778582277723329071u, 10474849945267653984u },
+  {   973227847154161339u, 13093562431584567480u }, {  1216534808942701674u, 16366953039480709350u },
+  { 14595392310871352258u, 10229345649675443343u }, { 13632554370161802419u, 12786682062094304179u },
+  { 12429006944274865119u, 15983352577617880224u }, {  7768129340171790700u,  9989595361011175140u },
+  {  9710161675214738375u, 12486994201263968925u }, { 16749388112445810872u, 15608742751579961156u },
+  {  1244995533423855987u,  9755464219737475723u }, { 15391302472061983696u, 12194330274671844653u },
+  {  5404070034795315908u, 15242912843339805817u }, { 14906758817815542203u,  9526820527087378635u },
+  { 14021762503842039849u, 11908525658859223294u }, {  8303831092947774003u, 14885657073574029118u },
+  {   578208414664970848u,  9303535670983768199u }, { 14557818573613377272u, 11629419588729710248u },
+  { 18197273217016721590u, 14536774485912137810u }, { 13523219484416126179u, 18170968107390172263u },
+  { 15369541205401160718u, 11356855067118857664u }, {   765182433041899282u, 14196068833898572081u },
+  {  5568164059729762006u, 17745086042373215101u }, {  5785945546544795206u, 11090678776483259438u },
+  { 16455803970035769815u, 13863348470604074297u }, {  6734696907262548557u, 17329185588255092872u },
+  {  4209185567039092848u, 10830740992659433045u }, {  9873167977226253964u, 13538426240824291306u },
+  {  3118087934678041647u, 16923032801030364133u }, {  4254647968387469982u, 10576895500643977583u },
+  {   706623942056949573u, 13221119375804971979u }, { 14718337982853350678u, 16526399219756214973u },
+  { 11504804248497038126u, 10328999512347634358u }, {  5157633273766521850u, 12911249390434542948u },
+  {  6447041592208152312u, 16139061738043178685u }, {  6335244004343789147u, 10086913586276986678u },
+  { 17142427042284512242u, 12608641982846233347u }, { 16816347784428252398u, 15760802478557791684u },
+  {  1286845328412881941u,  9850501549098619803u }, { 15443614715798266138u, 12313126936373274753u },
+  {  5469460339465668960u, 15391408670466593442u }, {  8030098730593431004u,  9619630419041620901u },
+  { 14649309431669176659u, 12024538023802026126u }, {  9088264752731695016u, 15030672529752532658u },
+  { 10291851488884697289u,  9394170331095332911u }, {  8253128342678483707u, 11742712913869166139u },
+  {  5704724409920716730u, 14678391142336457674u }, { 16354277549255671721u, 18347988927920572092u },
+  {   998051431430019018u, 11467493079950357558u }, { 10470936326142299580u, 14334366349937946947u },
+  {  8476984389250486571u, 17917957937422433684u }, { 14521487280136329915u, 11198723710889021052u },
+  { 18151859100170412393u, 13998404638611276315u }, { 18078137856785627588u, 17498005798264095394u },
+  { 15910522178918405147u, 10936253623915059621u }, {  6053094668365842721u, 13670317029893824527u },
+  {  2954682317029915497u, 17087896287367280659u }, { 17987577512639554850u, 10679935179604550411u },
+  { 17872785872372055658u, 13349918974505688014u }, { 13117610303610293765u, 16687398718132110018u },
+  { 12810192458183821507u, 10429624198832568761u }, {  2177682517447613172u, 13037030248540710952u },
+  {  2722103146809516465u, 16296287810675888690u }, {  6313000485183335695u, 10185179881672430431u },
+  {  3279564588051781714u, 12731474852090538039u }, { 17934513790346890854u, 15914343565113172548u },
+  {  1985699082112030976u,  9946464728195732843u }, { 16317181907922202432u, 12433080910244666053u },
+  {  6561419329620589328u, 15541351137805832567u }, { 11018416108653950186u,  9713344461128645354u },
+  {  4549648098962661925u, 12141680576410806693u }, { 10298746142130715310u, 15177100720513508366u },
+  {  1825030320404309165u,  9485687950320942729u }, {  6892973918932774360u, 11857109937901178411u },
+  {  4004531380238580046u, 14821387422376473014u }, { 16337890167931276241u,  9263367138985295633u },
+  {  6587304654631931589u, 11579208923731619542u }, { 17457502855144690294u, 14474011154664524427u },
+  { 17210192550503474963u, 18092513943330655534u }, {  6144684325637283948u, 11307821214581659709u },
+  { 12292541425473992839u, 14134776518227074636u }, { 15365676781842491049u, 17668470647783843295u },
+  { 16521077016292638762u, 11042794154864902059u }, { 16039660251938410548u, 13803492693581127574u },
+  { 10826203278068237377u, 17254365866976409468u }, { 15989749085647424169u, 10783978666860255917u },
+  {  6152128301777116499u, 13479973333575319897u }, { 12301846395648783527u, 16849966666969149871u },
+  { 14606183024921571561u, 10531229166855718669u }, {  4422670725869800739u, 13164036458569648337u },
+  { 10140024425764638827u, 16455045573212060421u }, {  8643358275316593219u, 10284403483257537763u },
+  {  6192511825718353620u, 12855504354071922204u }, {  7740639782147942025u, 16069380442589902755u },
+  {  2532056854628769814u, 10043362776618689222u }, { 12388443105140738075u, 12554203470773361527u },
+  { 10873867862998534690u, 15692754338466701909u }, {  9102010423587778133u,  9807971461541688693u },
+  { 15989199047912110570u, 12259964326927110866u }, { 10763126773035362405u, 15324955408658888583u },
+  { 13644483260788183359u,  9578097130411805364u }, { 17055604075985229199u, 11972621413014756705u },
+  {  7484447039699372787u, 14965776766268445882u }, {  9289465418239495896u,  9353610478917778676u },
+  { 11611831772799369870u, 11692013098647223345u }, {   679731660717048625u, 14615016373309029182u },
+  { 10073036612751086589u, 18268770466636286477u }, {  8601490892183123070u, 11417981541647679048u },
+  { 10751863615228903838u, 14272476927059598810u }, {  4216457482181353989u, 17840596158824498513u },
+  { 14164500972431816003u, 11150372599265311570u }, {  8482254178684994196u, 13937965749081639463u },
+  {  5991131704928854841u, 17422457186352049329u }, { 15273672361649004036u, 10889035741470030830u },
+  {  9868718415206479237u, 13611294676837538538u }, {  3112525982153323238u, 17014118346046923173u },
+  {  4251171748059520976u, 10633823966279326983u }, {   702278666647013315u, 13292279957849158729u },
+  {  5489534351736154548u, 16615349947311448411u }, {  1125115960621402641u, 10384593717069655257u },
+  {  6018080969204141205u, 12980742146337069071u }, {  2910915193077788602u, 16225927682921336339u },
+  { 17960223060169475540u, 10141204801825835211u }, { 17838592806784456521u, 12676506002282294014u },
+  { 13074868971625794844u, 15845632502852867518u }, {  3560107088838733873u,  9903520314283042199u },
+  { 18285191916330581054u, 12379400392853802748u }, {  4409745821703674701u, 15474250491067253436u },
+  { 11979463175419572496u,  9671406556917033397u }, {  1139270913992301908u, 12089258196146291747u },
+  { 15259146697772541097u, 15111572745182864683u }, {  7231123676894144234u,  9444732965739290427u },
+  {  4427218577690292388u, 11805916207174113034u }, { 14757395258967641293u, 14757395258967641292u },
+  {                    1u,  9223372036854775808u }, {                    1u, 11529215046068469760u },
+  {                    1u, 14411518807585587200u }, {                    1u, 18014398509481984000u },
+  {                    1u, 11258999068426240000u }, {                    1u, 14073748835532800000u },
+  {                    1u, 17592186044416000000u }, {                    1u, 10995116277760000000u },
+  {                    1u, 13743895347200000000u }, {                    1u, 17179869184000000000u },
+  {                    1u, 10737418240000000000u }, {                    1u, 13421772800000000000u },
+  {                    1u, 16777216000000000000u }, {                    1u, 10485760000000000000u },
+  {                    1u, 13107200000000000000u }, {                    1u, 16384000000000000000u },
+  {                    1u, 10240000000000000000u }, {                    1u, 12800000000000000000u },
+  {                    1u, 16000000000000000000u }, {                    1u, 10000000000000000000u },
+  {                    1u, 12500000000000000000u }, {                    1u, 15625000000000000000u },
+  {                    1u,  9765625000000000000u }, {                    1u, 12207031250000000000u },
+  {                    1u, 15258789062500000000u }, {                    1u,  9536743164062500000u },
+  {                    1u, 11920928955078125000u }, {                    1u, 14901161193847656250u },
+  {  4611686018427387905u,  9313225746154785156u }, {  5764607523034234881u, 11641532182693481445u },
+  { 11817445422220181505u, 14551915228366851806u }, {  5548434740920451073u, 18189894035458564758u },
+  { 17302829768357445633u, 11368683772161602973u }, {  7793479155164643329u, 14210854715202003717u },
+  { 14353534962383192065u, 17763568394002504646u }, {  4359273333062107137u, 11102230246251565404u },
+  {  5449091666327633921u, 13877787807814456755u }, {  2199678564482154497u, 17347234759768070944u },
+  {  1374799102801346561u, 10842021724855044340u }, {  1718498878501683201u, 13552527156068805425u },
+  {  6759809616554491905u, 16940658945086006781u }, {  6530724019560251393u, 10587911840678754238u },
+  { 17386777061305090049u, 13234889800848442797u }, {  7898413271349198849u, 16543612251060553497u },
+  { 16465723340661719041u, 10339757656912845935u }, { 15970468157399760897u, 12924697071141057419u },
+  { 15351399178322313217u, 16155871338926321774u }, {  4982938468024057857u, 10097419586828951109u },
+  { 10840359103457460225u, 12621774483536188886u }, {  4327076842467049473u, 15777218104420236108u },
+  { 11927795063396681729u,  9860761315262647567u }, { 10298057810818464257u, 12325951644078309459u },
+  {  8260886245095692417u, 15407439555097886824u }, {  5163053903184807761u,  9629649721936179265u },
+  { 11065503397408397605u, 12037062152420224081u }, { 18443565265187884910u, 15046327690525280101u },
+  { 13833071299956122021u,  9403954806578300063u }, { 12679653106517764622u, 11754943508222875079u },
+  { 11237880364719817873u, 14693679385278593849u }, {   212292400617608629u, 18367099231598242312u },
+  {   132682750386005393u, 11479437019748901445u }, {  4777539456409894646u, 14349296274686126806u },
+  { 15195296357367144115u, 17936620343357658507u }, {  7191217214140771120u, 11210387714598536567u },
+  {  4377335499248575996u, 14012984643248170709u }, { 10083355392488107899u, 17516230804060213386u },
+  { 10913783138732455341u, 10947644252537633366u }, {  4418856886560793368u, 13684555315672041708u },
+  {  5523571108200991710u, 17105694144590052135u }, { 10369760970266701675u, 10691058840368782584u },
+  { 12962201212833377093u, 13363823550460978230u }, {  6979379479186945559u, 16704779438076222788u },
+  { 13585484211346616782u, 10440487148797639242u }, {  7758483227328495170u, 13050608935997049053u },
+  { 14309790052588006866u, 16313261169996311316u }, { 18166990819722280099u, 10195788231247694572u },
+  {  4261994450943298508u, 12744735289059618216u }, {  5327493063679123135u, 15930919111324522770u },
+  {  7941369183226839864u,  9956824444577826731u }, {  5315025460606161925u, 12446030555722283414u },
+  { 15867153862612478215u, 15557538194652854267u }, {  7611128154919104932u,  9723461371658033917u },
+  { 14125596212076269069u, 12154326714572542396u }, { 17656995265095336337u, 15192908393215677995u },
+  {  8729779031470891259u,  9495567745759798747u }, {  6300537770911226169u, 11869459682199748434u },
+  { 17099044250493808519u, 14836824602749685542u }, {  6075216638131242421u,  9273015376718553464u },
+  {  7594020797664053026u, 11591269220898191830u }, {   269153960225290474u, 14489086526122739788u },
+  {   336442450281613092u, 18111358157653424735u }, {  7127805559067090039u, 11319598848533390459u },
+  {  4298070930406474645u, 14149498560666738074u }, { 14595960699862869114u, 17686873200833422592u },
+  {  9122475437414293196u, 11054295750520889120u }, { 11403094296767866495u, 13817869688151111400u },
+  { 14253867870959833119u, 17272337110188889250u }, { 13520353437777283603u, 10795210693868055781u },
+  {  3065383741939440792u, 13494013367335069727u }, { 17666787732706464702u, 16867516709168837158u },
+  {  6430056314514152535u, 10542197943230523224u }, {  8037570393142690669u, 13177747429038154030u },
+  {   823590954573587528u, 16472184286297692538u }, {  5126430365035880109u, 10295115178936057836u },
+  {  6408037956294850136u, 12868893973670072295u }, {  3398361426941174766u, 16086117467087590369u },
+  { 13653190937906703989u, 10053823416929743980u }, { 17066488672383379986u, 12567279271162179975u },
+  { 16721424822051837078u, 15709099088952724969u }, {  3533361486141316318u,  9818186930595453106u },
+  { 13640073894531421206u, 12272733663244316382u }, {  7826720331309500699u, 15340917079055395478u },
+  {   280014188641050033u,  9588073174409622174u }, {  9573389772656088349u, 11985091468012027717u },
+  { 16578423234247498340u, 14981364335015034646u }, {  5749828502977298559u,  9363352709384396654u },
+  { 16410657665576399006u, 11704190886730495817u }, {  6678264026688335046u, 14630238608413119772u },
+  {  8347830033360418807u, 18287798260516399715u }, {  2911550761636567803u, 11429873912822749822u },
+  { 12862810488900485561u, 14287342391028437277u }, {  2243455055843443239u, 17859177988785546597u },
+  {  3708002419115845977u, 11161986242990966623u }, {    23317005467419567u, 13952482803738708279u },
+  { 13864204312116438171u, 17440603504673385348u }, { 17888499731927549665u, 10900377190420865842u },
+  { 13137252628054661273u, 13625471488026082303u }, { 11809879766640938687u, 17031839360032602879u },
+  { 14298703881791668536u, 10644899600020376799u }, { 13261693833812197765u, 13306124500025470999u },
+  { 11965431273837859302u, 16632655625031838749u }, {  9784237555362356016u, 10395409765644899218u },
+  {  3006924907348169212u, 12994262207056124023u }, { 17593714189467375227u, 16242827758820155028u },
+  {  1772699331562333709u, 10151767349262596893u }, {  6827560182880305040u, 12689709186578246116u },
+  {  8534450228600381300u, 15862136483222807645u }, {  7639874402088932265u,  9913835302014254778u },
+  {   326470965756389523u, 12392294127517818473u }, {  5019774725622874807u, 15490367659397273091u },
+  {   831516194300602803u,  9681479787123295682u }, { 10262767279730529311u, 12101849733904119602u },
+  {  3605087062808385831u, 15127312167380149503u }, {  9170708441896323001u,  9454570104612593439u },
+  {  6851699533943015847u, 11818212630765741799u }, {  3952938399001381904u, 14772765788457177249u },
+  { 13999801545444333450u,  9232978617785735780u }, { 17499751931805416813u, 11541223272232169725u },
+  {  8039631859474607304u, 14426529090290212157u }, { 14661225842770647034u, 18033161362862765196u },
+  { 18386638188586430204u, 11270725851789228247u }, { 18371611717305649851u, 14088407314736535309u },
+  {  9129456591349898602u, 17610509143420669137u }, { 17235125415662156386u, 11006568214637918210u },
+  { 12320534732722919675u, 13758210268297397763u }, { 10788982397476261689u, 17197762835371747204u },
+  { 15966486035277439364u, 10748601772107342002u }, { 10734735507242023397u, 13435752215134177503u },
+  {  8806733365625141342u, 16794690268917721879u }, { 12421737381156795195u, 10496681418073576174u },
+  {  6303799689591218186u, 13120851772591970218u }, { 17103121648843798540u, 16401064715739962772u },
+  {  1466078993672598280u, 10250665447337476733u }, {  6444284760518135753u, 12813331809171845916u },
+  {  8055355950647669692u, 16016664761464807395u }, {  2728754459941099605u, 10010415475915504622u },
+  { 12634315111781150315u, 12513019344894380777u }, {  1957835834444274181u, 15641274181117975972u },
+  { 10447019433382447171u,  9775796363198734982u }, {  3835402254873283156u, 12219745453998418728u },
+  {  4794252818591603945u, 15274681817498023410u }, {  7608094030047140370u,  9546676135936264631u },
+  {  4898431519131537558u, 11933345169920330789u }, { 10734725417341809852u, 14916681462400413486u },
+  {  2097517367411243254u,  9322925914000258429u }, {  7233582727691441971u, 11653657392500323036u },
+  {  9041978409614302463u, 14567071740625403795u }, {  6690786993590490175u, 18208839675781754744u },
+  {  4181741870994056360u, 11380524797363596715u }, {   615491320315182545u, 14225655996704495894u },
+  {  9992736187248753990u, 17782069995880619867u }, {  3939617107816777292u, 11113793747425387417u },
+  {  9536207403198359518u, 13892242184281734271u }, {  7308573235570561494u, 17365302730352167839u },
+  { 11485387299872682790u, 10853314206470104899u }, {  9745048106413465583u, 13566642758087631124u },
+  { 12181310133016831979u, 16958303447609538905u }, {   695789805494438131u, 10598939654755961816u },
+  {   869737256868047664u, 13248674568444952270u }, { 10310543607939835387u, 16560843210556190337u },
+  { 17973304801030866877u, 10350527006597618960u }, {  4019886927579031981u, 12938158758247023701u },
+  {  9636544677901177880u, 16172698447808779626u }, { 10634526442115624079u, 10107936529880487266u },
+  {  4069786015789754291u, 12634920662350609083u }, {   475546501309804959u, 15793650827938261354u },
+  {  4908902581746016004u,  9871031767461413346u }, { 15359500264037295812u, 12338789709326766682u },
+  {  9976003293191843957u, 15423487136658458353u }, { 17764217104313372234u,  9639679460411536470u },
+  { 12981899343536939484u, 12049599325514420588u }, { 16227374179421174355u, 15061999156893025735u },
+  { 17059637889779315828u,  9413749473058141084u }, {  2877803288514593169u, 11767186841322676356u },
+  {  3597254110643241461u, 14708983551653345445u }, {  9108253656731439730u, 18386229439566681806u },
+  {  1080972517029761927u, 11491393399729176129u }, {  5962901664714590313u, 14364241749661470161u },
+  { 12065313099320625795u, 17955302187076837701u }, {  9846663696289085074u, 11222063866923023563u },
+  {  7696643601933968438u, 14027579833653779454u }, {   397432465562684740u, 17534474792067224318u },
+  { 14083453346258841675u, 10959046745042015198u }, {  8380944645968776285u, 13698808431302518998u },
+  {  1252808770606194548u, 17123510539128148748u }, { 10006377518483647401u, 10702194086955092967u },
+  {  7896285879677171347u, 13377742608693866209u }, { 14482043368023852088u, 16722178260867332761u },
+  {  2133748077373825699u, 10451361413042082976u }, {  2667185096717282124u, 13064201766302603720u },
+  {  3333981370896602654u, 16330252207878254650u }, {  6695424375237764563u, 10206407629923909156u },
+  {  8369280469047205704u, 12758009537404886445u }, { 15073286604736395034u, 15947511921756108056u },
+  {  9420804127960246896u,  9967194951097567535u }, {  7164319141522920716u, 12458993688871959419u },
+  {  4343712908476262991u, 15573742111089949274u }, {  7326506586225052274u,  9733588819431218296u },
+  {  9158133232781315342u, 12166986024289022870u }, {  2224294504121868369u, 15208732530361278588u },
+  { 10613556101930943539u,  9505457831475799117u }, { 17878631145841067328u, 11881822289344748896u },
+  {  3901544858591782543u, 14852277861680936121u }, { 13967680582688333850u,  9282673663550585075u },
+  { 12847914709933029408u, 11603342079438231344u }, { 16059893387416286760u, 14504177599297789180u },
+  {  1628122660560806834u, 18130221999122236476u }, { 10240948699705280079u, 11331388749451397797u },
+  { 17412871893058988003u, 14164235936814247246u }, { 12542717829468959196u, 17705294921017809058u },
+  { 12450884661845487402u, 11065809325636130661u }, {  1728547772024695540u, 13832261657045163327u },
+  { 15995742770313033137u, 17290327071306454158u }, {  5385653213018257807u, 10806454419566533849u },
+  { 11343752534700210162u, 13508068024458167311u }, {  9568004649947874798u, 16885085030572709139u },
+  {  3674159897003727797u, 10553178144107943212u }, {  4592699871254659746u, 13191472680134929015u },
+  {  1129188820640936779u, 16489340850168661269u }, {  3011586022114279439u, 10305838031355413293u },
+  {  8376168546070237203u, 12882297539194266616u }, { 10470210682587796503u, 16102871923992833270u },
+  {  1932195658189984911u, 10064294952495520794u }, { 11638616609592256946u, 12580368690619400992u },
+  { 14548270761990321183u, 15725460863274251240u }, {  9092669226243950739u,  9828413039546407025u },
+  { 15977522551232326328u, 12285516299433008781u }, {  6136845133758244198u, 15356895374291260977u },
+  { 15364743254667372384u,  9598059608932038110u }, {  9982557031479439672u, 11997574511165047638u },
+  {  3254824252494523782u, 14996968138956309548u }, { 11257637194663853172u,  9373105086847693467u },
+  {  9460360474902428560u, 11716381358559616834u }, {  2602078556773259892u, 14645476698199521043u },
+  { 17087656251248738577u, 18306845872749401303u }, { 17597314184671543467u, 11441778670468375814u },
+  { 12773270693984653526u, 14302223338085469768u }, { 15966588367480816907u, 17877779172606837210u },
+  { 14590803748102898471u, 11173611982879273256u }, { 18238504685128623089u, 13967014978599091570u },
+  { 13574758819556003053u, 17458768723248864463u }, { 15401753289863583764u, 10911730452030540289u },
+  {  5417133557047315993u, 13639663065038175362u }, { 15994788983163920799u, 17049578831297719202u },
+  { 14608429132904838404u, 10655986769561074501u }, {  4425478360848884292u, 13319983461951343127u },
+  {   920161932633717461u, 16649979327439178909u }, {  2880944217109767366u, 10406237079649486818u },
+  { 12824552308241985015u, 13007796349561858522u }, {  6807318348447705460u, 16259745436952323153u },
+  { 15783789013848285673u, 10162340898095201970u }, { 10506364230455581283u, 12702926122619002463u },
+  {  8521269269642088700u, 15878657653273753079u }, { 12243322321167387294u,  9924161033296095674u },
+  {  6080780864604458309u, 12405201291620119593u }, { 12212662099182960790u, 15506501614525149491u },
+  {  5327070802775656542u,  9691563509078218432u }, {  6658838503469570677u, 12114454386347773040u },
+  {  8323548129336963346u, 15143067982934716300u }, { 14425589617690377900u,  9464417489334197687u },
+  { 13420301003685584470u, 11830521861667747109u }, {  2940318199324816876u, 14788152327084683887u },
+  {  8755227902219092404u,  9242595204427927429u }, { 15555720896201253408u, 11553244005534909286u },
+  { 10221279083396790952u, 14441555006918636608u }, { 12776598854245988690u, 18051943758648295760u },
+  {  7985374283903742932u, 11282464849155184850u }, {   758345818024902857u, 14103081061443981063u },
+  { 14782990327813292283u, 17628851326804976328u }, {  9239368954883307677u, 11018032079253110205u },
+  { 16160897212031522500u, 13772540099066387756u }, {  1754377441329851509u, 17215675123832984696u },
+  {  1096485900831157193u, 10759796952395615435u }, { 15205665431321110203u, 13449746190494519293u },
+  {  5172023733869224042u, 16812182738118149117u }, {  5538357842881958978u, 10507614211323843198u },
+  { 16146319340457224531u, 13134517764154803997u }, {  6347841120289366951u, 16418147205193504997u },
+  {  6273243709394548297u, 10261342003245940623u }, {  3229868618315797467u, 12826677504057425779u },
+  { 17872393828176910546u, 16033346880071782223u }, { 18087775170251650947u, 10020841800044863889u },
+  {  8774660907532399972u, 12526052250056079862u }, {  1744954097560724157u, 15657565312570099828u },
+  { 10313968347830228406u,  9785978320356312392u }, { 12892460434787785507u, 12232472900445390490u },
+  {  6892203506629956076u, 15290591125556738113u }, { 15836842237712192308u,  9556619453472961320u },
+  {  1349308723430688769u, 11945774316841201651u }, { 15521693959570524673u, 14932217896051502063u },
+  { 16618587752372659777u,  9332636185032188789u }, {  6938176635183661009u, 11665795231290235987u },
+  {  4061034775552188357u, 14582244039112794984u }, {  5076293469440235446u, 18227805048890993730u },
+  {  7784369436827535058u, 11392378155556871081u }
+};
+
+#endif // RYU_D2S_SCHUBFACH_TABLE_H
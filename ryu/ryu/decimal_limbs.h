@@ -0,0 +1,102 @@
+// Decimal digits of exact binary values, shared by the float and the 128 bit
+// %f/%e conversions. Values are little endian arrays of base 10^9 limbs.
+#ifndef RYU_DECIMAL_LIMBS_H
+#define RYU_DECIMAL_LIMBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ryu/common.h"
+#include "ryu/digit_table.h"
+
+// limbs is little endian base 10^9, any 32 bit factor keeps the products
+// within 64 bits
+static inline uint32_t mul_limbs(uint32_t* const limbs, uint32_t count, const uint32_t factor) {
+  uint64_t carry = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint64_t v = (uint64_t) limbs[i] * factor + carry;
+    carry = v / 1000000000;
+    limbs[i] = (uint32_t) (v - carry * 1000000000);
+  }
+  while (carry != 0) {
+    const uint64_t q = carry / 1000000000;
+    limbs[count++] = (uint32_t) (carry - q * 1000000000);
+    carry = q;
+  }
+  return count;
+}
+
+// writes exactly length digits of v
+static inline void write_digits(uint32_t v, uint32_t length, char* const result) {
+  while (length >= 2) {
+    const uint32_t c = v % 100;
+    v /= 100;
+    length -= 2;
+    memcpy(result + length, DIGIT_TABLE + 2 * c, 2);
+  }
+  if (length) {
+    result[0] = (char) ('0' + v);
+  }
+}
+
+static inline uint32_t limbs_length(const uint32_t* const limbs, const uint32_t count) {
+  return 9 * (count - 1) + decimalLength9(limbs[count - 1]);
+}
+
+// Writes the first want digits of the limbs (all of them if there are fewer)
+// and returns how many were written. sticky tells whether any of the digits
+// left out is non-zero.
+static inline uint32_t limbs_digits(const uint32_t* const limbs, const uint32_t count, const uint32_t want,
+  char* const digits, bool* const sticky) {
+  const uint32_t top = limbs[count - 1];
+  uint32_t index = decimalLength9(top);
+  write_digits(top, index, digits);
+  int32_t i = (int32_t) count - 2;
+  for (; i >= 0 && index < want; --i) {
+    write_digits(limbs[i], 9, digits + index);
+    index += 9;
+  }
+  bool rest = false;
+  for (uint32_t j = want; j < index; ++j) {
+    rest |= digits[j] != '0';
+  }
+  for (; i >= 0 && !rest; --i) {
+    rest = limbs[i] != 0;
+  }
+  *sticky = rest;
+  return index < want ? index : want;
+}
+
+// Rounds count digits to the first keep of them, ties to even. sticky says
+// there are non-zero digits after the count. Returns true when the carry ran
+// out of the first digit, the kept digits are all 0 then and a leading 1 is
+// missing.
+static inline bool round_digits(char* const digits, const uint32_t count, const uint32_t keep, const bool sticky) {
+  if (keep >= count) {
+    return false;
+  }
+  bool roundUp = digits[keep] > '5';
+  if (digits[keep] == '5') {
+    roundUp = sticky;
+    for (uint32_t i = keep + 1; i < count && !roundUp; ++i) {
+      roundUp = digits[i] != '0';
+    }
+    if (!roundUp) {
+      roundUp = keep > 0 && ((digits[keep - 1] - '0') & 1);
+    }
+  }
+  if (!roundUp) {
+    return false;
+  }
+  for (int32_t i = (int32_t) keep - 1; i >= 0; --i) {
+    if (digits[i] != '9') {
+      ++digits[i];
+      return false;
+    }
+    digits[i] = '0';
+  }
+  return true;
+}
+
+#endif // RYU_DECIMAL_LIMBS_H
@@ -0,0 +1,380 @@
+// Fixed (%f) and scientific (%e) output for binary32 values, the float
+// counterparts of d2fixed_buffered_n and d2exp_buffered_n.
+//
+// A float is m * 2^e with m < 2^24 and -149 <= e <= 104. For negative e it
+// equals m * 5^-e / 10^-e, for positive e it is the integer m * 2^e, so the
+// whole decimal expansion is finite and at most 112 digits long. That is
+// small enough to hold exactly in a little base 10^9 bigint, built from a
+// table of twelve powers of 5^13, and round on its decimal digits without
+// any of the double precision tables. %e with up to 8 digits after the point
+// usually doesn't even need that, see float_exp_scaled. The output is
+// identical to d2fixed/d2exp on the widened double.
+
+#include "ryu/ryu2.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(RYU_ONLY_64_BIT_OPS) && !defined(RYU_AVOID_UINT128) && defined(__SIZEOF_INT128__)
+#define HAS_UINT128
+typedef __uint128_t uint128_t;
+#endif
+
+#include "ryu/common.h"
+#include "ryu/decimal_limbs.h"
+#include "ryu/digit_table.h"
+
+#define FLOAT_MANTISSA_BITS 23
+#define FLOAT_EXPONENT_BITS 8
+#define FLOAT_BIAS 127
+
+// 2^24 * 5^149 < 10^112, 13 limbs of nine digits
+#define FLOAT_LIMBS 13
+#define FLOAT_DIGITS (9 * FLOAT_LIMBS)
+
+static const uint32_t POW5_32[13] = {
+  1u, 5u, 25u, 125u, 625u, 3125u, 15625u, 78125u, 390625u, 1953125u,
+  9765625u, 48828125u, 244140625u
+};
+
+// 5^(13 * q) for q <= 11 in little endian base 10^9, entry q has q + 1 limbs
+// and starts at q * (q + 1) / 2
+static const uint32_t POW5_13_LIMBS[78] = {
+  1u,
+  220703125u, 1u,
+  384765625u, 490116119u, 1u,
+  830078125u, 545856475u, 818989403u, 1u,
+  181640625u, 847263336u, 250313080u, 220446049u, 2u,
+  564453125u, 174854278u, 18632002u, 213761085u, 710505431u, 2u,
+  603515625u, 263248443u, 279851414u, 485634768u, 212110699u, 308722450u, 3u,
+  423828125u, 758197784u, 926816947u, 247865495u, 708050254u, 731580443u, 38967834u, 4u,
+  650390625u, 814243316u, 431393779u, 457540219u, 17413935u, 823303533u, 631323783u, 930380657u, 4u,
+  408203125u, 145496368u, 124808736u, 673088110u, 431567650u, 577897870u, 799931070u, 210112040u, 18531076u, 6u,
+  322265625u, 592044830u, 240107871u, 429698164u, 825547009u, 366659729u, 639035486u, 804603357u, 639296924u, 346839692u, 7u,
+  517578125u, 514484405u, 189507849u, 894662929u, 245237016u, 9700939u, 193676428u, 55463240u, 911869333u, 678829253u, 968310171u, 8u
+};
+
+// m * 2^e (0 < m < 2^24) as base 10^9 limbs, returns the limb count. The
+// value is the limbs times 10^-scale.
+static uint32_t float_limbs(const uint32_t m, const int32_t e, uint32_t* const limbs, int32_t* const scale) {
+  uint32_t count;
+  if (e >= 0) {
+    limbs[0] = m;
+    count = 1;
+    int32_t s = e;
+    for (; s >= 29; s -= 29) {
+      count = mul_limbs(limbs, count, 1u << 29);
+    }
+    if (s > 0) {
+      count = mul_limbs(limbs, count, 1u << s);
+    }
+    *scale = 0;
+  } else {
+    const uint32_t q = (uint32_t) -e / 13;
+    const uint32_t r = (uint32_t) -e % 13;
+    count = q + 1;
+    memcpy(limbs, POW5_13_LIMBS + q * (q + 1) / 2, count * sizeof(uint32_t));
+    if (r > 0) {
+      count = mul_limbs(limbs, count, POW5_32[r]);
+    }
+    count = mul_limbs(limbs, count, m);
+    *scale = -e;
+  }
+  return count;
+}
+
+#if defined(HAS_UINT128)
+// 5^k below 2^64
+static const uint64_t POW5_64[28] = {
+  1u, 5u, 25u, 125u, 625u, 3125u, 15625u, 78125u, 390625u, 1953125u,
+  9765625u, 48828125u, 244140625u, 1220703125u, 6103515625u, 30517578125u,
+  152587890625u, 762939453125u, 3814697265625u, 19073486328125u,
+  95367431640625u, 476837158203125u, 2384185791015625u, 11920928955078125u,
+  59604644775390625u, 298023223876953125u, 1490116119384765625u,
+  7450580596923828125u
+};
+
+// The largest precision float_exp_scaled takes, its digits fit 32 bits
+#define FLOAT_EXP_SCALED_PRECISION 8
+
+// How the rest after a division compares to half of the divisor
+enum { REST_ZERO, REST_BELOW_HALF, REST_HALF, REST_ABOVE_HALF };
+
+// floor(m * 2^e * 10^k) into q and the class of the rest. Only for 5^|k|
+// below 2^64, false otherwise.
+static inline bool float_scale(const uint32_t m, const int32_t e, const int32_t k, uint64_t* const q, int* const rest) {
+  uint128_t quotient;
+  uint128_t rest2;
+  uint128_t unit;
+  if (k >= 0) {
+    if (k > 27) {
+      return false;
+    }
+    const uint128_t p = (uint128_t) m * POW5_64[k];
+    const int32_t s = e + k;
+    if (s >= 0) {
+      *q = (uint64_t) (p << s);
+      *rest = REST_ZERO;
+      return true;
+    }
+    if (s <= -128) {
+      return false;
+    }
+    quotient = p >> -s;
+    rest2 = (p & (((uint128_t) 1 << -s) - 1)) << 1;
+    unit = (uint128_t) 1 << -s;
+  } else {
+    if (k < -27) {
+      return false;
+    }
+    // m * 2^e / (5^j * 2^j)
+    const int32_t s = e + k;
+    const uint128_t num = s >= 0 ? (uint128_t) m << s : m;
+    unit = s >= 0 ? (uint128_t) POW5_64[-k] : (uint128_t) POW5_64[-k] << -s;
+    quotient = num / unit;
+    rest2 = (num - quotient * unit) << 1;
+  }
+  *q = (uint64_t) quotient;
+  *rest = rest2 == 0 ? REST_ZERO : rest2 < unit ? REST_BELOW_HALF : rest2 == unit ? REST_HALF : REST_ABOVE_HALF;
+  return true;
+}
+
+// %e digits of m * 2^e with plain 128 bit arithmetic. The decimal exponent
+// comes from the bit length and is either right or one too small, in which
+// case the extra digit is folded into the rest.
+static bool float_exp_scaled(const uint32_t m, const int32_t e, const uint32_t precision, uint32_t* const digits, int32_t* const exponent) {
+  const int32_t t = e + 31 - (int32_t) __builtin_clz(m);
+  int32_t x = t >= 0 ? (int32_t) log10Pow2(t) : -(int32_t) log10Pow2(-t) - 1;
+  uint64_t q;
+  int rest;
+  if (!float_scale(m, e, (int32_t) precision - x, &q, &rest)) {
+    return false;
+  }
+  // 10^(precision + 1)
+  const uint64_t limit = POW5_64[precision + 1] << (precision + 1);
+  if (q >= limit) {
+    const uint32_t last = (uint32_t) (q % 10);
+    q /= 10;
+    ++x;
+    if (last > 5 || (last == 5 && rest != REST_ZERO)) {
+      rest = REST_ABOVE_HALF;
+    } else if (last == 5) {
+      rest = REST_HALF;
+    } else if (last > 0 || rest != REST_ZERO) {
+      rest = REST_BELOW_HALF;
+    }
+  }
+  if (rest == REST_ABOVE_HALF || (rest == REST_HALF && (q & 1))) {
+    if (++q == limit) {
+      q /= 10;
+      ++x;
+    }
+  }
+  *digits = (uint32_t) q;
+  *exponent = x;
+  return true;
+}
+#endif // HAS_UINT128
+
+// The first precision + 1 digits of m * 2^e for %e, returns how many of
+// them there are, fewer means the rest are zeros
+static uint32_t float_exp_digits(const uint32_t m, const int32_t e, const uint32_t precision, char* const digits, int32_t* const exponent) {
+#if defined(HAS_UINT128)
+  uint32_t scaled;
+  if (precision <= FLOAT_EXP_SCALED_PRECISION && float_exp_scaled(m, e, precision, &scaled, exponent)) {
+    write_digits(scaled, precision + 1, digits);
+    return precision + 1;
+  }
+#endif
+  uint32_t limbs[FLOAT_LIMBS];
+  int32_t scale;
+  const uint32_t limbCount = float_limbs(m, e, limbs, &scale);
+  *exponent = (int32_t) limbs_length(limbs, limbCount) - 1 - scale;
+  bool sticky;
+  const uint32_t count = limbs_digits(limbs, limbCount, precision + 2, digits, &sticky);
+  if (precision + 1 >= count) {
+    return count;
+  }
+  if (round_digits(digits, count, precision + 1, sticky)) {
+    // 9.99 became 10.0
+    digits[0] = '1';
+    ++*exponent;
+  }
+  return precision + 1;
+}
+
+static inline int copy_special_str_printf_32(char* const result, const bool sign, const uint32_t mantissa) {
+#if defined(_MSC_VER)
+  if (sign) {
+    result[0] = '-';
+  }
+  if (mantissa) {
+    if (mantissa < (1u << (FLOAT_MANTISSA_BITS - 1))) {
+      memcpy(result + sign, "nan(snan)", 9);
+      return sign + 9;
+    }
+    memcpy(result + sign, "nan", 3);
+    return sign + 3;
+  }
+#else
+  if (mantissa) {
+    memcpy(result, "nan", 3);
+    return 3;
+  }
+  if (sign) {
+    result[0] = '-';
+  }
+#endif
+  memcpy(result + sign, "Infinity", 8);
+  return sign + 8;
+}
+
+int f2fixed_buffered_n(float f, uint32_t precision, char* result) {
+  const uint32_t bits = float_to_bits(f);
+  const bool ieeeSign = ((bits >> (FLOAT_MANTISSA_BITS + FLOAT_EXPONENT_BITS)) & 1) != 0;
+  const uint32_t ieeeMantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+  const uint32_t ieeeExponent = (bits >> FLOAT_MANTISSA_BITS) & ((1u << FLOAT_EXPONENT_BITS) - 1);
+
+  if (ieeeExponent == ((1u << FLOAT_EXPONENT_BITS) - 1u)) {
+    return copy_special_str_printf_32(result, ieeeSign, ieeeMantissa);
+  }
+
+  int index = 0;
+  if (ieeeSign) {
+    result[index++] = '-';
+  }
+
+  // one extra digit for a carry out of the top
+  char digits[FLOAT_DIGITS + 1];
+  int32_t count = 0;
+  int32_t intLength = 0;
+  if (ieeeExponent != 0 || ieeeMantissa != 0) {
+    const uint32_t m2 = ieeeExponent == 0 ? ieeeMantissa : ieeeMantissa | (1u << FLOAT_MANTISSA_BITS);
+    const int32_t e2 = (ieeeExponent == 0 ? 1 : (int32_t) ieeeExponent) - FLOAT_BIAS - FLOAT_MANTISSA_BITS;
+    uint32_t limbs[FLOAT_LIMBS];
+    int32_t scale;
+    const uint32_t limbCount = float_limbs(m2, e2, limbs, &scale);
+    const int32_t length = (int32_t) limbs_length(limbs, limbCount);
+    intLength = length - scale;
+    // keep the digits down to 10^-precision, below half a unit of that
+    // everything rounds to 0
+    const int32_t keep = scale > (int32_t) precision ? intLength + (int32_t) precision : length;
+    if (keep < 0) {
+      intLength = 0;
+    } else {
+      bool sticky;
+      count = (int32_t) limbs_digits(limbs, limbCount, (uint32_t) keep + 1, digits + 1, &sticky);
+      if (round_digits(digits + 1, (uint32_t) count, (uint32_t) keep, sticky)) {
+        digits[0] = '1';
+        count = keep + 1;
+        ++intLength;
+        memmove(digits + 1, digits, (size_t) count);
+      } else if (count > keep) {
+        count = keep;
+      }
+    }
+  }
+  const char* const d = digits + 1;
+
+  if (intLength > 0) {
+    memcpy(result + index, d, (size_t) intLength);
+    index += intLength;
+  } else {
+    result[index++] = '0';
+  }
+  if (precision > 0) {
+    result[index++] = '.';
+    int32_t written = 0;
+    if (intLength < 0) {
+      const int32_t zeros = -intLength < (int32_t) precision ? -intLength : (int32_t) precision;
+      memset(result + index, '0', (size_t) zeros);
+      index += zeros;
+      written = zeros;
+    }
+    const int32_t from = intLength > 0 ? intLength : 0;
+    if (count > from) {
+      memcpy(result + index, d + from, (size_t) (count - from));
+      index += count - from;
+      written += count - from;
+    }
+    memset(result + index, '0', precision - (uint32_t) written);
+    index += (int) precision - written;
+  }
+  return index;
+}
+
+void f2fixed_buffered(float f, uint32_t precision, char* result) {
+  const int len = f2fixed_buffered_n(f, precision, result);
+  result[len] = '\0';
+}
+
+char* f2fixed(float f, uint32_t precision) {
+  // sign, 39 integer digits, point and terminator
+  char* const buffer = (char*)malloc(precision + 48);
+  const int index = f2fixed_buffered_n(f, precision, buffer);
+  buffer[index] = '\0';
+  return buffer;
+}
+
+int f2exp_buffered_n(float f, uint32_t precision, char* result) {
+  const uint32_t bits = float_to_bits(f);
+  const bool ieeeSign = ((bits >> (FLOAT_MANTISSA_BITS + FLOAT_EXPONENT_BITS)) & 1) != 0;
+  const uint32_t ieeeMantissa = bits & ((1u << FLOAT_MANTISSA_BITS) - 1);
+  const uint32_t ieeeExponent = (bits >> FLOAT_MANTISSA_BITS) & ((1u << FLOAT_EXPONENT_BITS) - 1);
+
+  if (ieeeExponent == ((1u << FLOAT_EXPONENT_BITS) - 1u)) {
+    return copy_special_str_printf_32(result, ieeeSign, ieeeMantissa);
+  }
+
+  int index = 0;
+  if (ieeeSign) {
+    result[index++] = '-';
+  }
+
+  char digits[FLOAT_DIGITS];
+  int32_t count = 1;
+  int32_t exp = 0;
+  if (ieeeExponent == 0 && ieeeMantissa == 0) {
+    digits[0] = '0';
+  } else {
+    const uint32_t m2 = ieeeExponent == 0 ? ieeeMantissa : ieeeMantissa | (1u << FLOAT_MANTISSA_BITS);
+    const int32_t e2 = (ieeeExponent == 0 ? 1 : (int32_t) ieeeExponent) - FLOAT_BIAS - FLOAT_MANTISSA_BITS;
+    count = (int32_t) float_exp_digits(m2, e2, precision, digits, &exp);
+  }
+
+  result[index++] = digits[0];
+  if (precision > 0) {
+    result[index++] = '.';
+    memcpy(result + index, digits + 1, (size_t) (count - 1));
+    index += count - 1;
+    memset(result + index, '0', precision + 1 - (uint32_t) count);
+    index += (int) precision + 1 - count;
+  }
+
+  result[index++] = 'e';
+  if (exp < 0) {
+    result[index++] = '-';
+    exp = -exp;
+  } else {
+    result[index++] = '+';
+  }
+  // floats stay within 1e-45 and 1e38, two exponent digits always do
+  memcpy(result + index, DIGIT_TABLE + 2 * exp, 2);
+  index += 2;
+  return index;
+}
+
+void f2exp_buffered(float f, uint32_t precision, char* result) {
+  const int len = f2exp_buffered_n(f, precision, result);
+  result[len] = '\0';
+}
+
+char* f2exp(float f, uint32_t precision) {
+  // sign, first digit, point, e-45 and terminator
+  char* const buffer = (char*)malloc(precision + 16);
+  const int index = f2exp_buffered_n(f, precision, buffer);
+  buffer[index] = '\0';
+  return buffer;
+}
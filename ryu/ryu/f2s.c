@@ -17,6 +17,10 @@
 
 // Runtime compiler options:
 // -DRYU_DEBUG Generate verbose debugging output to stdout.
+//
+// -DRYU_SCHUBFACH Use the Schubfach engine for f2s_buffered_n instead of
+//     Ryu's, see f2d_schubfach. Both are always available as
+//     f2s_ryu_buffered_n and f2s_schubfach_buffered_n.
 
 #include "ryu/ryu.h"
 
@@ -66,6 +70,32 @@ static const uint64_t FLOAT_POW5_SPLIT[47] = {
   1292469707114105741u, 1615587133892632177u, 2019483917365790221u
 };
 
+// The Schubfach multipliers: entry k - FLOAT_POW10_MIN is
+// floor(10^k * 2^(63 - floor(log_2(10^k)))) + 1, for -31 <= k <= 45.
+#define FLOAT_POW10_MIN -31
+static const uint64_t FLOAT_POW10_SIGNIFICANDS[77] = {
+  9353610478917778677u, 11692013098647223346u, 14615016373309029183u, 18268770466636286478u,
+  11417981541647679049u, 14272476927059598811u, 17840596158824498514u, 11150372599265311571u,
+  13937965749081639464u, 17422457186352049330u, 10889035741470030831u, 13611294676837538539u,
+  17014118346046923174u, 10633823966279326984u, 13292279957849158730u, 16615349947311448412u,
+  10384593717069655258u, 12980742146337069072u, 16225927682921336340u, 10141204801825835212u,
+  12676506002282294015u, 15845632502852867519u, 9903520314283042200u, 12379400392853802749u,
+  15474250491067253437u, 9671406556917033398u, 12089258196146291748u, 15111572745182864684u,
+  9444732965739290428u, 11805916207174113035u, 14757395258967641293u, 9223372036854775809u,
+  11529215046068469761u, 14411518807585587201u, 18014398509481984001u, 11258999068426240001u,
+  14073748835532800001u, 17592186044416000001u, 10995116277760000001u, 13743895347200000001u,
+  17179869184000000001u, 10737418240000000001u, 13421772800000000001u, 16777216000000000001u,
+  10485760000000000001u, 13107200000000000001u, 16384000000000000001u, 10240000000000000001u,
+  12800000000000000001u, 16000000000000000001u, 10000000000000000001u, 12500000000000000001u,
+  15625000000000000001u, 9765625000000000001u, 12207031250000000001u, 15258789062500000001u,
+  9536743164062500001u, 11920928955078125001u, 14901161193847656251u, 9313225746154785157u,
+  11641532182693481446u, 14551915228366851807u, 18189894035458564759u, 11368683772161602974u,
+  14210854715202003718u, 17763568394002504647u, 11102230246251565405u, 13877787807814456756u,
+  17347234759768070945u, 10842021724855044341u, 13552527156068805426u, 16940658945086006782u,
+  10587911840678754239u, 13234889800848442798u, 16543612251060553498u, 10339757656912845936u,
+  12924697071141057420u
+};
+
 static inline uint32_t pow5Factor(uint32_t value) {
   uint32_t count = 0;
   for (;;) {
@@ -318,6 +348,90 @@ static inline floating_decimal_32 f2d(const uint32_t ieeeMantissa, const uint32_
   return fd;
 }
 
+// Returns the top 32 bits of the 64x32-bit product of cp and the Schubfach
+// multiplier g, rounded to odd. cp has at most 30 significant bits.
+#if defined(__SIZEOF_INT128__) && !defined(_MSC_VER) && !defined(RYU_ONLY_64_BIT_OPS)
+static inline uint32_t roundToOdd(const uint64_t g, const uint32_t cp) {
+  const __uint128_t p = ((__uint128_t) g) * cp;
+  const uint32_t y1 = (uint32_t) (p >> 64);
+  const uint32_t y0 = (uint32_t) (((uint64_t) p) >> 32);
+  return y1 | (y0 > 1);
+}
+#else
+static inline uint32_t roundToOdd(const uint64_t g, const uint32_t cp) {
+  const uint64_t lo = (g & 0xffffffffu) * cp;
+  const uint64_t hi = (g >> 32) * cp + (lo >> 32);
+  const uint32_t y1 = (uint32_t) (hi >> 32);
+  const uint32_t y0 = (uint32_t) hi;
+  return y1 | (y0 > 1);
+}
+#endif
+
+// The binary32 counterpart of d2d_schubfach in d2s.c.
+static inline floating_decimal_32 f2d_schubfach(const uint32_t ieeeMantissa, const uint32_t ieeeExponent) {
+  int32_t e2;
+  uint32_t m2;
+  if (ieeeExponent == 0) {
+    e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS;
+    m2 = ieeeMantissa;
+  } else {
+    e2 = (int32_t) ieeeExponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS;
+    m2 = (1u << FLOAT_MANTISSA_BITS) | ieeeMantissa;
+  }
+  const bool acceptBounds = (m2 & 1) == 0;
+
+  const uint32_t mv = 4 * m2;
+  const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+  const uint32_t mp = 4 * m2 + 2;
+  const uint32_t mm = 4 * m2 - 1 - mmShift;
+
+  const int32_t k = floorLog10Pow2(e2, mmShift == 0);
+  const int32_t h = e2 + floorLog2Pow10(-k) + 1;
+  const uint64_t g = FLOAT_POW10_SIGNIFICANDS[-k - FLOAT_POW10_MIN];
+  const uint32_t vr = roundToOdd(g, mv << h);
+  const uint32_t vp = roundToOdd(g, mp << h) - !acceptBounds;
+  const uint32_t vm = roundToOdd(g, mm << h) + !acceptBounds;
+
+  floating_decimal_32 fd;
+  const uint32_t s = vr >> 2;
+  const uint32_t sp = s / 10;
+  const bool upInside = vm <= 40 * sp;
+  const bool wpInside = 40 * sp + 40 <= vp;
+  if (s >= 10 && upInside != wpInside) {
+    fd.mantissa = sp + wpInside;
+    fd.exponent = k + 1;
+  } else {
+    const bool uInside = vm <= 4 * s;
+    const bool wInside = 4 * s + 4 <= vp;
+    if (uInside != wInside) {
+      fd.mantissa = s + wInside;
+    } else {
+      const uint32_t mid = 4 * s + 2;
+      fd.mantissa = s + (vr > mid || (vr == mid && (s & 1) != 0));
+    }
+    fd.exponent = k;
+  }
+
+  // Trailing zeros, as in d2d_schubfach.
+  if (fd.mantissa % 10 == 0) {
+    fd.mantissa /= 10;
+    ++fd.exponent;
+    while (fd.mantissa % 10000 == 0) {
+      fd.mantissa /= 10000;
+      fd.exponent += 4;
+    }
+    if (fd.mantissa % 100 == 0) {
+      fd.mantissa /= 100;
+      fd.exponent += 2;
+    }
+    if (fd.mantissa % 10 == 0) {
+      fd.mantissa /= 10;
+      ++fd.exponent;
+    }
+  }
+  return fd;
+}
+
 static inline int to_chars(const floating_decimal_32 v, const bool sign, char* const result) {
   // Step 5: Print the decimal representation.
   int index = 0;
@@ -396,7 +510,7 @@ static inline int to_chars(const floating_decimal_32 v, const bool sign, char* c
   return index;
 }
 
-int f2s_buffered_n(float f, char* result) {
+static inline int f2s_engine_buffered_n(float f, char* result, const bool schubfach) {
   // Step 1: Decode the floating-point number, and unify normalized and subnormal cases.
   const uint32_t bits = float_to_bits(f);
 
@@ -418,10 +532,26 @@ int f2s_buffered_n(float f, char* result) {
     return copy_special_str(result, ieeeSign, ieeeExponent, ieeeMantissa);
   }
 
-  const floating_decimal_32 v = f2d(ieeeMantissa, ieeeExponent);
+  const floating_decimal_32 v = schubfach ? f2d_schubfach(ieeeMantissa, ieeeExponent) : f2d(ieeeMantissa, ieeeExponent);
   return to_chars(v, ieeeSign, result);
 }
 
+int f2s_ryu_buffered_n(float f, char* result) {
+  return f2s_engine_buffered_n(f, result, false);
+}
+
+int f2s_schubfach_buffered_n(float f, char* result) {
+  return f2s_engine_buffered_n(f, result, true);
+}
+
+int f2s_buffered_n(float f, char* result) {
+#if defined(RYU_SCHUBFACH)
+  return f2s_engine_buffered_n(f, result, true);
+#else
+  return f2s_engine_buffered_n(f, result, false);
+#endif
+}
+
 void f2s_buffered(float f, char* result) {
   const int index = f2s_buffered_n(f, result);
 
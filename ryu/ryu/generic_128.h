@@ -470,7 +470,7 @@ static inline int32_t pow5Factor(uint128_t value) {
 // Returns true if value is divisible by 5^p.
 static inline bool multipleOfPowerOf5(const uint128_t value, const uint32_t p) {
   // I tried a case distinction on p, but there was no performance difference.
-  return pow5Factor(value) >= p;
+  return (uint32_t) pow5Factor(value) >= p;
 }
 
 // Returns true if value is divisible by 2^p.
@@ -0,0 +1,557 @@
+// Fixed (%f) and scientific (%e) output for the binary formats
+// generic_binary_to_decimal takes, meant for the x87 80 bit long double and
+// IEEE binary128 where there are no d2fixed style tables.
+//
+// %f works like f2fixed.c, the value m * 2^e is expanded exactly into base
+// 10^9 limbs, m * 2^e for positive e and m * 5^-e (the value times 10^-e)
+// otherwise, and the decimal digits are rounded ties to even. The expansion
+// has up to ~11500 digits at the bottom of binary128's range, the limbs live
+// on the stack for values within about 1e±300 and on the heap beyond that.
+// Values that round to zero skip the expansion altogether. %e only computes
+// the digits it prints, see generic_exp_digits.
+
+#include "ryu/ryu_generic_128.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ryu/decimal_limbs.h"
+
+#define ONE ((__uint128_t) 1)
+
+// 5^13, the largest power of 5 below 2^31
+#define POW5_13 1220703125u
+
+// scratch kept on the stack, about 1000 digits and the limbs holding them
+#define STACK_LIMBS 112
+#define STACK_DIGITS (9 * STACK_LIMBS + 16)
+
+// A decoded finite value, m * 2^e
+struct generic_binary {
+  __uint128_t m;
+  int32_t e;
+  bool sign;
+};
+
+// Returns false for inf and nan, with the nan mantissa in *payload
+static bool generic_decode(const __uint128_t bits, const uint32_t mantissaBits, const uint32_t exponentBits,
+  const bool explicitLeadingBit, struct generic_binary* const v, __uint128_t* const payload) {
+  const int32_t bias = (int32_t) (1u << (exponentBits - 1)) - 1;
+  const __uint128_t ieeeMantissa = bits & ((ONE << mantissaBits) - 1);
+  const uint32_t ieeeExponent = (uint32_t) ((bits >> mantissaBits) & ((ONE << exponentBits) - 1u));
+  v->sign = ((bits >> (mantissaBits + exponentBits)) & 1) != 0;
+
+  if (ieeeExponent == ((1u << exponentBits) - 1u)) {
+    *payload = explicitLeadingBit ? ieeeMantissa & ((ONE << (mantissaBits - 1)) - 1) : ieeeMantissa;
+    return false;
+  }
+  const int32_t exponent = ieeeExponent == 0 ? 1 : (int32_t) ieeeExponent;
+  if (explicitLeadingBit) {
+    // mantissaBits includes the leading bit
+    v->m = ieeeMantissa;
+    v->e = exponent - bias - (int32_t) mantissaBits + 1;
+  } else {
+    v->m = ieeeExponent == 0 ? ieeeMantissa : (ONE << mantissaBits) | ieeeMantissa;
+    v->e = exponent - bias - (int32_t) mantissaBits;
+  }
+  return true;
+}
+
+static inline uint32_t bit_length(const __uint128_t m) {
+  const uint64_t hi = (uint64_t) (m >> 64);
+  return hi ? 128 - (uint32_t) __builtin_clzll(hi) : 64 - (uint32_t) __builtin_clzll((uint64_t) m);
+}
+
+// Upper bound of the limbs m * 2^e needs, m is not 0
+static uint32_t generic_limbs_bound(const __uint128_t m, const int32_t e) {
+  // digits <= bits * log10(2) + 1 for m * 2^e, m * 5^-e has -e * log10(5) more
+  const int64_t bits = bit_length(m);
+  const int64_t digits = e >= 0 ? (bits + e) * 30103 / 100000 : (bits * 30103 - (int64_t) e * 69898) / 100000;
+  return (uint32_t) (digits / 9 + 3);
+}
+
+// m * 2^e as base 10^9 limbs in the same form float_limbs in f2fixed.c
+// produces, the value is the limbs times 10^-scale. Returns the limb count.
+static uint32_t generic_limbs(const __uint128_t m, const int32_t e, uint32_t* const limbs, int32_t* const scale) {
+  uint32_t count = 0;
+  uint64_t hi = (uint64_t) (m >> 64);
+  if (hi) {
+    // 64 bit divisions only, the low half is added after shifting
+    for (; hi; hi /= 1000000000) {
+      limbs[count++] = (uint32_t) (hi % 1000000000);
+    }
+    count = mul_limbs(limbs, count, 1u << 31);
+    count = mul_limbs(limbs, count, 1u << 31);
+    count = mul_limbs(limbs, count, 1u << 2);
+    uint64_t carry = (uint64_t) m;
+    for (uint32_t i = 0; carry; ++i) {
+      if (i == count) {
+        limbs[count++] = 0;
+      }
+      const uint64_t v = limbs[i] + carry % 1000000000;
+      limbs[i] = (uint32_t) (v % 1000000000);
+      carry = carry / 1000000000 + v / 1000000000;
+    }
+  } else {
+    for (uint64_t lo = (uint64_t) m; lo; lo /= 1000000000) {
+      limbs[count++] = (uint32_t) (lo % 1000000000);
+    }
+  }
+
+  if (e >= 0) {
+    int32_t s = e;
+    for (; s >= 31; s -= 31) {
+      count = mul_limbs(limbs, count, 1u << 31);
+    }
+    if (s > 0) {
+      count = mul_limbs(limbs, count, 1u << s);
+    }
+    *scale = 0;
+  } else {
+    int32_t s = -e;
+    for (; s >= 13; s -= 13) {
+      count = mul_limbs(limbs, count, POW5_13);
+    }
+    uint32_t p = 1;
+    for (; s > 0; --s) {
+      p *= 5;
+    }
+    if (p > 1) {
+      count = mul_limbs(limbs, count, p);
+    }
+    *scale = -e;
+  }
+  return count;
+}
+
+// Scratch for the limbs and digits, on the heap when the stack part is too small
+struct generic_scratch {
+  uint32_t stackLimbs[STACK_LIMBS];
+  char stackDigits[STACK_DIGITS];
+  uint32_t* limbs;
+  char* digits;
+  void* heap;
+};
+
+static bool generic_scratch_init(struct generic_scratch* const s, const uint32_t limbs) {
+  s->heap = NULL;
+  s->limbs = s->stackLimbs;
+  s->digits = s->stackDigits;
+  if (limbs <= STACK_LIMBS) {
+    return true;
+  }
+  // one extra digit in front for a carry out of the top
+  s->heap = malloc(limbs * sizeof(uint32_t) + 9 * (size_t) limbs + 16);
+  if (s->heap == NULL) {
+    return false;
+  }
+  s->limbs = (uint32_t*) s->heap;
+  s->digits = (char*) (s->limbs + limbs);
+  return true;
+}
+
+static int copy_special_str_printf_128(char* const result, const bool sign, const __uint128_t payload) {
+#if defined(_MSC_VER)
+  if (sign) {
+    result[0] = '-';
+  }
+  if (payload) {
+    memcpy(result + sign, "nan", 3);
+    return sign + 3;
+  }
+#else
+  if (payload) {
+    memcpy(result, "nan", 3);
+    return 3;
+  }
+  if (sign) {
+    result[0] = '-';
+  }
+#endif
+  memcpy(result + sign, "Infinity", 8);
+  return sign + 8;
+}
+
+int generic_binary_to_fixed(const __uint128_t bits, const uint32_t mantissaBits, const uint32_t exponentBits,
+  const bool explicitLeadingBit, const uint32_t precision, char* const result) {
+  struct generic_binary v;
+  __uint128_t payload;
+  if (!generic_decode(bits, mantissaBits, exponentBits, explicitLeadingBit, &v, &payload)) {
+    return copy_special_str_printf_128(result, v.sign, payload);
+  }
+
+  int index = 0;
+  if (v.sign) {
+    result[index++] = '-';
+  }
+
+  struct generic_scratch s;
+  const char* d = NULL;
+  int32_t count = 0;
+  int32_t intLength = 0;
+  // m * 2^e < 2^(bits + e) <= 10^-(precision + 1) rounds to zero
+  if (v.m != 0 && ((int64_t) bit_length(v.m) + v.e) * 100000 > -((int64_t) precision + 1) * 332193) {
+    if (!generic_scratch_init(&s, generic_limbs_bound(v.m, v.e))) {
+      return -1;
+    }
+    int32_t scale;
+    const uint32_t limbCount = generic_limbs(v.m, v.e, s.limbs, &scale);
+    const int32_t length = (int32_t) limbs_length(s.limbs, limbCount);
+    intLength = length - scale;
+    // keep the digits down to 10^-precision, below half a unit of that
+    // everything rounds to 0
+    const int32_t keep = scale > (int32_t) precision ? intLength + (int32_t) precision : length;
+    if (keep < 0) {
+      intLength = 0;
+    } else {
+      char* const digits = s.digits;
+      bool sticky;
+      count = (int32_t) limbs_digits(s.limbs, limbCount, (uint32_t) keep + 1, digits + 1, &sticky);
+      if (round_digits(digits + 1, (uint32_t) count, (uint32_t) keep, sticky)) {
+        digits[0] = '1';
+        count = keep + 1;
+        ++intLength;
+        memmove(digits + 1, digits, (size_t) count);
+      } else if (count > keep) {
+        count = keep;
+      }
+      d = digits + 1;
+    }
+  } else {
+    s.heap = NULL;
+  }
+
+  if (intLength > 0) {
+    memcpy(result + index, d, (size_t) intLength);
+    index += intLength;
+  } else {
+    result[index++] = '0';
+  }
+  if (precision > 0) {
+    result[index++] = '.';
+    int32_t written = 0;
+    if (intLength < 0) {
+      const int32_t zeros = -intLength < (int32_t) precision ? -intLength : (int32_t) precision;
+      memset(result + index, '0', (size_t) zeros);
+      index += zeros;
+      written = zeros;
+    }
+    const int32_t from = intLength > 0 ? intLength : 0;
+    if (count > from) {
+      memcpy(result + index, d + from, (size_t) (count - from));
+      index += count - from;
+      written += count - from;
+    }
+    memset(result + index, '0', precision - (uint32_t) written);
+    index += (int) precision - written;
+  }
+  free(s.heap);
+  return index;
+}
+
+// %e needs only the first precision + 2 digits. They are floor(x * 10^k) for
+// the k that leaves that many digits in front of the point, computed in binary
+// with 64 bit limbs: m * 5^k shifted for k >= 0, m * 2^e divided by 5^-k with
+// Knuth's algorithm D otherwise. The quotient is short, so the work is one
+// chain of multiplications by 5^27 plus a division that is linear in the size
+// of 5^-k, instead of the whole decimal expansion.
+
+// 5^27, the largest power of 5 below 2^63
+#define POW5_27 7450580596923828125ull
+
+// 64 bit limbs kept on the stack, enough for exponents within about 1e±500
+#define STACK_BIG_LIMBS 96
+
+static uint32_t big_mul(uint64_t* const a, uint32_t n, const uint64_t factor) {
+  uint64_t carry = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const __uint128_t v = (__uint128_t) a[i] * factor + carry;
+    a[i] = (uint64_t) v;
+    carry = (uint64_t) (v >> 64);
+  }
+  if (carry != 0) {
+    a[n++] = carry;
+  }
+  return n;
+}
+
+static uint32_t big_mul_pow5(uint64_t* const a, uint32_t n, uint32_t k) {
+  for (; k >= 27; k -= 27) {
+    n = big_mul(a, n, POW5_27);
+  }
+  uint64_t p = 1;
+  for (; k > 0; --k) {
+    p *= 5;
+  }
+  return p > 1 ? big_mul(a, n, p) : n;
+}
+
+// a <<= s, a has room for the limbs it grows by
+static uint32_t big_shift_left(uint64_t* const a, uint32_t n, const uint32_t s) {
+  const uint32_t words = s / 64;
+  const uint32_t bits = s % 64;
+  if (bits != 0) {
+    a[n] = 0;
+    for (uint32_t i = n; i > 0; --i) {
+      a[i] = (a[i] << bits) | (a[i - 1] >> (64 - bits));
+    }
+    a[0] <<= bits;
+    if (a[n] != 0) {
+      ++n;
+    }
+  }
+  if (words != 0) {
+    memmove(a + words, a, n * sizeof(uint64_t));
+    memset(a, 0, words * sizeof(uint64_t));
+    n += words;
+  }
+  return n;
+}
+
+// q = floor(u / v) with v[n - 1] != 0 and u at least as long as v. u is
+// clobbered and needs room for one more limb, q gets m - n + 1 limbs.
+// Returns whether the remainder is non-zero.
+static bool big_div(uint64_t* const u, const uint32_t m, uint64_t* const v, const uint32_t n, uint64_t* const q) {
+  if (n == 1) {
+    __uint128_t rest = 0;
+    for (int32_t i = (int32_t) m - 1; i >= 0; --i) {
+      const __uint128_t num = (rest << 64) | u[i];
+      q[i] = (uint64_t) (num / v[0]);
+      rest = num - (__uint128_t) q[i] * v[0];
+    }
+    return rest != 0;
+  }
+
+  // normalize so the top bit of v is set, qhat is then off by at most 2
+  const uint32_t shift = (uint32_t) __builtin_clzll(v[n - 1]);
+  big_shift_left(v, n, shift);
+  u[m] = 0;
+  big_shift_left(u, m, shift);
+
+  for (int32_t j = (int32_t) (m - n); j >= 0; --j) {
+    const __uint128_t num = ((__uint128_t) u[j + n] << 64) | u[j + n - 1];
+    __uint128_t qhat = num / v[n - 1];
+    __uint128_t rhat = num - qhat * v[n - 1];
+    while ((qhat >> 64) != 0 || qhat * v[n - 2] > ((rhat << 64) | u[j + n - 2])) {
+      --qhat;
+      rhat += v[n - 1];
+      if ((rhat >> 64) != 0) {
+        break;
+      }
+    }
+
+    uint64_t carry = 0;
+    uint64_t borrow = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      const __uint128_t p = qhat * v[i] + carry;
+      carry = (uint64_t) (p >> 64);
+      const uint64_t lo = (uint64_t) p;
+      const uint64_t t = u[i + j] - lo;
+      const uint64_t nb = (u[i + j] < lo) | (t < borrow);
+      u[i + j] = t - borrow;
+      borrow = nb;
+    }
+    const uint64_t top = u[j + n];
+    u[j + n] = top - carry - borrow;
+    q[j] = (uint64_t) qhat;
+    if (top < carry || top - carry < borrow) {
+      // qhat was one too large, add v back
+      --q[j];
+      uint64_t c = 0;
+      for (uint32_t i = 0; i < n; ++i) {
+        const __uint128_t t = (__uint128_t) u[i + j] + v[i] + c;
+        u[i + j] = (uint64_t) t;
+        c = (uint64_t) (t >> 64);
+      }
+      u[j + n] += c;
+    }
+  }
+
+  for (uint32_t i = 0; i < n; ++i) {
+    if (u[i] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Writes the decimal digits of q (n limbs, destroyed) and returns how many.
+// chunks needs room for one entry per nine digits.
+static uint32_t big_digits(uint64_t* const q, uint32_t n, uint32_t* const chunks, char* const digits) {
+  uint32_t count = 0;
+  while (n > 1 || q[0] >= 1000000000) {
+    // divide by 10^9 a 32 bit half at a time, the partial dividends fit 64 bits
+    uint64_t rest = 0;
+    for (int32_t i = (int32_t) n - 1; i >= 0; --i) {
+      const uint64_t hi = (rest << 32) | (q[i] >> 32);
+      const uint64_t qhi = hi / 1000000000;
+      const uint64_t lo = ((hi - qhi * 1000000000) << 32) | (q[i] & 0xffffffffu);
+      const uint64_t qlo = lo / 1000000000;
+      rest = lo - qlo * 1000000000;
+      q[i] = (qhi << 32) | qlo;
+    }
+    chunks[count++] = (uint32_t) rest;
+    if (q[n - 1] == 0) {
+      --n;
+    }
+  }
+  const uint32_t top = (uint32_t) q[0];
+  uint32_t index = decimalLength9(top);
+  write_digits(top, index, digits);
+  while (count > 0) {
+    write_digits(chunks[--count], 9, digits + index);
+    index += 9;
+  }
+  return index;
+}
+
+// floor(log10(2^n)) or one less, for |n| up to 2^20
+static inline int32_t log10Pow2Below(const int32_t n) {
+  // 1292913986 / 2^32 is just below log10(2), 1292913987 / 2^32 just above
+  if (n >= 0) {
+    return (int32_t) (((uint64_t) n * 1292913986u) >> 32);
+  }
+  return -(int32_t) (((uint64_t) -n * 1292913987u + 0xffffffffu) >> 32);
+}
+
+// The first digits of m * 2^e (m > 0) for %e with precision digits after
+// the point, rounded. digits needs precision + 4 bytes. Returns false when
+// scratch memory can't be allocated.
+static bool generic_exp_digits(const __uint128_t m, const int32_t e, const uint32_t precision, char* const digits,
+  int32_t* const exponent) {
+  const int32_t x = log10Pow2Below((int32_t) bit_length(m) - 1 + e);
+  // x * 10^k has precision + 2 digits in front of the point, or one more
+  // when x was one too small
+  const int64_t k = (int64_t) precision + 1 - x;
+  const int64_t t = e + k;
+
+  // A / B with A = m * 5^k * 2^t and B = 5^-k * 2^-t, positive exponents only
+  const uint32_t aBits = bit_length(m) + (k > 0 ? (uint32_t) (k * 2322 / 1000 + 1) : 0) + (t > 0 ? (uint32_t) t : 0);
+  const uint32_t bBits = k < 0 ? (uint32_t) (-k * 2322 / 1000 + 1) + (t < 0 ? (uint32_t) -t : 0) : 0;
+  const uint32_t aLimbs = aBits / 64 + 3;
+  const uint32_t bLimbs = bBits / 64 + 3;
+  const uint32_t chunkLimbs = (precision + 4) / 18 + 2;
+  const uint32_t total = 2 * aLimbs + bLimbs + chunkLimbs;
+
+  uint64_t stack[STACK_BIG_LIMBS];
+  uint64_t* scratch = stack;
+  if (total > STACK_BIG_LIMBS) {
+    scratch = (uint64_t*) malloc(total * sizeof(uint64_t));
+    if (scratch == NULL) {
+      return false;
+    }
+  }
+  uint64_t* const a = scratch;
+  uint64_t* const b = a + aLimbs;
+  uint64_t* const q = b + bLimbs;
+  uint32_t* const chunks = (uint32_t*) (q + aLimbs);
+
+  a[0] = (uint64_t) m;
+  a[1] = (uint64_t) (m >> 64);
+  uint32_t an = a[1] != 0 ? 2 : 1;
+  uint64_t* quotient = a;
+  uint32_t qn;
+  bool sticky = false;
+  if (k >= 0) {
+    an = big_mul_pow5(a, an, (uint32_t) k);
+    if (t >= 0) {
+      qn = big_shift_left(a, an, (uint32_t) t);
+    } else {
+      // shift right, the bits shifted out are the rest
+      const uint32_t words = (uint32_t) (-t / 64);
+      const uint32_t bits = (uint32_t) (-t % 64);
+      for (uint32_t i = 0; i < words && i < an; ++i) {
+        sticky |= a[i] != 0;
+      }
+      qn = an - words;
+      quotient = a + words;
+      if (bits != 0) {
+        sticky |= (quotient[0] & ((1ull << bits) - 1)) != 0;
+        for (uint32_t i = 0; i + 1 < qn; ++i) {
+          quotient[i] = (quotient[i] >> bits) | (quotient[i + 1] << (64 - bits));
+        }
+        quotient[qn - 1] >>= bits;
+        if (qn > 1 && quotient[qn - 1] == 0) {
+          --qn;
+        }
+      }
+    }
+  } else {
+    b[0] = 1;
+    uint32_t bn = big_mul_pow5(b, 1, (uint32_t) -k);
+    if (t >= 0) {
+      an = big_shift_left(a, an, (uint32_t) t);
+    } else {
+      bn = big_shift_left(b, bn, (uint32_t) -t);
+    }
+    qn = an - bn + 1;
+    sticky = big_div(a, an, b, bn, q);
+    quotient = q;
+    while (qn > 1 && quotient[qn - 1] == 0) {
+      --qn;
+    }
+  }
+
+  const uint32_t count = big_digits(quotient, qn, chunks, digits);
+  *exponent = x + (int32_t) (count - (precision + 2));
+  if (round_digits(digits, count, precision + 1, sticky)) {
+    // 9.99 became 10.0
+    digits[0] = '1';
+    ++*exponent;
+  }
+  if (scratch != stack) {
+    free(scratch);
+  }
+  return true;
+}
+
+int generic_binary_to_exp(const __uint128_t bits, const uint32_t mantissaBits, const uint32_t exponentBits,
+  const bool explicitLeadingBit, const uint32_t precision, char* const result) {
+  struct generic_binary v;
+  __uint128_t payload;
+  if (!generic_decode(bits, mantissaBits, exponentBits, explicitLeadingBit, &v, &payload)) {
+    return copy_special_str_printf_128(result, v.sign, payload);
+  }
+
+  int index = 0;
+  if (v.sign) {
+    result[index++] = '-';
+  }
+
+  // the digits go right behind the first one's place, which leaves the
+  // fraction where it belongs once the first digit moves in front of the point
+  int32_t exp = 0;
+  char* const digits = result + index + 1;
+  if (v.m == 0) {
+    memset(digits, '0', precision + 1);
+  } else if (!generic_exp_digits(v.m, v.e, precision, digits, &exp)) {
+    return -1;
+  }
+  result[index++] = digits[0];
+  if (precision > 0) {
+    result[index++] = '.';
+    index += (int) precision;
+  }
+
+  result[index++] = 'e';
+  if (exp < 0) {
+    result[index++] = '-';
+    exp = -exp;
+  } else {
+    result[index++] = '+';
+  }
+  if (exp >= 1000) {
+    result[index++] = (char) ('0' + exp / 1000);
+    exp %= 1000;
+    result[index++] = (char) ('0' + exp / 100);
+    exp %= 100;
+  } else if (exp >= 100) {
+    result[index++] = (char) ('0' + exp / 100);
+    exp %= 100;
+  }
+  memcpy(result + index, DIGIT_TABLE + 2 * exp, 2);
+  index += 2;
+  return index;
+}
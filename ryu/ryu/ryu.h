@@ -17,6 +17,9 @@
 #ifndef RYU_H
 #define RYU_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -25,10 +28,25 @@ int d2s_buffered_n(double f, char* result);
 void d2s_buffered(double f, char* result);
 char* d2s(double f);
 
+// d2s_buffered_n and f2s_buffered_n go through Ryu, or through Schubfach when
+// built with RYU_SCHUBFACH. Both engines give the same output, these pick one
+// explicitly to compare them.
+int d2s_ryu_buffered_n(double f, char* result);
+int d2s_schubfach_buffered_n(double f, char* result);
+
+// Converts count doubles at once, each to the same text as d2s_buffered_n. The
+// results are written back to back without terminators; value i ends up in
+// result[offsets[i], offsets[i + 1]), so offsets needs count + 1 entries and
+// result 24 bytes per value. Returns the total number of characters written.
+size_t d2s_batch(const double* values, size_t count, char* result, uint32_t* offsets);
+
 int f2s_buffered_n(float f, char* result);
 void f2s_buffered(float f, char* result);
 char* f2s(float f);
 
+int f2s_ryu_buffered_n(float f, char* result);
+int f2s_schubfach_buffered_n(float f, char* result);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,22 @@ int d2exp_buffered_n(double d, uint32_t precision, char* result);
 void d2exp_buffered(double d, uint32_t precision, char* result);
 char* d2exp(double d, uint32_t precision);
 
+// Exact number of characters d2fixed_buffered_n / d2exp_buffered_n write for
+// the same arguments, from the exponent and precision for all but a few
+// values, so the caller can reserve room and convert straight into place.
+int d2fixed_length(double d, uint32_t precision);
+int d2exp_length(double d, uint32_t precision);
+
+// The same output for binary32 values, computed from the float's own bits
+// instead of widening it to double.
+int f2fixed_buffered_n(float f, uint32_t precision, char* result);
+void f2fixed_buffered(float f, uint32_t precision, char* result);
+char* f2fixed(float f, uint32_t precision);
+
+int f2exp_buffered_n(float f, uint32_t precision, char* result);
+void f2exp_buffered(float f, uint32_t precision, char* result);
+char* f2exp(float f, uint32_t precision);
+
 #ifdef __cplusplus
 }
 #endif
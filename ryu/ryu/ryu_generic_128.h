@@ -54,6 +54,17 @@ struct floating_decimal_128 generic_binary_to_decimal(
 // = 1 + 39 + 1 + 1 + 1 + 10 = 53
 int generic_to_chars(const struct floating_decimal_128 v, char* const result);
 
+// Exact %f and %e output for the same formats, the counterparts of d2fixed_buffered_n and
+// d2exp_buffered_n. Returns the number of characters written, or -1 when the scratch memory for
+// extreme exponents can't be allocated. Does not terminate the buffer with a 0.
+//
+// %f writes up to sign + 4933 integer digits + decimal dot + precision characters for binary128
+// and the 80 bit long double, %e up to precision + 9 (sign, digit, dot, 'e', sign, 4 digits).
+int generic_binary_to_fixed(const __uint128_t bits, const uint32_t mantissaBits, const uint32_t exponentBits,
+    const bool explicitLeadingBit, const uint32_t precision, char* const result);
+int generic_binary_to_exp(const __uint128_t bits, const uint32_t mantissaBits, const uint32_t exponentBits,
+    const bool explicitLeadingBit, const uint32_t precision, char* const result);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,51 @@
+#include "ryu/simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static enum ryu_simd ryu_simd_detect(void) {
+  enum ryu_simd level = RYU_SIMD_GENERIC;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    level = RYU_SIMD_SSE2;
+  }
+  if (level == RYU_SIMD_SSE2 && __builtin_cpu_supports("avx2")) {
+    level = RYU_SIMD_AVX2;
+  }
+  if (level == RYU_SIMD_AVX2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    level = RYU_SIMD_AVX512;
+  }
+#endif
+
+  const char* const cap = getenv("RYU_SIMD");
+  if (cap != NULL) {
+    static const char* const names[] = { "generic", "sse2", "avx2", "avx512" };
+    for (int i = 0; i < 4; ++i) {
+      if (strcmp(cap, names[i]) == 0 && i < (int) level) {
+        level = (enum ryu_simd) i;
+      }
+    }
+  }
+  return level;
+}
+
+enum ryu_simd ryu_simd_level(void) {
+  // -1 until resolved. Racing first calls compute the same value, so a
+  // relaxed store is enough.
+  static int level = -1;
+#if defined(__GNUC__) || defined(__clang__)
+  int current = __atomic_load_n(&level, __ATOMIC_RELAXED);
+  if (current < 0) {
+    current = (int) ryu_simd_detect();
+    __atomic_store_n(&level, current, __ATOMIC_RELAXED);
+  }
+#else
+  int current = level;
+  if (current < 0) {
+    current = (int) ryu_simd_detect();
+    level = current;
+  }
+#endif
+  return (enum ryu_simd) current;
+}
@@ -0,0 +1,29 @@
+// Runtime selection of the SIMD kernels, shared by ryu and format.
+#ifndef RYU_SIMD_H
+#define RYU_SIMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The instruction set levels the vectorized kernels in ryu and format come in.
+enum ryu_simd {
+  RYU_SIMD_GENERIC = 0,
+  RYU_SIMD_SSE2 = 1,
+  RYU_SIMD_AVX2 = 2,
+  // AVX-512F and AVX-512BW
+  RYU_SIMD_AVX512 = 3
+};
+
+// The best level this CPU supports, from cpuid on the first call. The
+// RYU_SIMD environment variable ("generic", "sse2", "avx2" or "avx512") caps
+// it, so every variant can be run on one machine; asking for more than the
+// CPU has gets what it has. Every caller resolves its function pointers from
+// this once.
+enum ryu_simd ryu_simd_level(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RYU_SIMD_H